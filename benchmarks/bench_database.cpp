@@ -0,0 +1,71 @@
+#include "bench_database.h"
+
+#include <cstdlib>
+
+#include "../src/postgres/postgres.h"
+
+using namespace std::literals;
+using pqxx::operator""_zv;
+
+namespace bench {
+
+namespace {
+
+// Каталог, загруженный в базу бенчмарков; пустая строка — таблицы пусты или их содержимое неизвестно
+std::string loaded_catalog;
+
+std::optional<pqxx::connection> Connect(const char* url) {
+    std::optional<pqxx::connection> connection{std::in_place, url};
+    postgres::PrepareStatements(*connection);
+    return connection;
+}
+
+}  // namespace
+
+const char* GetBenchDatabaseUrl(benchmark::State& state) {
+    const char* url = std::getenv(BENCH_DB_URL_ENV_NAME);
+    if (!url) {
+        state.SkipWithError((BENCH_DB_URL_ENV_NAME + " environment variable not found"s).c_str());
+    }
+    return url;
+}
+
+std::optional<pqxx::connection> ConnectToBenchDatabase(benchmark::State& state) {
+    const char* url = GetBenchDatabaseUrl(state);
+    if (!url) {
+        return std::nullopt;
+    }
+
+    // Database создаёт схему, если её ещё нет
+    postgres::Database database{postgres::DatabaseConfig{url}};
+    auto connection = Connect(url);
+
+    loaded_catalog.clear();
+    pqxx::work work{*connection};
+    work.exec("TRUNCATE book_tags, books, authors;"_zv);
+    work.commit();
+
+    return connection;
+}
+
+std::optional<pqxx::connection> ConnectToCatalog(benchmark::State& state, const std::string& name,
+                                                 const CatalogPopulator& populate) {
+    if (!loaded_catalog.empty() && loaded_catalog == name) {
+        return Connect(std::getenv(BENCH_DB_URL_ENV_NAME));
+    }
+
+    auto connection = ConnectToBenchDatabase(state);
+    if (!connection) {
+        return connection;
+    }
+
+    pqxx::work work{*connection};
+    populate(work);
+    work.exec("ANALYZE authors, books, book_tags;"_zv);
+    work.commit();
+
+    loaded_catalog = name;
+    return connection;
+}
+
+}  // namespace bench
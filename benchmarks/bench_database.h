@@ -0,0 +1,28 @@
+#pragma once
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <optional>
+#include <pqxx/pqxx>
+#include <string>
+
+namespace bench {
+
+// Бенчмарки очищают таблицы, поэтому им нужна отдельная база данных
+inline constexpr const char BENCH_DB_URL_ENV_NAME[]{"BOOKYPEDIA_BENCH_DB_URL"};
+
+// Строка подключения к базе бенчмарков. Без неё бенчмарк завершается с ошибкой и возвращается nullptr
+const char* GetBenchDatabaseUrl(benchmark::State& state);
+
+// Соединение с базой бенчмарков с пустыми таблицами и подготовленными запросами
+std::optional<pqxx::connection> ConnectToBenchDatabase(benchmark::State& state);
+
+using CatalogPopulator = std::function<void(pqxx::work& work)>;
+
+// Соединение с базой, в которую загружен каталог name. Каталог строится populate на пустых таблицах,
+// только если сейчас загружен другой: бенчмарки одного каталога строят его один раз, в каком бы порядке они
+// ни шли. Бенчмарки каталога не должны менять число его строк
+std::optional<pqxx::connection> ConnectToCatalog(benchmark::State& state, const std::string& name,
+                                                 const CatalogPopulator& populate);
+
+}  // namespace bench
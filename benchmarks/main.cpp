@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+// Без --benchmark_out результаты, кроме вывода в консоль, записываются в benchmark_results.json,
+// чтобы сравнивать их между версиями (tools/compare.py из Google Benchmark)
+int main(int argc, char** argv) {
+    using namespace std::literals;
+
+    static char default_out[] = "--benchmark_out=benchmark_results.json";
+    static char default_out_format[] = "--benchmark_out_format=json";
+
+    std::vector<char*> args{argv, argv + argc};
+    const bool has_out = std::any_of(args.begin(), args.end(), [](const char* arg) {
+        return std::string_view{arg}.starts_with("--benchmark_out="sv);
+    });
+    if (!has_out) {
+        args.push_back(default_out);
+        args.push_back(default_out_format);
+    }
+    int count = static_cast<int>(args.size());
+    args.push_back(nullptr);
+
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+#ifdef NDEBUG
+    benchmark::AddCustomContext("bookypedia_build_type", "release");
+#else
+    benchmark::AddCustomContext("bookypedia_build_type", "debug");
+#endif
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
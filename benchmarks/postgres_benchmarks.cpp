@@ -0,0 +1,194 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <optional>
+#include <pqxx/pqxx>
+#include <string>
+#include <vector>
+
+#include "../src/postgres/postgres.h"
+#include "bench_database.h"
+
+using namespace std::literals;
+using pqxx::operator""_zv;
+
+namespace {
+
+using bench::ConnectToBenchDatabase;
+
+domain::Tags MakeTags(int first, int count) {
+    domain::Tags tags;
+    tags.reserve(count);
+    for (int i = first; i < first + count; ++i) {
+        tags.push_back("tag " + std::to_string(i));
+    }
+    return tags;
+}
+
+// Сохраняет книгу с state.range(0) тегами; соседние итерации меняют половину тегов
+void BM_SaveBookTags(benchmark::State& state) {
+    auto connection = ConnectToBenchDatabase(state);
+    if (!connection) {
+        return;
+    }
+
+    const auto tag_count = static_cast<int>(state.range(0));
+    const domain::Author author{domain::AuthorId::New(), "Benchmark author"};
+    const auto book_id = domain::BookId::New();
+    {
+        pqxx::work work{*connection};
+        postgres::AuthorRepositoryImpl{work}.Save(author);
+        work.commit();
+    }
+
+    int iteration = 0;
+    for (auto _ : state) {
+        const int shift = (iteration++ % 2) * tag_count / 2;
+        pqxx::work work{*connection};
+        postgres::BookRepositoryImpl books{work};
+        books.Save({book_id, author.GetId(), "Benchmark book", 2000, MakeTags(shift, tag_count)});
+        work.commit();
+    }
+    state.counters["tags"] = tag_count;
+}
+BENCHMARK(BM_SaveBookTags)->RangeMultiplier(4)->Range(1, 256)->Unit(benchmark::kMicrosecond);
+
+void BM_EditBookTags(benchmark::State& state) {
+    auto connection = ConnectToBenchDatabase(state);
+    if (!connection) {
+        return;
+    }
+
+    const auto tag_count = static_cast<int>(state.range(0));
+    const domain::Author author{domain::AuthorId::New(), "Benchmark author"};
+    const domain::Book book{domain::BookId::New(), author.GetId(), "Benchmark book", 2000, MakeTags(0, tag_count)};
+    {
+        pqxx::work work{*connection};
+        postgres::AuthorRepositoryImpl{work}.Save(author);
+        postgres::BookRepositoryImpl{work}.Save(book);
+        work.commit();
+    }
+
+    int iteration = 0;
+    for (auto _ : state) {
+        const int shift = (iteration++ % 2) * tag_count / 2;
+        pqxx::work work{*connection};
+        postgres::BookRepositoryImpl books{work};
+        books.EditBook(book.GetBookId(), book.GetTitle(), 2000 + iteration, MakeTags(shift, tag_count));
+        work.commit();
+    }
+    state.counters["tags"] = tag_count;
+}
+BENCHMARK(BM_EditBookTags)->RangeMultiplier(4)->Range(1, 256)->Unit(benchmark::kMicrosecond);
+
+template <util::UUIDVersion Version>
+struct InsertBenchmarkTag {
+    static constexpr auto UUID_VERSION = Version;
+};
+
+// Вставляет state.range(0) новых идентификаторов пакетами в таблицу с первичным ключом uuid.
+// Случайные идентификаторы попадают в произвольные страницы индекса и расщепляют их, упорядоченные по
+// времени дописываются в последнюю; index_bytes показывает итоговый размер индекса
+template <util::UUIDVersion Version>
+void BM_InsertIds(benchmark::State& state) {
+    using Id = util::TaggedUUID<InsertBenchmarkTag<Version>>;
+    constexpr int64_t BATCH_SIZE = 1000;
+
+    auto connection = ConnectToBenchDatabase(state);
+    if (!connection) {
+        return;
+    }
+
+    const int64_t row_count = state.range(0);
+    int64_t index_bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            pqxx::work work{*connection};
+            work.exec("DROP TABLE IF EXISTS id_benchmark;"_zv);
+            work.exec("CREATE TABLE id_benchmark (id UUID PRIMARY KEY);"_zv);
+            work.commit();
+        }
+        state.ResumeTiming();
+
+        for (int64_t inserted = 0; inserted < row_count; inserted += BATCH_SIZE) {
+            std::vector<std::string> ids;
+            for (const auto& id : Id::New(std::min(BATCH_SIZE, row_count - inserted))) {
+                ids.push_back(id.ToString());
+            }
+            pqxx::work work{*connection};
+            work.exec_params("INSERT INTO id_benchmark (id) SELECT unnest($1::uuid[]);"_zv, ids);
+            work.commit();
+        }
+
+        state.PauseTiming();
+        pqxx::work work{*connection};
+        index_bytes = work.query_value<int64_t>("SELECT pg_relation_size('id_benchmark_pkey');"_zv);
+        work.exec("DROP TABLE id_benchmark;"_zv);
+        work.commit();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * row_count);
+    state.counters["index_bytes"] = static_cast<double>(index_bytes);
+}
+BENCHMARK(BM_InsertIds<util::UUIDVersion::Random>)
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_InsertIds<util::UUIDVersion::TimeOrdered>)
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+// Каталог из 500 тысяч книг примерно с 2,4 миллиона назначений тегов. Теги распределены неравномерно:
+// "tag 0" есть примерно у трети книг, "tag 100" — примерно у трёх тысяч, как у обычного тега
+std::optional<pqxx::connection> ConnectToTaggedCatalog(benchmark::State& state) {
+    return bench::ConnectToCatalog(state, "tagged", [](pqxx::work& work) {
+        work.exec(R"(
+INSERT INTO authors (id, name)
+SELECT gen_random_uuid(), 'Author ' || i
+FROM generate_series(1, 10000) AS i;
+)"_zv);
+        work.exec(R"(
+INSERT INTO books (id, author_id, title, publication_year)
+SELECT gen_random_uuid(), a.id, a.name || ' book ' || i, 1900 + i
+FROM authors a, generate_series(1, 50) AS i;
+)"_zv);
+        work.exec(R"(
+INSERT INTO book_tags (book_id, tag)
+SELECT b.id, 'tag ' || floor(power(random(), 3) * 2000)::int
+FROM books b, generate_series(1, 5)
+ON CONFLICT DO NOTHING;
+)"_zv);
+    });
+}
+
+// Первая страница книг с тегами "tag <range(0)>" ... (range(1) тегов подряд): все сразу при range(2) == 0,
+// хотя бы один — при range(2) == 1
+void BM_GetBooksByTags(benchmark::State& state) {
+    constexpr size_t PAGE_SIZE = 100;
+
+    auto connection = ConnectToTaggedCatalog(state);
+    if (!connection) {
+        return;
+    }
+
+    const auto tags = MakeTags(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    const auto match = state.range(2) == 0 ? domain::TagMatch::All : domain::TagMatch::Any;
+
+    size_t found = 0;
+    for (auto _ : state) {
+        pqxx::read_transaction work{*connection};
+        found = postgres::BookRepositoryImpl{work}.GetBooksByTags(tags, match, std::nullopt, PAGE_SIZE).size();
+    }
+    state.counters["books"] = static_cast<double>(found);
+}
+BENCHMARK(BM_GetBooksByTags)
+    ->ArgNames({"first_tag", "tags", "any"})
+    ->ArgsProduct({{0, 100}, {1, 2, 3}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "../src/domain/book.h"
+#include "../src/ui/view.h"
+
+namespace {
+
+// Теги в том виде, в каком их вводят: с лишними пробелами и повторами
+std::vector<std::string> MakeRawTags(size_t count) {
+    std::vector<std::string> tags;
+    tags.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        tags.push_back("  tag   " + std::to_string(count - 1 - i % (count / 2 + 1)) + "  ");
+    }
+    return tags;
+}
+
+void BM_PrepareTags(benchmark::State& state) {
+    const auto raw_tags = MakeRawTags(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ui::detail::PrepareTags(raw_tags));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PrepareTags)->RangeMultiplier(4)->Range(1, 256);
+
+// Книги автора в обратном порядке названий, чтобы сортировке было что делать
+void BM_BooksToInfo(benchmark::State& state) {
+    const auto count = static_cast<int>(state.range(0));
+    const auto author_id = domain::AuthorId::New();
+    domain::Books books;
+    books.reserve(count);
+    for (int i = count; i > 0; --i) {
+        books.emplace_back(domain::BookId::New(), author_id, "Book " + std::to_string(i), 1900 + i % 100,
+                           domain::Tags{"adventure", "classic"}, "Jack London");
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ui::detail::BooksToInfo(books));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BooksToInfo)->RangeMultiplier(8)->Range(8, 4096);
+
+}  // namespace
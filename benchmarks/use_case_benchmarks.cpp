@@ -0,0 +1,271 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <initializer_list>
+#include <optional>
+#include <pqxx/pqxx>
+#include <string>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/embedded/embedded.h"
+#include "../src/memory/memory.h"
+#include "../src/postgres/postgres.h"
+#include "../tests/mocks.h"
+#include "bench_database.h"
+
+using namespace std::literals;
+using pqxx::operator""_zv;
+
+namespace {
+
+// Сколько книг у каждого автора каталога; у каждой книги три тега из TAG_COUNT
+constexpr int BOOKS_PER_AUTHOR = 10;
+constexpr int TAG_COUNT = 100;
+// Столько книг запрашивается страницей и при поиске
+constexpr size_t PAGE_SIZE = 20;
+// Столько авторов и книг каталога перебирают бенчмарки
+constexpr size_t SAMPLE_SIZE = 100;
+
+struct CatalogSample {
+    domain::Authors authors;
+    domain::Books books;
+};
+
+CatalogSample TakeSample(app::UseCases& use_cases) {
+    return {use_cases.GetAuthorsPage(std::nullopt, SAMPLE_SIZE), use_cases.GetBooksPage(std::nullopt, SAMPLE_SIZE)};
+}
+
+// --- Операции: одна итерация бенчмарка; i перебирает образец каталога ---
+
+void GetBooksPage(app::UseCases& use_cases, const CatalogSample&, size_t) {
+    benchmark::DoNotOptimize(use_cases.GetBooksPage(std::nullopt, PAGE_SIZE));
+}
+
+void FindAuthorByName(app::UseCases& use_cases, const CatalogSample& sample, size_t i) {
+    benchmark::DoNotOptimize(use_cases.FindAuthorByName(sample.authors[i % sample.authors.size()].GetName()));
+}
+
+void GetBooksByAuthor(app::UseCases& use_cases, const CatalogSample& sample, size_t i) {
+    benchmark::DoNotOptimize(use_cases.GetBooksByAuthor(sample.authors[i % sample.authors.size()].GetId()));
+}
+
+void SearchBooks(app::UseCases& use_cases, const CatalogSample& sample, size_t i) {
+    benchmark::DoNotOptimize(use_cases.SearchBooks(sample.books[i % sample.books.size()].GetTitle(), PAGE_SIZE));
+}
+
+void GetBooksByTags(app::UseCases& use_cases, const CatalogSample&, size_t i) {
+    const domain::Tags tags{"tag " + std::to_string(i % TAG_COUNT)};
+    benchmark::DoNotOptimize(use_cases.GetBooksByTags(tags, domain::TagMatch::All, std::nullopt, PAGE_SIZE));
+}
+
+// Год меняется туда и обратно, так что каталог после бенчмарка прежний
+void EditBook(app::UseCases& use_cases, const CatalogSample& sample, size_t i) {
+    const auto& book = sample.books[i % sample.books.size()];
+    const int shift = static_cast<int>(i / sample.books.size() % 2);
+    use_cases.EditBook(book.GetBookId(), book.GetTitle(), book.GetPublicationYear() + shift, book.GetTags());
+}
+
+// Команда переименования автора, как её выполняет View: поиск и запись в одной единице работы
+void EditAuthorCommand(app::UseCases& use_cases, const CatalogSample& sample, size_t i) {
+    const auto& name = sample.authors[i % sample.authors.size()].GetName();
+    use_cases.RunCommand([&] {
+        const auto author = use_cases.FindAuthorByName(name);
+        use_cases.EditAuthor(author->GetId(), name);
+    });
+}
+
+using UseCaseOperation = void (*)(app::UseCases& use_cases, const CatalogSample& sample, size_t i);
+
+struct NamedOperation {
+    const char* name;
+    UseCaseOperation operation;
+};
+
+constexpr NamedOperation OPERATIONS[]{
+    {"GetBooksPage", GetBooksPage},         {"FindAuthorByName", FindAuthorByName},
+    {"GetBooksByAuthor", GetBooksByAuthor}, {"SearchBooks", SearchBooks},
+    {"GetBooksByTags", GetBooksByTags},     {"EditBook", EditBook},
+    {"EditAuthorCommand", EditAuthorCommand},
+};
+
+// Каталог из book_count книг: у каждого автора BOOKS_PER_AUTHOR книг
+CatalogSample GenerateCatalog(int book_count) {
+    const int author_count = book_count / BOOKS_PER_AUTHOR;
+    CatalogSample catalog;
+    catalog.authors.reserve(author_count);
+    catalog.books.reserve(book_count);
+    for (int i = 0; i < author_count; ++i) {
+        const auto& author = catalog.authors.emplace_back(domain::AuthorId::New(), "Author " + std::to_string(i));
+        for (int j = 0; j < BOOKS_PER_AUTHOR; ++j) {
+            const int tag = (i * BOOKS_PER_AUTHOR + j) % TAG_COUNT;
+            catalog.books.emplace_back(domain::BookId::New(), author.GetId(),
+                                       author.GetName() + " book " + std::to_string(j), 1900 + j,
+                                       domain::Tags{"tag " + std::to_string(tag),
+                                                    "tag " + std::to_string((tag + 1) % TAG_COUNT),
+                                                    "tag " + std::to_string((tag + 2) % TAG_COUNT)},
+                                       author.GetName());
+        }
+    }
+    return catalog;
+}
+
+// --- Сценарии с репозиториями-заглушками: стоимость слоя сценариев без хранилища ---
+
+struct MockCatalog {
+    explicit MockCatalog(int book_count) {
+        auto catalog = GenerateCatalog(book_count);
+        for (const auto& author : catalog.authors) {
+            authors.Save(author);
+        }
+        books.AddBooks(catalog.books);
+    }
+
+    mocks::MockAuthorRepository authors;
+    mocks::MockBookRepository books;
+    mocks::MockUnitOfWorkFactory factory{authors, books};
+};
+
+void BM_MockUseCase(benchmark::State& state, UseCaseOperation operation) {
+    MockCatalog catalog{static_cast<int>(state.range(0))};
+    app::UseCasesImpl use_cases{catalog.factory};
+    const auto sample = TakeSample(use_cases);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        operation(use_cases, sample, i++);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// --- Сценарии с хранилищем в памяти: индексы и транзакции без сервера, нижняя граница стоимости хранилища ---
+
+// transactions — сколько транзакций в среднем открывает одна операция
+void BM_MemoryUseCase(benchmark::State& state, UseCaseOperation operation) {
+    memory::Database database;
+    {
+        const auto catalog = GenerateCatalog(static_cast<int>(state.range(0)));
+        auto uow = database.GetUnitOfWork();
+        for (const auto& author : catalog.authors) {
+            uow->Authors().Save(author);
+        }
+        uow->Books().AddBooks(catalog.books);
+        uow->Commit();
+    }
+    app::UseCasesImpl use_cases{database};
+    const auto sample = TakeSample(use_cases);
+
+    const size_t first_transaction = database.GetTransactionCount();
+    size_t i = 0;
+    for (auto _ : state) {
+        operation(use_cases, sample, i++);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["transactions"] = benchmark::Counter(
+        static_cast<double>(database.GetTransactionCount() - first_transaction), benchmark::Counter::kAvgIterations);
+}
+
+// --- Сценарии со встроенным хранилищем: чтение из отображённого сегмента и журнал с fdatasync ---
+
+// Каталог переносится в сегмент и открывается заново, поэтому чтения идут из отображённого файла.
+// syncs — сколько раз в среднем за операцию журнал сохраняется на диск
+void BM_EmbeddedUseCase(benchmark::State& state, UseCaseOperation operation) {
+    const auto directory = std::filesystem::temp_directory_path() / "bookypedia-bench-embedded";
+    std::filesystem::remove_all(directory);
+    {
+        embedded::Database database{{directory}};
+        const auto catalog = GenerateCatalog(static_cast<int>(state.range(0)));
+        auto uow = database.GetBatchUnitOfWork();
+        for (const auto& author : catalog.authors) {
+            uow->Authors().Save(author);
+        }
+        uow->Books().AddBooks(catalog.books);
+        uow->Commit();
+    }
+
+    {
+        embedded::Database database{{directory}};
+        app::UseCasesImpl use_cases{database};
+        const auto sample = TakeSample(use_cases);
+
+        const size_t first_sync = database.GetSyncCount();
+        size_t i = 0;
+        for (auto _ : state) {
+            operation(use_cases, sample, i++);
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.counters["syncs"] = benchmark::Counter(static_cast<double>(database.GetSyncCount() - first_sync),
+                                                     benchmark::Counter::kAvgIterations);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+// --- Сценарии с Postgres ---
+
+// Каталог из book_count книг, устроенный так же, как MockCatalog
+std::optional<pqxx::connection> ConnectToBookCatalog(benchmark::State& state, int book_count) {
+    return bench::ConnectToCatalog(state, "books " + std::to_string(book_count), [book_count](pqxx::work& work) {
+        work.exec_params(R"(
+INSERT INTO authors (id, name)
+SELECT gen_random_uuid(), 'Author ' || i
+FROM generate_series(0, $1 - 1) AS i;
+)"_zv,
+                         book_count / BOOKS_PER_AUTHOR);
+        work.exec_params(R"(
+INSERT INTO books (id, author_id, title, publication_year)
+SELECT gen_random_uuid(), a.id, a.name || ' book ' || j, 1900 + j
+FROM authors a, generate_series(0, $1 - 1) AS j;
+)"_zv,
+                         BOOKS_PER_AUTHOR);
+        work.exec_params(R"(
+INSERT INTO book_tags (book_id, tag)
+SELECT b.id, 'tag ' || (b.n + t) % $1
+FROM (SELECT id, row_number() OVER (ORDER BY id) AS n FROM books) AS b, generate_series(0, 2) AS t;
+)"_zv,
+                         TAG_COUNT);
+    });
+}
+
+// transactions — сколько транзакций в среднем открывает одна операция
+void BM_PostgresUseCase(benchmark::State& state, UseCaseOperation operation) {
+    if (!ConnectToBookCatalog(state, static_cast<int>(state.range(0)))) {
+        return;
+    }
+
+    postgres::Database database{postgres::DatabaseConfig{bench::GetBenchDatabaseUrl(state)}};
+    app::UseCasesImpl use_cases{database};
+    const auto sample = TakeSample(use_cases);
+
+    const size_t first_transaction = database.GetTransactionCount();
+    size_t i = 0;
+    for (auto _ : state) {
+        operation(use_cases, sample, i++);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["transactions"] = benchmark::Counter(
+        static_cast<double>(database.GetTransactionCount() - first_transaction), benchmark::Counter::kAvgIterations);
+}
+
+// Бенчмарки регистрируются по возрастанию размера каталога, а для каждого размера — все операции подряд,
+// так что каждый каталог в Postgres строится один раз
+void RegisterUseCaseBenchmarks(const std::string& family, void (*run)(benchmark::State&, UseCaseOperation),
+                               std::initializer_list<int> book_counts) {
+    for (const int book_count : book_counts) {
+        for (const auto& [name, operation] : OPERATIONS) {
+            benchmark::RegisterBenchmark((family + '/' + name).c_str(), run, operation)
+                ->Arg(book_count)
+                ->Unit(benchmark::kMicrosecond);
+        }
+    }
+}
+
+// Заглушки ищут перебором, поэтому каталог в миллион книг для них не показателен
+const bool use_case_benchmarks_registered = [] {
+    RegisterUseCaseBenchmarks("BM_MockUseCase", BM_MockUseCase, {10'000, 100'000});
+    RegisterUseCaseBenchmarks("BM_MemoryUseCase", BM_MemoryUseCase, {10'000, 100'000, 1'000'000});
+    RegisterUseCaseBenchmarks("BM_EmbeddedUseCase", BM_EmbeddedUseCase, {10'000, 100'000, 1'000'000});
+    RegisterUseCaseBenchmarks("BM_PostgresUseCase", BM_PostgresUseCase, {10'000, 100'000, 1'000'000});
+    return true;
+}();
+
+}  // namespace
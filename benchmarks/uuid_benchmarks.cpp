@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <string>
+#include <vector>
+
+#include "../src/util/tagged_uuid.h"
+
+namespace {
+
+constexpr size_t UUID_COUNT = 1024;
+
+std::vector<util::detail::UUIDType> MakeUUIDs() {
+    std::vector<util::detail::UUIDType> uuids;
+    uuids.reserve(UUID_COUNT);
+    boost::uuids::random_generator generator;
+    for (size_t i = 0; i < UUID_COUNT; ++i) {
+        uuids.push_back(generator());
+    }
+    return uuids;
+}
+
+std::vector<std::string> MakeUUIDStrings() {
+    std::vector<std::string> strings;
+    strings.reserve(UUID_COUNT);
+    for (const auto& uuid : MakeUUIDs()) {
+        strings.push_back(to_string(uuid));
+    }
+    return strings;
+}
+
+// Прежний путь: boost::uuids::string_generator и to_string
+void BM_BoostUUIDFromString(benchmark::State& state) {
+    const auto strings = MakeUUIDStrings();
+    boost::uuids::string_generator generator;
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& str = strings[i++ % UUID_COUNT];
+        benchmark::DoNotOptimize(generator(str.begin(), str.end()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BoostUUIDFromString);
+
+void BM_UUIDFromString(benchmark::State& state) {
+    const auto strings = MakeUUIDStrings();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(util::detail::UUIDFromString(strings[i++ % UUID_COUNT]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UUIDFromString);
+
+void BM_BoostUUIDToString(benchmark::State& state) {
+    const auto uuids = MakeUUIDs();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(to_string(uuids[i++ % UUID_COUNT]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BoostUUIDToString);
+
+void BM_UUIDToString(benchmark::State& state) {
+    const auto uuids = MakeUUIDs();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(util::detail::UUIDToString(uuids[i++ % UUID_COUNT]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UUIDToString);
+
+// Без выделения памяти под строку: так идентификаторы пишутся в готовый буфер
+void BM_UUIDToChars(benchmark::State& state) {
+    const auto uuids = MakeUUIDs();
+    char buffer[util::detail::UUID_TEXT_SIZE];
+    size_t i = 0;
+    for (auto _ : state) {
+        util::detail::UUIDToChars(uuids[i++ % UUID_COUNT], buffer);
+        benchmark::DoNotOptimize(buffer);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UUIDToChars);
+
+struct BenchmarkTag {};
+using BenchmarkId = util::TaggedUUID<BenchmarkTag>;
+
+// Разбор и печать через TaggedUUID, как их выполняют репозитории и View
+void BM_TaggedUUIDFromString(benchmark::State& state) {
+    const auto strings = MakeUUIDStrings();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(BenchmarkId::FromString(strings[i++ % UUID_COUNT]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TaggedUUIDFromString);
+
+void BM_TaggedUUIDToString(benchmark::State& state) {
+    const auto strings = MakeUUIDStrings();
+    std::vector<BenchmarkId> ids;
+    ids.reserve(UUID_COUNT);
+    for (const auto& str : strings) {
+        ids.push_back(BenchmarkId::FromString(str));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ids[i++ % UUID_COUNT].ToString());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TaggedUUIDToString);
+
+
+// Прежний путь генерации: новый генератор, засеваемый из ОС, на каждый идентификатор
+void BM_BoostNewUUID(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(boost::uuids::random_generator()());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BoostNewUUID)->ThreadRange(1, 8)->UseRealTime();
+
+// items_per_second при нескольких потоках — суммарная скорость; делённая на число потоков — скорость на ядро
+void BM_NewUUID(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(util::detail::NewUUID());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NewUUID)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_NewUUIDs(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(util::detail::NewUUIDs(count));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_NewUUIDs)->RangeMultiplier(16)->Range(16, 4096)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_NewTimeOrderedUUID(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(util::detail::NewTimeOrderedUUID());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NewTimeOrderedUUID)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace
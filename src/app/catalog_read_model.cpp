@@ -0,0 +1,412 @@
+#include "catalog_read_model.h"
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+
+#include "../util/words.h"
+
+namespace app {
+using namespace domain;
+
+namespace {
+
+// Модели, чьи команды выполняет сейчас этот поток
+thread_local std::vector<const CatalogReadModel*> running_commands;
+
+Books SelectBooks(const Books& books, const CatalogSnapshot::Positions& positions) {
+    Books result;
+    result.reserve(positions.size());
+    for (size_t position : positions) {
+        result.push_back(books[position]);
+    }
+    return result;
+}
+
+// Страница из limit элементов, следующих за ключом after. Позиция ключа ищется по id, а если этого
+// элемента в снимке уже нет — сравнением с ключом (порядок строк в БД может немного отличаться)
+template <typename Items, typename Key, typename PositionById, typename IsAfter>
+Items SelectPage(const Items& items, const std::optional<Key>& after, size_t limit,
+                 const PositionById& position_by_id, IsAfter is_after) {
+    auto first = items.begin();
+    if (after) {
+        if (auto it = position_by_id.find(after->id); it != position_by_id.end()) {
+            first = items.begin() + it->second + 1;
+        } else {
+            first = std::find_if(items.begin(), items.end(), [&](const auto& item) {
+                return is_after(item, *after);
+            });
+        }
+    }
+    const auto count = std::min<size_t>(limit, items.end() - first);
+    return Items(first, first + count);
+}
+
+void IndexWords(std::map<std::string, CatalogSnapshot::Positions, std::less<>>& index, std::string_view text,
+                size_t position) {
+    for (auto& word : util::SplitWords(text)) {
+        auto& positions = index[std::move(word)];
+        if (positions.empty() || positions.back() != position) {
+            positions.push_back(position);
+        }
+    }
+}
+
+// Упорядоченные позиции, у которых каждое слово начинается одним из words
+CatalogSnapshot::Positions MatchAllWords(const std::map<std::string, CatalogSnapshot::Positions, std::less<>>& index,
+                                         const std::vector<std::string>& words) {
+    CatalogSnapshot::Positions result;
+    for (size_t i = 0; i < words.size(); ++i) {
+        CatalogSnapshot::Positions matches;
+        for (auto it = index.lower_bound(words[i]); it != index.end() && it->first.starts_with(words[i]); ++it) {
+            matches.insert(matches.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+
+        if (i == 0) {
+            result = std::move(matches);
+        } else {
+            CatalogSnapshot::Positions both;
+            std::set_intersection(result.begin(), result.end(), matches.begin(), matches.end(),
+                                  std::back_inserter(both));
+            result = std::move(both);
+        }
+        if (result.empty()) {
+            break;
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+std::shared_ptr<const CatalogSnapshot> CatalogSnapshot::Load(ReadOnlyUnitOfWork& uow) {
+    auto snapshot = std::make_shared<CatalogSnapshot>();
+    snapshot->authors = uow.Authors().GetAllAuthors();
+    snapshot->books = uow.Books().GetAllBooks();
+
+    for (size_t i = 0; i < snapshot->authors.size(); ++i) {
+        const auto& author = snapshot->authors[i];
+        snapshot->author_by_id.emplace(author.GetId(), i);
+        snapshot->author_by_name.emplace(author.GetName(), i);
+        IndexWords(snapshot->authors_by_name_word, author.GetName(), i);
+    }
+
+    for (size_t i = 0; i < snapshot->books.size(); ++i) {
+        const auto& book = snapshot->books[i];
+        snapshot->book_by_id.emplace(book.GetBookId(), i);
+        snapshot->books_by_author[book.GetAuthorId()].push_back(i);
+        snapshot->books_by_title[book.GetTitle()].push_back(i);
+        IndexWords(snapshot->books_by_title_word, book.GetTitle(), i);
+        for (const auto& tag : book.GetTags()) {
+            snapshot->books_by_tag[tag].push_back(i);
+        }
+    }
+
+    const auto& books = snapshot->books;
+    for (auto& [author_id, positions] : snapshot->books_by_author) {
+        std::stable_sort(positions.begin(), positions.end(), [&books](size_t lhs, size_t rhs) {
+            return std::make_pair(books[lhs].GetPublicationYear(), std::cref(books[lhs].GetTitle())) <
+                   std::make_pair(books[rhs].GetPublicationYear(), std::cref(books[rhs].GetTitle()));
+        });
+    }
+    for (auto& [title, positions] : snapshot->books_by_title) {
+        std::stable_sort(positions.begin(), positions.end(), [&books](size_t lhs, size_t rhs) {
+            return books[lhs].GetPublicationYear() < books[rhs].GetPublicationYear();
+        });
+    }
+
+    return snapshot;
+}
+
+CatalogReadModel::CatalogReadModel(UseCases& use_cases, UnitOfWorkFactory& unit_factory)
+    : use_cases_{use_cases}, unit_factory_{unit_factory} {
+    Refresh();
+}
+
+void CatalogReadModel::Refresh() {
+    std::lock_guard lock{refresh_mutex_};
+    LoadSnapshot();
+}
+
+void CatalogReadModel::LoadSnapshot() {
+    // Перестроения выполняются по очереди под refresh_mutex_, поэтому последним публикуется снимок,
+    // прочитанный после всех уже зафиксированных изменений. Счётчик берётся до чтения: изменение
+    // засчитывается после фиксации, поэтому снимок видит все изменения, которые он покрывает.
+    // Снимок читается через пишущую единицу работы: она не попадает на отстающую реплику
+    const auto changes = changes_.load();
+    auto uow = unit_factory_.GetUnitOfWork();
+    snapshot_.store(CatalogSnapshot::Load(*uow));
+    snapshot_changes_ = changes;
+}
+
+void CatalogReadModel::OnChange() {
+    if (IsRunningCommand()) {
+        return;
+    }
+    const auto change = ++changes_;
+    std::lock_guard lock{refresh_mutex_};
+    // Снимок, прочитанный другим потоком после этого изменения, уже его содержит
+    if (snapshot_changes_ < change) {
+        LoadSnapshot();
+    }
+}
+
+bool CatalogReadModel::IsRunningCommand() const {
+    return std::find(running_commands.begin(), running_commands.end(), this) != running_commands.end();
+}
+
+std::shared_ptr<const CatalogSnapshot> CatalogReadModel::GetSnapshot() const {
+    return snapshot_.load();
+}
+
+void CatalogReadModel::AddAuthor(const std::string& name) {
+    use_cases_.AddAuthor(name);
+    OnChange();
+}
+
+void CatalogReadModel::AddAuthorWithId(const domain::AuthorId& id, const std::string& name) {
+    use_cases_.AddAuthorWithId(id, name);
+    OnChange();
+}
+
+void CatalogReadModel::DeleteAuthor(const domain::AuthorId& id) {
+    use_cases_.DeleteAuthor(id);
+    OnChange();
+}
+
+void CatalogReadModel::EditAuthor(const domain::AuthorId& id, const std::string& new_name) {
+    use_cases_.EditAuthor(id, new_name);
+    OnChange();
+}
+
+domain::Authors CatalogReadModel::GetAllAuthors() {
+    if (IsRunningCommand()) {
+        return use_cases_.GetAllAuthors();
+    }
+    return GetSnapshot()->authors;
+}
+
+domain::Authors CatalogReadModel::GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) {
+    if (IsRunningCommand()) {
+        return use_cases_.GetAuthorsPage(after, limit);
+    }
+    const auto snapshot = GetSnapshot();
+    return SelectPage(snapshot->authors, after, limit, snapshot->author_by_id,
+                      [](const Author& author, const AuthorsPageKey& key) {
+                          return std::tie(author.GetName(), *author.GetId()) > std::tie(key.name, *key.id);
+                      });
+}
+
+void CatalogReadModel::ForEachAuthor(const domain::AuthorVisitor& visitor) {
+    if (IsRunningCommand()) {
+        return use_cases_.ForEachAuthor(visitor);
+    }
+    const auto snapshot = GetSnapshot();
+    std::for_each(snapshot->authors.begin(), snapshot->authors.end(), visitor);
+}
+
+std::optional<domain::Author> CatalogReadModel::FindAuthorById(const domain::AuthorId& id) {
+    if (IsRunningCommand()) {
+        return use_cases_.FindAuthorById(id);
+    }
+    const auto snapshot = GetSnapshot();
+    if (auto it = snapshot->author_by_id.find(id); it != snapshot->author_by_id.end()) {
+        return snapshot->authors[it->second];
+    }
+    return std::nullopt;
+}
+
+std::optional<domain::Author> CatalogReadModel::FindAuthorByName(const std::string& name) {
+    if (IsRunningCommand()) {
+        return use_cases_.FindAuthorByName(name);
+    }
+    const auto snapshot = GetSnapshot();
+    if (auto it = snapshot->author_by_name.find(name); it != snapshot->author_by_name.end()) {
+        return snapshot->authors[it->second];
+    }
+    return std::nullopt;
+}
+
+void CatalogReadModel::AddBook(const domain::AuthorId& author_id, const std::string& title, int publication_year,
+                               domain::Tags tags, const std::string& author_name) {
+    use_cases_.AddBook(author_id, title, publication_year, std::move(tags), author_name);
+    OnChange();
+}
+
+void CatalogReadModel::DeleteBook(const domain::BookId& id) {
+    use_cases_.DeleteBook(id);
+    OnChange();
+}
+
+void CatalogReadModel::EditBook(const domain::BookId& id, const std::string& title, int publication_year,
+                                const domain::Tags& tags) {
+    use_cases_.EditBook(id, title, publication_year, tags);
+    OnChange();
+}
+
+// Импорт фиксирует книги частями, поэтому и после ошибки часть из них может оказаться в каталоге
+ImportResult CatalogReadModel::ImportBooks(const std::vector<ImportedBook>& books) {
+    ImportResult result;
+    try {
+        result = use_cases_.ImportBooks(books);
+    } catch (...) {
+        OnChange();
+        throw;
+    }
+    OnChange();
+    return result;
+}
+
+std::vector<BatchResult> CatalogReadModel::ExecuteBatch(const std::vector<BatchOperation>& operations) {
+    std::vector<BatchResult> results;
+    try {
+        results = use_cases_.ExecuteBatch(operations);
+    } catch (...) {
+        OnChange();
+        throw;
+    }
+    OnChange();
+    return results;
+}
+
+void CatalogReadModel::RunCommand(const std::function<void()>& command) {
+    running_commands.push_back(this);
+    try {
+        use_cases_.RunCommand(command);
+    } catch (...) {
+        running_commands.pop_back();
+        throw;
+    }
+    running_commands.pop_back();
+    OnChange();
+}
+
+// Выгрузка читает хранилище, а не снимок модели: ей нужны все строки в одной согласованной версии
+ExportResult CatalogReadModel::ExportCatalog(size_t parts, const ExportSinkFactory& make_sink) {
+    return use_cases_.ExportCatalog(parts, make_sink);
+}
+
+domain::Books CatalogReadModel::GetAllBooks() {
+    if (IsRunningCommand()) {
+        return use_cases_.GetAllBooks();
+    }
+    return GetSnapshot()->books;
+}
+
+domain::Books CatalogReadModel::GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) {
+    if (IsRunningCommand()) {
+        return use_cases_.GetBooksPage(after, limit);
+    }
+    const auto snapshot = GetSnapshot();
+    return SelectPage(snapshot->books, after, limit, snapshot->book_by_id,
+                      [](const Book& book, const BooksPageKey& key) {
+                          return std::tie(book.GetTitle(), *book.GetBookId()) > std::tie(key.title, *key.id);
+                      });
+}
+
+void CatalogReadModel::ForEachBook(const domain::BookVisitor& visitor) {
+    if (IsRunningCommand()) {
+        return use_cases_.ForEachBook(visitor);
+    }
+    const auto snapshot = GetSnapshot();
+    std::for_each(snapshot->books.begin(), snapshot->books.end(), visitor);
+}
+
+domain::Books CatalogReadModel::GetBooksByAuthor(const domain::AuthorId& author_id) {
+    if (IsRunningCommand()) {
+        return use_cases_.GetBooksByAuthor(author_id);
+    }
+    const auto snapshot = GetSnapshot();
+    if (auto it = snapshot->books_by_author.find(author_id); it != snapshot->books_by_author.end()) {
+        return SelectBooks(snapshot->books, it->second);
+    }
+    return {};
+}
+
+domain::Books CatalogReadModel::GetBooksByTitle(const std::string& title) {
+    if (IsRunningCommand()) {
+        return use_cases_.GetBooksByTitle(title);
+    }
+    const auto snapshot = GetSnapshot();
+    if (auto it = snapshot->books_by_title.find(title); it != snapshot->books_by_title.end()) {
+        return SelectBooks(snapshot->books, it->second);
+    }
+    return {};
+}
+
+domain::Books CatalogReadModel::GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                              const std::optional<domain::BooksPageKey>& after, size_t limit) {
+    if (IsRunningCommand()) {
+        return use_cases_.GetBooksByTags(tags, match, after, limit);
+    }
+    const auto snapshot = GetSnapshot();
+
+    CatalogSnapshot::Positions positions;
+    for (size_t i = 0; i < tags.size(); ++i) {
+        static const CatalogSnapshot::Positions no_books;
+        const auto it = snapshot->books_by_tag.find(tags[i]);
+        const auto& tag_books = it != snapshot->books_by_tag.end() ? it->second : no_books;
+
+        CatalogSnapshot::Positions merged;
+        if (i == 0) {
+            merged = tag_books;
+        } else if (match == TagMatch::All) {
+            std::set_intersection(positions.begin(), positions.end(), tag_books.begin(), tag_books.end(),
+                                  std::back_inserter(merged));
+        } else {
+            std::set_union(positions.begin(), positions.end(), tag_books.begin(), tag_books.end(),
+                           std::back_inserter(merged));
+        }
+        positions = std::move(merged);
+    }
+
+    const auto& books = snapshot->books;
+    auto first = positions.begin();
+    if (after) {
+        first = std::find_if(positions.begin(), positions.end(), [&books, &after](size_t position) {
+            return std::tie(books[position].GetTitle(), *books[position].GetBookId()) >
+                   std::tie(after->title, *after->id);
+        });
+    }
+    const auto count = std::min<size_t>(limit, positions.end() - first);
+    return SelectBooks(books, CatalogSnapshot::Positions(first, first + count));
+}
+
+// Ранжирование упрощено по сравнению с Postgres: после точных совпадений названия идут совпадения
+// по названию, затем по автору, внутри групп — в порядке выдачи каталога
+domain::Books CatalogReadModel::SearchBooks(const std::string& query, size_t limit) {
+    if (IsRunningCommand()) {
+        return use_cases_.SearchBooks(query, limit);
+    }
+    const auto snapshot = GetSnapshot();
+    const auto words = util::SplitWords(query);
+    if (words.empty()) {
+        return {};
+    }
+
+    const auto title_matches = MatchAllWords(snapshot->books_by_title_word, words);
+    CatalogSnapshot::Positions author_matches;
+    for (size_t author_position : MatchAllWords(snapshot->authors_by_name_word, words)) {
+        const auto& author_id = snapshot->authors[author_position].GetId();
+        if (auto it = snapshot->books_by_author.find(author_id); it != snapshot->books_by_author.end()) {
+            author_matches.insert(author_matches.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(author_matches.begin(), author_matches.end());
+
+    CatalogSnapshot::Positions exact;
+    CatalogSnapshot::Positions positions;
+    for (size_t position : title_matches) {
+        (snapshot->books[position].GetTitle() == query ? exact : positions).push_back(position);
+    }
+    std::set_difference(author_matches.begin(), author_matches.end(), title_matches.begin(), title_matches.end(),
+                        std::back_inserter(positions));
+    positions.insert(positions.begin(), exact.begin(), exact.end());
+
+    positions.resize(std::min(positions.size(), limit));
+    return SelectBooks(snapshot->books, positions);
+}
+
+}  // namespace app
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <boost/uuid/uuid_hash.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+#include "unit_of_work.h"
+#include "use_cases.h"
+
+namespace app {
+
+// Неизменяемый снимок каталога с индексами, повторяющими порядок выдачи репозиториев
+struct CatalogSnapshot {
+    using Positions = std::vector<size_t>;
+
+    static std::shared_ptr<const CatalogSnapshot> Load(ReadOnlyUnitOfWork& uow);
+
+    domain::Authors authors;
+    domain::Books books;
+    std::unordered_map<domain::AuthorId, size_t, util::TaggedHasher<domain::AuthorId>> author_by_id;
+    std::unordered_map<std::string, size_t> author_by_name;
+    std::unordered_map<domain::BookId, size_t, util::TaggedHasher<domain::BookId>> book_by_id;
+    std::unordered_map<domain::AuthorId, Positions, util::TaggedHasher<domain::AuthorId>> books_by_author;
+    std::unordered_map<std::string, Positions> books_by_title;
+    // Позиции книг по возрастанию, то есть в порядке (title, id)
+    std::unordered_map<std::string, Positions> books_by_tag;
+    // Слова названий и имён в нижнем регистре; упорядочены для поиска по префиксу
+    std::map<std::string, Positions, std::less<>> books_by_title_word;
+    std::map<std::string, Positions, std::less<>> authors_by_name_word;
+};
+
+// Сценарии использования, читающие каталог из памяти. Изменения передаются в use_cases, после чего снимок
+// перечитывается и атомарно подменяется в том же потоке. Читатели только берут копию указателя на снимок
+// и не ждут; одновременные изменения ждут друг друга, и одно перечитывание может покрыть несколько из них.
+// Модель видит только изменения, сделанные через неё саму
+class CatalogReadModel : public UseCases {
+public:
+    CatalogReadModel(UseCases& use_cases, UnitOfWorkFactory& unit_factory);
+
+    void AddAuthor(const std::string& name) override;
+    void AddAuthorWithId(const domain::AuthorId& id, const std::string& name) override;
+    void DeleteAuthor(const domain::AuthorId& id) override;
+    void EditAuthor(const domain::AuthorId& id, const std::string& new_name) override;
+
+    domain::Authors GetAllAuthors() override;
+    domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) override;
+    void ForEachAuthor(const domain::AuthorVisitor& visitor) override;
+    std::optional<domain::Author> FindAuthorById(const domain::AuthorId& id) override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+
+    void AddBook(const domain::AuthorId& author_id, const std::string& title, int publication_year, domain::Tags tags,
+                 const std::string& author_name) override;
+    void DeleteBook(const domain::BookId& id) override;
+    void EditBook(const domain::BookId& id, const std::string& title, int publication_year,
+                  const domain::Tags& tags) override;
+
+    ImportResult ImportBooks(const std::vector<ImportedBook>& books) override;
+    ExportResult ExportCatalog(size_t parts, const ExportSinkFactory& make_sink) override;
+    std::vector<BatchResult> ExecuteBatch(const std::vector<BatchOperation>& operations) override;
+    // Снимок перечитывается после завершения команды. Пока команда идёт, чтения вызвавшего её потока
+    // передаются в use_cases и видят изменения команды
+    void RunCommand(const std::function<void()>& command) override;
+
+    domain::Books GetAllBooks() override;
+    domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) override;
+    void ForEachBook(const domain::BookVisitor& visitor) override;
+
+    domain::Books GetBooksByAuthor(const domain::AuthorId& author_id) override;
+    domain::Books GetBooksByTitle(const std::string& title) override;
+    domain::Books SearchBooks(const std::string& query, size_t limit) override;
+    domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                 const std::optional<domain::BooksPageKey>& after, size_t limit) override;
+
+    // Перечитывает снимок, даже если после него не было изменений
+    void Refresh();
+
+private:
+    std::shared_ptr<const CatalogSnapshot> GetSnapshot() const;
+    void LoadSnapshot();
+    // Перечитывает снимок после зафиксированного изменения, если этого ещё не сделал другой поток
+    void OnChange();
+    bool IsRunningCommand() const;
+
+    UseCases& use_cases_;
+    UnitOfWorkFactory& unit_factory_;
+    std::mutex refresh_mutex_;
+    std::atomic<std::shared_ptr<const CatalogSnapshot>> snapshot_;
+    // Число изменений через модель и то, после скольких из них прочитан текущий снимок.
+    // snapshot_changes_ меняется только под refresh_mutex_
+    std::atomic<uint64_t> changes_ = 0;
+    uint64_t snapshot_changes_ = 0;
+};
+
+}  // namespace app
@@ -0,0 +1,142 @@
+#include "grouped_unit_of_work.h"
+
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace app {
+
+// Единица работы сценария внутри группы: Commit только засчитывается группе. Изменения единицы работы
+// с точкой сохранения без Commit откатываются к ней, остальные — вместе с группой
+class GroupedUnitOfWorkFactory::MemberUnitOfWork : public UnitOfWork {
+public:
+    MemberUnitOfWork(GroupedUnitOfWorkFactory& owner, UnitOfWork& group, bool savepoint)
+        : owner_{owner}, group_{group}, uncaught_exceptions_{std::uncaught_exceptions()}, savepoint_{savepoint} {}
+
+    ~MemberUnitOfWork() override {
+        if (committed_) {
+            return;
+        }
+        if (savepoint_) {
+            try {
+                group_.RollbackToSavepoint();
+                return;
+            } catch (const std::exception&) {
+                // Транзакция группы прервана, и изменения других сценариев в ней тоже потеряны
+            }
+            owner_.OnMemberFailure();
+        } else if (std::uncaught_exceptions() > uncaught_exceptions_) {
+            // Единица работы закрывается при раскрутке стека: транзакция группы могла прерваться
+            owner_.OnMemberFailure();
+        }
+    }
+
+    domain::AuthorRepository& Authors() override {
+        return group_.Authors();
+    }
+
+    domain::BookRepository& Books() override {
+        return group_.Books();
+    }
+
+    void Commit() override {
+        // Точка сохранения снимается до того, как группа может зафиксироваться и закрыться
+        if (savepoint_) {
+            group_.ReleaseSavepoint();
+            savepoint_ = false;
+        }
+        committed_ = true;
+        owner_.OnMemberCommit();
+    }
+
+    void SetSavepoint() override {
+        group_.SetSavepoint();
+    }
+
+    void ReleaseSavepoint() override {
+        group_.ReleaseSavepoint();
+    }
+
+    void RollbackToSavepoint() override {
+        group_.RollbackToSavepoint();
+    }
+
+    void BeginBatchOperation(size_t index) override {
+        group_.BeginBatchOperation(index);
+    }
+
+private:
+    GroupedUnitOfWorkFactory& owner_;
+    UnitOfWork& group_;
+    int uncaught_exceptions_;
+    bool savepoint_;
+    bool committed_ = false;
+};
+
+GroupedUnitOfWorkFactory::GroupedUnitOfWorkFactory(UnitOfWorkFactory& factory, size_t group_size,
+                                                   FailureScope failure_scope)
+    : factory_{factory}, group_size_{group_size}, failure_scope_{failure_scope} {
+    if (group_size == 0) {
+        throw std::invalid_argument("Transaction group size must be positive");
+    }
+}
+
+GroupedUnitOfWorkFactory::~GroupedUnitOfWorkFactory() = default;
+
+UnitOfWorkPtr GroupedUnitOfWorkFactory::GetUnitOfWork() {
+    return GetMember(failure_scope_ == FailureScope::Member);
+}
+
+UnitOfWorkPtr GroupedUnitOfWorkFactory::GetBatchUnitOfWork() {
+    return GetMember(failure_scope_ == FailureScope::Member);
+}
+
+// Чтение ничего не меняет, поэтому обходится без точки сохранения
+ReadOnlyUnitOfWorkPtr GroupedUnitOfWorkFactory::GetReadOnlyUnitOfWork() {
+    return GetMember(false);
+}
+
+std::vector<ReadOnlyUnitOfWorkPtr> GroupedUnitOfWorkFactory::GetSnapshotUnitsOfWork(size_t count) {
+    Flush();
+    return factory_.GetSnapshotUnitsOfWork(count);
+}
+
+void GroupedUnitOfWorkFactory::Flush() {
+    if (!group_) {
+        return;
+    }
+    // Если фиксация не удалась, группа всё равно закрывается: её транзакция уже прервана
+    auto group = std::move(group_);
+    const size_t pending = std::exchange(pending_, 0);
+    try {
+        group->Commit();
+    } catch (...) {
+        stats_.rolled_back += pending;
+        throw;
+    }
+    ++stats_.transactions;
+    stats_.commits += pending;
+}
+
+UnitOfWorkPtr GroupedUnitOfWorkFactory::GetMember(bool savepoint) {
+    if (!group_) {
+        group_ = factory_.GetUnitOfWork();
+    }
+    if (savepoint) {
+        group_->SetSavepoint();
+    }
+    return std::make_unique<MemberUnitOfWork>(*this, *group_, savepoint);
+}
+
+void GroupedUnitOfWorkFactory::OnMemberCommit() {
+    if (++pending_ >= group_size_) {
+        Flush();
+    }
+}
+
+void GroupedUnitOfWorkFactory::OnMemberFailure() noexcept {
+    group_.reset();
+    stats_.rolled_back += std::exchange(pending_, 0);
+}
+
+}  // namespace app
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "unit_of_work.h"
+
+namespace app {
+
+// Объединяет изменения подряд идущих сценариев в одну транзакцию: она фиксируется после каждых group_size
+// вызовов Commit. Пока группа открыта, все единицы работы, в том числе только для чтения, работают в её
+// транзакции и видят её незафиксированные изменения. Единица работы, закрытая без Commit, не оставляет
+// изменений в группе, если на неё поставлена точка сохранения. Фабрика рассчитана на один поток
+class GroupedUnitOfWorkFactory : public UnitOfWorkFactory {
+public:
+    // Что откатывается, если сценарий завершился исключением, пока его единица работы для изменений открыта
+    enum class FailureScope {
+        // Только изменения этого сценария: каждая единица работы для изменений ставит точку сохранения
+        // в транзакции группы, что стоит хранилищу лишних запросов
+        Member,
+        // Вся незафиксированная группа, включая уже засчитанные ей изменения других сценариев
+        Group,
+    };
+
+    struct Stats {
+        // Зафиксированные транзакции
+        size_t transactions = 0;
+        // Засчитанные группе изменения сценариев: зафиксированные и потерянные вместе с ней
+        size_t commits = 0;
+        size_t rolled_back = 0;
+    };
+
+    GroupedUnitOfWorkFactory(UnitOfWorkFactory& factory, size_t group_size,
+                             FailureScope failure_scope = FailureScope::Member);
+    // Незафиксированная группа откатывается
+    ~GroupedUnitOfWorkFactory() override;
+
+    UnitOfWorkPtr GetUnitOfWork() override;
+    UnitOfWorkPtr GetBatchUnitOfWork() override;
+    ReadOnlyUnitOfWorkPtr GetReadOnlyUnitOfWork() override;
+    // Снимок видит только зафиксированные данные, поэтому открытая группа сначала фиксируется
+    std::vector<ReadOnlyUnitOfWorkPtr> GetSnapshotUnitsOfWork(size_t count) override;
+
+    // Фиксирует открытую группу, не дожидаясь group_size изменений
+    void Flush();
+
+    const Stats& GetStats() const noexcept {
+        return stats_;
+    }
+
+private:
+    class MemberUnitOfWork;
+
+    UnitOfWorkPtr GetMember(bool savepoint);
+    void OnMemberCommit();
+    void OnMemberFailure() noexcept;
+
+    UnitOfWorkFactory& factory_;
+    size_t group_size_;
+    FailureScope failure_scope_;
+    UnitOfWorkPtr group_;
+    // Изменения сценариев в открытой группе
+    size_t pending_ = 0;
+    Stats stats_;
+};
+
+}  // namespace app
@@ -1,25 +1,68 @@
 #pragma once
 
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "../domain/author_fwd.h"
 #include "../domain/book_fwd.h"
 
 namespace app {
 
-class UnitOfWork {
+// Единица работы только для чтения: изменения через неё не фиксируются
+class ReadOnlyUnitOfWork {
 public:
     virtual domain::AuthorRepository& Authors() = 0;
     virtual domain::BookRepository& Books() = 0;
+    virtual ~ReadOnlyUnitOfWork() = default;
+};
+
+// Ошибка операции пакета ExecuteBatch с номером index. Исходное исключение, например domain::AuthorExistsError,
+// вложено в неё (std::throw_with_nested) и достаётся через std::rethrow_if_nested
+class BatchOperationError : public std::runtime_error {
+public:
+    BatchOperationError(size_t index, const std::string& reason)
+        : std::runtime_error{"Batch operation " + std::to_string(index) + " failed: " + reason}, index_{index} {}
+
+    size_t GetIndex() const noexcept {
+        return index_;
+    }
+
+private:
+    size_t index_;
+};
+
+class UnitOfWork : public ReadOnlyUnitOfWork {
+public:
     virtual void Commit() = 0;
-    virtual ~UnitOfWork() = default;
+
+    // Следующие изменения относятся к операции пакета с номером index. Хранилище, которое узнаёт об ошибке
+    // изменения только при следующем чтении или при Commit, бросает тогда BatchOperationError с номером
+    // операции этого изменения. Хранилищам, сообщающим об ошибке сразу, отмечать нечего
+    virtual void BeginBatchOperation([[maybe_unused]] size_t index) {
+    }
+
+    // Точки сохранения внутри транзакции вложены: ReleaseSavepoint и RollbackToSavepoint относятся
+    // к последней установленной и снимают её. Откат отменяет изменения, сделанные после неё
+    virtual void SetSavepoint() = 0;
+    virtual void ReleaseSavepoint() = 0;
+    virtual void RollbackToSavepoint() = 0;
 };
 
+using ReadOnlyUnitOfWorkPtr = std::unique_ptr<ReadOnlyUnitOfWork>;
 using UnitOfWorkPtr = std::unique_ptr<UnitOfWork>;
 
 class UnitOfWorkFactory {
 public:
     virtual UnitOfWorkPtr GetUnitOfWork() = 0;
+    // Единица работы для пакета изменений: хранилище может отправлять их, не дожидаясь ответа на каждое,
+    // поэтому ошибка изменения может проявиться только при следующем чтении или при Commit
+    virtual UnitOfWorkPtr GetBatchUnitOfWork() = 0;
+    virtual ReadOnlyUnitOfWorkPtr GetReadOnlyUnitOfWork() = 0;
+    // Не больше count единиц работы только для чтения, которые видят один и тот же снимок данных,
+    // для параллельного чтения из разных потоков; каждая используется только одним потоком
+    virtual std::vector<ReadOnlyUnitOfWorkPtr> GetSnapshotUnitsOfWork(size_t count) = 0;
     virtual ~UnitOfWorkFactory() = default;
 };
 
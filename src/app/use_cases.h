@@ -1,13 +1,85 @@
 #pragma once
 
+#include <functional>
 #include <optional>
 #include <string>
+#include <variant>
+#include <vector>
 
 #include "../domain/author.h"
 #include "../domain/book.h"
 
 namespace app {
 
+// Книга из импортируемого каталога: автор задан именем и находится или создаётся при импорте
+struct ImportedBook {
+    std::string title;
+    std::string author_name;
+    int publication_year = 0;
+    domain::Tags tags;
+};
+
+struct ImportResult {
+    size_t books = 0;
+    size_t new_authors = 0;
+};
+
+// Таблицы каталога в том виде, в каком их выгружает ExportCatalog
+enum class CatalogTable { Authors, Books, BookTags };
+
+// Возвращает приёмник строк части part таблицы table. Приёмник вызывается только из потока,
+// выгружающего эту часть, но приёмники разных частей работают одновременно
+using ExportSinkFactory = std::function<domain::DumpLineSink(CatalogTable table, size_t part)>;
+
+struct ExportResult {
+    size_t authors = 0;
+    size_t books = 0;
+    size_t book_tags = 0;
+    // Сколько частей выгружено на самом деле: не больше запрошенного
+    size_t parts = 0;
+};
+
+// Операции пакета ExecuteBatch; каждая делает то же, что одноимённый сценарий
+namespace batch {
+
+struct AddAuthor {
+    std::string name;
+};
+
+struct EditAuthor {
+    domain::AuthorId id;
+    std::string new_name;
+};
+
+struct DeleteAuthor {
+    domain::AuthorId id;
+};
+
+struct AddBook {
+    domain::AuthorId author_id;
+    std::string title;
+    int publication_year = 0;
+    domain::Tags tags;
+};
+
+struct EditBook {
+    domain::BookId id;
+    std::string title;
+    int publication_year = 0;
+    domain::Tags tags;
+};
+
+struct DeleteBook {
+    domain::BookId id;
+};
+
+}  // namespace batch
+
+using BatchOperation = std::variant<batch::AddAuthor, batch::EditAuthor, batch::DeleteAuthor, batch::AddBook,
+                                    batch::EditBook, batch::DeleteBook>;
+// Результат операции пакета: id добавленного автора или книги, для остальных операций — std::monostate
+using BatchResult = std::variant<std::monostate, domain::AuthorId, domain::BookId>;
+
 class UseCases {
 public:
     virtual void AddAuthor(const std::string& name) = 0;
@@ -16,6 +88,8 @@ public:
     virtual void EditAuthor(const domain::AuthorId& id, const std::string& new_name) = 0;
 
     virtual domain::Authors GetAllAuthors() = 0;
+    virtual domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) = 0;
+    virtual void ForEachAuthor(const domain::AuthorVisitor& visitor) = 0;
     virtual std::optional<domain::Author> FindAuthorById(const domain::AuthorId& id) = 0;
     virtual std::optional<domain::Author> FindAuthorByName(const std::string& name) = 0;
 
@@ -25,10 +99,29 @@ public:
     virtual void EditBook(const domain::BookId& id, const std::string& title, int publication_year,
                           const domain::Tags& tags) = 0;
 
+    // Добавляет книги и недостающих авторов в одной единице работы
+    virtual ImportResult ImportBooks(const std::vector<ImportedBook>& books) = 0;
+    // Выгружает согласованный снимок каталога: каждая таблица делится на части, которые читаются параллельно
+    virtual ExportResult ExportCatalog(size_t parts, const ExportSinkFactory& make_sink) = 0;
+    // Выполняет операции по порядку в одной единице работы: применяются либо все, либо, при исключении, ни одна.
+    // Возвращает по результату на каждую операцию. Ошибка операции бросается как BatchOperationError
+    // с её номером и вложенным исходным исключением
+    virtual std::vector<BatchResult> ExecuteBatch(const std::vector<BatchOperation>& operations) = 0;
+
+    // Выполняет command так, что все вызовы сценариев внутри неё работают в одной единице работы,
+    // которая фиксируется по завершении command. Если command бросает исключение, её изменения откатываются.
+    // Вложенная команда выполняется в единице работы внешней
+    virtual void RunCommand(const std::function<void()>& command) = 0;
+
     virtual domain::Books GetAllBooks() = 0;
+    virtual domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) = 0;
+    virtual void ForEachBook(const domain::BookVisitor& visitor) = 0;
 
     virtual domain::Books GetBooksByAuthor(const domain::AuthorId& author_id) = 0;
     virtual domain::Books GetBooksByTitle(const std::string& title) = 0;
+    virtual domain::Books SearchBooks(const std::string& query, size_t limit) = 0;
+    virtual domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                         const std::optional<domain::BooksPageKey>& after, size_t limit) = 0;
 
 protected:
     ~UseCases() = default;
@@ -1,89 +1,337 @@
 #include "use_cases_impl.h"
 
+#include <exception>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "../domain/author.h"
 #include "../domain/book.h"
+#include "../util/stats.h"
 
 namespace app {
 using namespace domain;
 
+namespace {
+
+// Команды, выполняемые сейчас этим потоком: чьи это сценарии и в каких единицах работы идёт команда.
+// Сценарии, общие для нескольких потоков, в других потоках работают вне этих команд
+struct RunningCommand {
+    const UseCasesImpl* use_cases;
+    GroupedUnitOfWorkFactory* units;
+};
+
+thread_local std::vector<RunningCommand> running_commands;
+
+// Выполняет операции пакета через репозитории одной единицы работы
+class BatchExecutor {
+public:
+    explicit BatchExecutor(UnitOfWork& uow) : uow_{uow} {}
+
+    BatchResult operator()(const batch::AddAuthor& operation) const {
+        auto id = AuthorId::New();
+        uow_.Authors().Save({id, operation.name});
+        return id;
+    }
+
+    BatchResult operator()(const batch::EditAuthor& operation) const {
+        uow_.Authors().Edit(operation.id, operation.new_name);
+        return {};
+    }
+
+    BatchResult operator()(const batch::DeleteAuthor& operation) const {
+        uow_.Authors().Delete(operation.id);
+        return {};
+    }
+
+    BatchResult operator()(const batch::AddBook& operation) const {
+        auto id = BookId::New();
+        uow_.Books().Save({id, operation.author_id, operation.title, operation.publication_year, operation.tags});
+        return id;
+    }
+
+    BatchResult operator()(const batch::EditBook& operation) const {
+        uow_.Books().EditBook(operation.id, operation.title, operation.publication_year, operation.tags);
+        return {};
+    }
+
+    BatchResult operator()(const batch::DeleteBook& operation) const {
+        uow_.Books().DeleteBook(operation.id);
+        return {};
+    }
+
+private:
+    UnitOfWork& uow_;
+};
+
+}  // namespace
+
 void UseCasesImpl::AddAuthor(const std::string& name) {
-    auto uow = unit_factory_.GetUnitOfWork();
+    BOOKYPEDIA_TIME_OPERATION("UseCases.AddAuthor");
+    auto uow = Units().GetUnitOfWork();
     uow->Authors().Save({AuthorId::New(), name});
     uow->Commit();
 }
 
 void UseCasesImpl::AddAuthorWithId(const domain::AuthorId& id, const std::string& name) {
-    auto uow = unit_factory_.GetUnitOfWork();
+    BOOKYPEDIA_TIME_OPERATION("UseCases.AddAuthorWithId");
+    auto uow = Units().GetUnitOfWork();
     uow->Authors().Save({id, name});
     uow->Commit();
 }
 
 void UseCasesImpl::DeleteAuthor(const domain::AuthorId& id) {
-    auto uow = unit_factory_.GetUnitOfWork();
-    auto books = uow->Books().GetBooksByAuthorId(id);
-    for (const auto& book : books) {
-        uow->Books().DeleteBookTags(book.GetBookId());
-        uow->Books().DeleteBook(book.GetBookId());
-    }
+    BOOKYPEDIA_TIME_OPERATION("UseCases.DeleteAuthor");
+    auto uow = Units().GetUnitOfWork();
     uow->Authors().Delete(id);
     uow->Commit();
 }
 
 void UseCasesImpl::EditAuthor(const domain::AuthorId& id, const std::string& new_name) {
-    auto uow = unit_factory_.GetUnitOfWork();
+    BOOKYPEDIA_TIME_OPERATION("UseCases.EditAuthor");
+    auto uow = Units().GetUnitOfWork();
     uow->Authors().Edit(id, new_name);
     uow->Commit();
 }
 
 domain::Authors UseCasesImpl::GetAllAuthors() {
-    auto uow = unit_factory_.GetUnitOfWork();
-    return uow->Authors().GetAllAuthors();
+    BOOKYPEDIA_TIME_OPERATION("UseCases.GetAllAuthors");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Authors().GetAllAuthors());
+}
+
+domain::Authors UseCasesImpl::GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.GetAuthorsPage");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Authors().GetAuthorsPage(after, limit));
+}
+
+void UseCasesImpl::ForEachAuthor(const domain::AuthorVisitor& visitor) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.ForEachAuthor");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    uow->Authors().ForEachAuthor(visitor);
 }
 
 std::optional<domain::Author> UseCasesImpl::FindAuthorById(const domain::AuthorId& id) {
-    auto uow = unit_factory_.GetUnitOfWork();
-    return uow->Authors().FindAuthorById(id);
+    BOOKYPEDIA_TIME_OPERATION("UseCases.FindAuthorById");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Authors().FindAuthorById(id));
 }
 
 std::optional<domain::Author> UseCasesImpl::FindAuthorByName(const std::string& name) {
-    auto uow = unit_factory_.GetUnitOfWork();
-    return uow->Authors().FindAuthorByName(name);
+    BOOKYPEDIA_TIME_OPERATION("UseCases.FindAuthorByName");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Authors().FindAuthorByName(name));
 }
 
 void UseCasesImpl::AddBook(const domain::AuthorId& author_id, const std::string& title, int publication_year,
                            domain::Tags tags, const std::string& author_name) {
-    auto uow = unit_factory_.GetUnitOfWork();
+    BOOKYPEDIA_TIME_OPERATION("UseCases.AddBook");
+    auto uow = Units().GetUnitOfWork();
     uow->Books().Save({BookId::New(), author_id, title, publication_year, std::move(tags), author_name});
     uow->Commit();
 }
 
 void UseCasesImpl::DeleteBook(const domain::BookId& id) {
-    auto uow = unit_factory_.GetUnitOfWork();
-    uow->Books().DeleteBookTags(id);
+    BOOKYPEDIA_TIME_OPERATION("UseCases.DeleteBook");
+    auto uow = Units().GetUnitOfWork();
     uow->Books().DeleteBook(id);
     uow->Commit();
 }
 
 void UseCasesImpl::EditBook(const domain::BookId& id, const std::string& title, int publication_year,
                             const domain::Tags& tags) {
-    auto uow = unit_factory_.GetUnitOfWork();
+    BOOKYPEDIA_TIME_OPERATION("UseCases.EditBook");
+    auto uow = Units().GetUnitOfWork();
     uow->Books().EditBook(id, title, publication_year, tags);
     uow->Commit();
 }
 
+ImportResult UseCasesImpl::ImportBooks(const std::vector<ImportedBook>& books) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.ImportBooks");
+    if (books.empty()) {
+        return {};
+    }
+    auto uow = Units().GetUnitOfWork();
+
+    // Каждое имя автора разрешается один раз: новые кандидаты получают id, существующие сохраняют свои
+    std::unordered_map<std::string, AuthorId> author_ids;
+    Authors candidates;
+    for (const auto& book : books) {
+        if (author_ids.emplace(book.author_name, AuthorId{}).second) {
+            candidates.emplace_back(AuthorId::New(), book.author_name);
+        }
+    }
+
+    ImportResult result;
+    for (auto& author : uow->Authors().AddMissingAuthors(candidates)) {
+        author_ids[author.GetName()] = author.GetId();
+    }
+    for (const auto& candidate : candidates) {
+        const auto& author_id = author_ids.at(candidate.GetName());
+        // Без этой проверки книги автора, которого репозиторий не вернул, получили бы пустой author_id
+        if (author_id == AuthorId{}) {
+            throw std::runtime_error("Author \"" + candidate.GetName() + "\" was not resolved");
+        }
+        result.new_authors += author_id == candidate.GetId();
+    }
+
+    auto book_ids = BookId::New(books.size());
+    Books new_books;
+    new_books.reserve(books.size());
+    for (size_t i = 0; i < books.size(); ++i) {
+        const auto& book = books[i];
+        new_books.emplace_back(std::move(book_ids[i]), author_ids.at(book.author_name), book.title,
+                               book.publication_year, book.tags, book.author_name);
+    }
+    uow->Books().AddBooks(new_books);
+    uow->Commit();
+
+    result.books = new_books.size();
+    return result;
+}
+
+ExportResult UseCasesImpl::ExportCatalog(size_t parts, const ExportSinkFactory& make_sink) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.ExportCatalog");
+    auto units = Units().GetSnapshotUnitsOfWork(parts);
+    const size_t count = units.size();
+
+    auto export_part = [&units, &make_sink, count](size_t index) {
+        auto& uow = *units[index];
+        const DumpPart part{index, count};
+        ExportResult result;
+        result.authors = uow.Authors().DumpAuthors(part, make_sink(CatalogTable::Authors, index));
+        result.books = uow.Books().DumpBooks(part, make_sink(CatalogTable::Books, index));
+        result.book_tags = uow.Books().DumpBookTags(part, make_sink(CatalogTable::BookTags, index));
+        return result;
+    };
+
+    // Каждая часть выгружается в своём потоке через свою единицу работы; первая — в текущем
+    std::vector<std::future<ExportResult>> workers;
+    workers.reserve(count);
+    for (size_t index = 1; index < count; ++index) {
+        workers.push_back(std::async(std::launch::async, export_part, index));
+    }
+
+    auto result = export_part(0);
+    for (auto& worker : workers) {
+        const auto part = worker.get();
+        result.authors += part.authors;
+        result.books += part.books;
+        result.book_tags += part.book_tags;
+    }
+    result.parts = count;
+    return result;
+}
+
+std::vector<BatchResult> UseCasesImpl::ExecuteBatch(const std::vector<BatchOperation>& operations) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.ExecuteBatch");
+    if (operations.empty()) {
+        return {};
+    }
+    auto uow = Units().GetBatchUnitOfWork();
+
+    // Ошибка операции сообщается с её номером одинаково для всех хранилищ: те, что узнают о ней позже,
+    // бросают BatchOperationError сами
+    const BatchExecutor executor{*uow};
+    std::vector<BatchResult> results;
+    results.reserve(operations.size());
+    for (size_t i = 0; i < operations.size(); ++i) {
+        uow->BeginBatchOperation(i);
+        try {
+            results.push_back(std::visit(executor, operations[i]));
+        } catch (const BatchOperationError&) {
+            throw;
+        } catch (const std::exception& error) {
+            std::throw_with_nested(BatchOperationError{i, error.what()});
+        }
+    }
+    uow->Commit();
+    BOOKYPEDIA_RECORD_ROWS(results);
+    return results;
+}
+
+void UseCasesImpl::RunCommand(const std::function<void()>& command) {
+    if (FindCommandUnits()) {
+        command();
+        return;
+    }
+
+    // Группа без ограничения размера фиксируется только явно, после успешного завершения команды.
+    // При исключении она откатывается в деструкторе целиком, поэтому точки сохранения ей не нужны
+    GroupedUnitOfWorkFactory command_units{unit_factory_, std::numeric_limits<size_t>::max(),
+                                           GroupedUnitOfWorkFactory::FailureScope::Group};
+    running_commands.push_back({this, &command_units});
+    try {
+        command();
+        command_units.Flush();
+    } catch (...) {
+        running_commands.pop_back();
+        throw;
+    }
+    running_commands.pop_back();
+}
+
+GroupedUnitOfWorkFactory* UseCasesImpl::FindCommandUnits() const noexcept {
+    for (auto it = running_commands.rbegin(); it != running_commands.rend(); ++it) {
+        if (it->use_cases == this) {
+            return it->units;
+        }
+    }
+    return nullptr;
+}
+
+UnitOfWorkFactory& UseCasesImpl::Units() {
+    if (auto* command_units = FindCommandUnits()) {
+        return *command_units;
+    }
+    return unit_factory_;
+}
+
 domain::Books UseCasesImpl::GetAllBooks() {
-    auto uow = unit_factory_.GetUnitOfWork();
-    return uow->Books().GetAllBooks();
+    BOOKYPEDIA_TIME_OPERATION("UseCases.GetAllBooks");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Books().GetAllBooks());
+}
+
+domain::Books UseCasesImpl::GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.GetBooksPage");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Books().GetBooksPage(after, limit));
+}
+
+void UseCasesImpl::ForEachBook(const domain::BookVisitor& visitor) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.ForEachBook");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    uow->Books().ForEachBook(visitor);
 }
 
 domain::Books UseCasesImpl::GetBooksByAuthor(const domain::AuthorId& author_id) {
-    auto uow = unit_factory_.GetUnitOfWork();
-    return uow->Books().GetBooksByAuthorId(author_id);
+    BOOKYPEDIA_TIME_OPERATION("UseCases.GetBooksByAuthor");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Books().GetBooksByAuthorId(author_id));
 }
 
 domain::Books UseCasesImpl::GetBooksByTitle(const std::string& title) {
-    auto uow = unit_factory_.GetUnitOfWork();
-    return uow->Books().GetBooksByTitle(title);
+    BOOKYPEDIA_TIME_OPERATION("UseCases.GetBooksByTitle");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Books().GetBooksByTitle(title));
+}
+
+domain::Books UseCasesImpl::SearchBooks(const std::string& query, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.SearchBooks");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Books().SearchBooks(query, limit));
+}
+
+domain::Books UseCasesImpl::GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                           const std::optional<domain::BooksPageKey>& after, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("UseCases.GetBooksByTags");
+    auto uow = Units().GetReadOnlyUnitOfWork();
+    return BOOKYPEDIA_COUNT_ROWS(uow->Books().GetBooksByTags(tags, match, after, limit));
 }
 
 }  // namespace app
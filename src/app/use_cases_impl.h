@@ -2,6 +2,7 @@
 
 #include "../domain/author_fwd.h"
 #include "../domain/book_fwd.h"
+#include "grouped_unit_of_work.h"
 #include "unit_of_work.h"
 #include "use_cases.h"
 
@@ -17,6 +18,8 @@ public:
     void EditAuthor(const domain::AuthorId& id, const std::string& new_name) override;
 
     domain::Authors GetAllAuthors() override;
+    domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) override;
+    void ForEachAuthor(const domain::AuthorVisitor& visitor) override;
     std::optional<domain::Author> FindAuthorById(const domain::AuthorId& id) override;
     std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
 
@@ -26,12 +29,28 @@ public:
     void EditBook(const domain::BookId& id, const std::string& title, int publication_year,
                   const domain::Tags& tags) override;
 
+    ImportResult ImportBooks(const std::vector<ImportedBook>& books) override;
+    ExportResult ExportCatalog(size_t parts, const ExportSinkFactory& make_sink) override;
+    std::vector<BatchResult> ExecuteBatch(const std::vector<BatchOperation>& operations) override;
+    // Команда относится к вызвавшему её потоку: пока она идёт, сценарии этого потока работают в её единице
+    // работы, а сценарии других потоков — в своих
+    void RunCommand(const std::function<void()>& command) override;
+
     domain::Books GetAllBooks() override;
+    domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) override;
+    void ForEachBook(const domain::BookVisitor& visitor) override;
 
     domain::Books GetBooksByAuthor(const domain::AuthorId& author_id) override;
     domain::Books GetBooksByTitle(const std::string& title) override;
+    domain::Books SearchBooks(const std::string& query, size_t limit) override;
+    domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                 const std::optional<domain::BooksPageKey>& after, size_t limit) override;
 
 private:
+    // Единицы работы команды, которую этот поток выполняет через эти сценарии, или nullptr
+    GroupedUnitOfWorkFactory* FindCommandUnits() const noexcept;
+    UnitOfWorkFactory& Units();
+
     UnitOfWorkFactory& unit_factory_;
 };
 
@@ -1,6 +1,9 @@
 #include "bookypedia.h"
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 #include "menu/menu.h"
 #include "postgres/postgres.h"
@@ -10,10 +13,66 @@ namespace bookypedia {
 
 using namespace std::literals;
 
-Application::Application(const AppConfig& config) : db_{pqxx::connection{config.db_url}} {}
+Application::Application(const AppConfig& config)
+    : storage_{MakeStorage(config)}
+    , grouped_units_{config.transaction_group_size > 1
+                         ? std::make_unique<app::GroupedUnitOfWorkFactory>(GetStorage(), config.transaction_group_size)
+                         : nullptr}
+    , use_cases_{GetUnitFactory()} {
+    if (config.read_model) {
+        read_model_.emplace(use_cases_, GetUnitFactory());
+    }
+    if (util::stats::ENABLED && config.stats_file) {
+        stats_writer_.emplace(util::stats::Registry::Global(), *config.stats_file, config.stats_interval);
+    }
+}
+
+Application::Storage Application::MakeStorage(const AppConfig& config) {
+    if (config.storage == StorageType::Memory) {
+        return Storage{std::in_place_type<memory::Database>};
+    }
+    if (config.storage == StorageType::Embedded) {
+        return Storage{std::in_place_type<embedded::Database>, config.embedded};
+    }
+    return Storage{std::in_place_type<postgres::Database>, config.db};
+}
 
 void Application::Run() {
-    menu::Menu menu{std::cin, std::cout};
+    RunMenu(std::cin, std::cout);
+}
+
+void Application::RunScript(const std::string& path) {
+    std::ifstream input{path};
+    if (!input) {
+        throw std::runtime_error("Can't open " + path);
+    }
+
+    const size_t first_transaction = GetTransactionCount();
+    const auto start = std::chrono::steady_clock::now();
+    const size_t commands = RunMenu(input, std::cout);
+    if (grouped_units_) {
+        grouped_units_->Flush();
+    }
+    std::cout.flush();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const size_t transactions = GetTransactionCount() - first_transaction;
+
+    std::cerr << commands << " commands in "sv << elapsed.count() << " s, "sv
+              << (elapsed.count() > 0 ? commands / elapsed.count() : 0.0) << " commands/s, "sv << transactions
+              << " transactions"sv;
+    // Встроенное хранилище сохраняет одновременные фиксации одним fdatasync
+    if (const auto* database = std::get_if<embedded::Database>(&storage_)) {
+        std::cerr << ", "sv << database->GetSyncCount() << " log syncs"sv;
+    }
+    // Каждая изменяющая команда фиксирует одну единицу работы, поэтому группа считает команды
+    if (grouped_units_ && grouped_units_->GetStats().rolled_back > 0) {
+        std::cerr << ", "sv << grouped_units_->GetStats().rolled_back << " commands rolled back"sv;
+    }
+    std::cerr << std::endl;
+}
+
+size_t Application::RunMenu(std::istream& input, std::ostream& output) {
+    menu::Menu menu{input, output};
     menu.AddAction("Help"s, {}, "Show instructions"s, [&menu](std::istream&) {
         menu.ShowInstructions();
         return true;
@@ -21,8 +80,38 @@ void Application::Run() {
     menu.AddAction("Exit"s, {}, "Exit program"s, [&menu](std::istream&) {
         return false;
     });
-    ui::View view{menu, use_cases_, std::cin, std::cout};
-    menu.Run();
+    ui::View view{menu, GetUseCases(), input, output};
+    return menu.Run();
+}
+
+app::UnitOfWorkFactory& Application::GetUnitFactory() {
+    if (grouped_units_) {
+        return *grouped_units_;
+    }
+    return GetStorage();
+}
+
+app::UnitOfWorkFactory& Application::GetStorage() {
+    return std::visit(
+        [](auto& storage) -> app::UnitOfWorkFactory& {
+            return storage;
+        },
+        storage_);
+}
+
+size_t Application::GetTransactionCount() const {
+    return std::visit(
+        [](const auto& storage) {
+            return storage.GetTransactionCount();
+        },
+        storage_);
+}
+
+app::UseCases& Application::GetUseCases() {
+    if (read_model_) {
+        return *read_model_;
+    }
+    return use_cases_;
 }
 
 }  // namespace bookypedia
@@ -1,24 +1,68 @@
 #pragma once
 #include <pqxx/pqxx>
 
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+
+#include "app/catalog_read_model.h"
+#include "app/grouped_unit_of_work.h"
 #include "app/use_cases_impl.h"
+#include "embedded/embedded.h"
+#include "memory/memory.h"
 #include "postgres/postgres.h"
+#include "util/stats.h"
 
 namespace bookypedia {
 
+// Где хранится каталог: в PostgreSQL, в памяти процесса до его завершения или в локальных файлах
+enum class StorageType { Postgres, Memory, Embedded };
+
 struct AppConfig {
-    std::string db_url;
+    StorageType storage = StorageType::Postgres;
+    // Используется только хранилищем Postgres
+    postgres::DatabaseConfig db;
+    // Используется только встроенным хранилищем
+    embedded::DatabaseConfig embedded;
+    // Обслуживать чтение каталога из памяти
+    bool read_model = false;
+    // Сколько изменений подряд фиксируется одной транзакцией; больше одного — только для сценария из файла
+    size_t transaction_group_size = 1;
+    // Куда раз в stats_interval записывать замеры операций в формате Prometheus; без пути файл не пишется
+    std::optional<std::filesystem::path> stats_file;
+    std::chrono::milliseconds stats_interval{10'000};
 };
 
 class Application {
 public:
     explicit Application(const AppConfig& config);
 
+    // Диалог с пользователем через стандартные потоки
     void Run();
+    // Выполняет команды из файла. Вывод буферизуется целиком, сводка о скорости выводится в std::cerr
+    void RunScript(const std::string& path);
 
 private:
-    postgres::Database db_;
-    app::UseCasesImpl use_cases_{db_};
+    using Storage = std::variant<postgres::Database, memory::Database, embedded::Database>;
+
+    static Storage MakeStorage(const AppConfig& config);
+
+    // Возвращает число выполненных команд
+    size_t RunMenu(std::istream& input, std::ostream& output);
+    app::UnitOfWorkFactory& GetStorage();
+    app::UnitOfWorkFactory& GetUnitFactory();
+    app::UseCases& GetUseCases();
+    size_t GetTransactionCount() const;
+
+    // Объявлен первым, чтобы последний раз записать замеры после закрытия хранилища
+    std::optional<util::stats::PrometheusFileWriter> stats_writer_;
+    Storage storage_;
+    std::unique_ptr<app::GroupedUnitOfWorkFactory> grouped_units_;
+    app::UseCasesImpl use_cases_;
+    std::optional<app::CatalogReadModel> read_model_;
 };
 
 }  // namespace bookypedia
@@ -1,14 +1,21 @@
 #pragma once
 
+#include <functional>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "../util/tagged_uuid.h"
+#include "dump.h"
 
 namespace domain {
 
 namespace detail {
-struct AuthorTag {};
+// Идентификаторы упорядочены по времени создания: новые строки дописываются в конец индекса первичного ключа
+struct AuthorTag {
+    static constexpr auto UUID_VERSION = util::UUIDVersion::TimeOrdered;
+};
 }  // namespace detail
 
 using AuthorId = util::TaggedUUID<detail::AuthorTag>;
@@ -30,18 +37,42 @@ private:
     std::string name_;
 };
 
+// Имя уже занято другим автором. Уникальность имён обеспечивает хранилище, а не проверка перед записью
+class AuthorExistsError : public std::runtime_error {
+public:
+    AuthorExistsError() : std::runtime_error{"This author already exists"} {}
+};
+
 using Authors = std::vector<Author>;
+using AuthorVisitor = std::function<void(const Author&)>;
+
+// Последний автор предыдущей страницы; страницы упорядочены по (name, id)
+struct AuthorsPageKey {
+    std::string name;
+    AuthorId id;
+};
 
 class AuthorRepository {
 public:
+    // Save и Edit бросают AuthorExistsError, если имя занято другим автором
     virtual void Save(const Author& author) = 0;
+    // Добавляет авторов, чьих имён ещё нет, и возвращает всех авторов с переданными именами:
+    // у уже существующих остаются их прежние id
+    virtual Authors AddMissingAuthors(const Authors& authors) = 0;
+    // Удаляет автора вместе со всеми его книгами и их тегами
     virtual void Delete(const AuthorId& id) = 0;
     virtual void Edit(const AuthorId& author_id, const std::string& new_name) = 0;
 
     virtual Authors GetAllAuthors() = 0;
+    virtual Authors GetAuthorsPage(const std::optional<AuthorsPageKey>& after, size_t limit) = 0;
+    // Передаёт авторов visitor по одному в порядке (name, id), не загружая весь список в память
+    virtual void ForEachAuthor(const AuthorVisitor& visitor) = 0;
     virtual std::optional<Author> FindAuthorById(const AuthorId& author_id) = 0;
     virtual std::optional<Author> FindAuthorByName(const std::string& name) = 0;
 
+    // Выгружает часть таблицы строками (id, name) и возвращает их число
+    virtual size_t DumpAuthors(const DumpPart& part, const DumpLineSink& sink) = 0;
+
 protected:
     ~AuthorRepository() = default;
 };
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "../util/tagged_uuid.h"
 #include "author.h"
 
 namespace domain {
 
 namespace detail {
-struct BookTag {};
+// Идентификаторы упорядочены по времени создания: новые строки дописываются в конец индекса первичного ключа
+struct BookTag {
+    static constexpr auto UUID_VERSION = util::UUIDVersion::TimeOrdered;
+};
 }  // namespace detail
 
 using BookId = util::TaggedUUID<detail::BookTag>;
@@ -57,17 +65,43 @@ private:
 };
 
 using Books = std::vector<Book>;
+using BookVisitor = std::function<void(const Book&)>;
+
+// Последняя книга предыдущей страницы; страницы упорядочены по (title, id)
+struct BooksPageKey {
+    std::string title;
+    BookId id;
+};
+
+// Какие книги подходят под набор тегов: со всеми тегами сразу или хотя бы с одним из них
+enum class TagMatch { All, Any };
 
 class BookRepository {
 public:
     virtual void Save(const Book& book) = 0;
+    // Массово добавляет новые книги с тегами; книг с такими id в хранилище быть не должно
+    virtual void AddBooks(const Books& books) = 0;
     virtual Books GetAllBooks() = 0;
+    virtual Books GetBooksPage(const std::optional<BooksPageKey>& after, size_t limit) = 0;
+    // Передаёт книги с тегами visitor по одной в порядке (title, id), не загружая весь список в память
+    virtual void ForEachBook(const BookVisitor& visitor) = 0;
     virtual Books GetBooksByAuthorId(const AuthorId& author_id) = 0;
     virtual Books GetBooksByTitle(const std::string& title) = 0;
-    virtual void DeleteBookTags(const BookId& book_id) = 0;
+    // Не больше limit книг, у которых с каждого слова запроса начинается слово названия или имени автора.
+    // Первыми идут книги с названием, равным запросу, затем — по убыванию релевантности
+    virtual Books SearchBooks(const std::string& query, size_t limit) = 0;
+    // Страница книг с тегами tags в порядке (title, id), как в GetBooksPage; пустой набор тегов — пустой ответ
+    virtual Books GetBooksByTags(const Tags& tags, TagMatch match, const std::optional<BooksPageKey>& after,
+                                 size_t limit) = 0;
+    // Удаляет книгу вместе с её тегами
     virtual void DeleteBook(const BookId& book_id) = 0;
     virtual void EditBook(const BookId& id, const std::string& title, int publication_year, const Tags& tags) = 0;
 
+    // Выгружают части таблиц строками (id, author_id, title, publication_year) и (book_id, tag).
+    // Теги книги попадают в часть с тем же index, что и сама книга
+    virtual size_t DumpBooks(const DumpPart& part, const DumpLineSink& sink) = 0;
+    virtual size_t DumpBookTags(const DumpPart& part, const DumpLineSink& sink) = 0;
+
 protected:
     ~BookRepository() = default;
 };
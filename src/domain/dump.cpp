@@ -0,0 +1,26 @@
+#include "dump.h"
+
+namespace domain {
+
+void AppendCopyField(std::string& line, std::string_view value) {
+    for (const char c : value) {
+        switch (c) {
+            case '\\':
+                line.append("\\\\");
+                break;
+            case '\t':
+                line.append("\\t");
+                break;
+            case '\n':
+                line.append("\\n");
+                break;
+            case '\r':
+                line.append("\\r");
+                break;
+            default:
+                line.push_back(c);
+        }
+    }
+}
+
+}  // namespace domain
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace domain {
+
+// Часть таблицы при параллельной выгрузке: части с index от 0 до count - 1 не пересекаются
+// и вместе покрывают всю таблицу
+struct DumpPart {
+    size_t index = 0;
+    size_t count = 1;
+};
+
+// Получает строки выгрузки в текстовом формате COPY PostgreSQL: поля разделены табуляцией,
+// спецсимволы экранированы обратной косой чертой, перевода строки в конце нет
+using DumpLineSink = std::function<void(std::string_view line)>;
+
+// Попадает ли строка с этим id в часть выгрузки. Хранилища в памяти делят строки по последнему байту UUID:
+// он случаен и у v4, и у v7, а проверка не стоит им ничего. Postgres делит таблицы на диапазоны id,
+// а book_tags — на диапазоны id книг
+template <typename Id>
+bool InDumpPart(const Id& id, const DumpPart& part) {
+    return part.count <= 1 || (*id).data[15] % part.count == part.index;
+}
+
+// Дописывает поле в текстовом формате COPY: обратная косая черта и управляющие символы экранируются.
+// Для хранилищ, которые собирают строки выгрузки сами
+void AppendCopyField(std::string& line, std::string_view value);
+
+}  // namespace domain
@@ -0,0 +1,775 @@
+#include "catalog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "../util/words.h"
+
+namespace embedded {
+using namespace domain;
+
+namespace {
+
+// Операции записи журнала. Каждая задаёт итоговое значение строки, поэтому запись можно применить повторно
+enum class Op : uint8_t { PutAuthor, DeleteAuthor, PutBook, DeleteBook };
+
+class RecordWriter {
+public:
+    void Write(Op op) {
+        data_.push_back(static_cast<char>(op));
+    }
+
+    template <typename Id>
+    void WriteId(const Id& id) {
+        data_.append(reinterpret_cast<const char*>((*id).data), sizeof((*id).data));
+    }
+
+    template <typename Number>
+    void WriteNumber(Number number) {
+        data_.append(reinterpret_cast<const char*>(&number), sizeof(number));
+    }
+
+    void WriteString(std::string_view text) {
+        WriteNumber(static_cast<uint32_t>(text.size()));
+        data_.append(text);
+    }
+
+    std::string& GetData() noexcept {
+        return data_;
+    }
+
+private:
+    std::string data_;
+};
+
+class RecordReader {
+public:
+    explicit RecordReader(std::string_view data) : data_{data} {}
+
+    bool AtEnd() const noexcept {
+        return data_.empty();
+    }
+
+    Op ReadOp() {
+        return static_cast<Op>(Take(1).front());
+    }
+
+    template <typename Id>
+    Id ReadId() {
+        util::detail::UUIDType uuid;
+        std::memcpy(uuid.data, Take(sizeof(uuid.data)).data(), sizeof(uuid.data));
+        return Id{uuid};
+    }
+
+    template <typename Number>
+    Number ReadNumber() {
+        Number number;
+        std::memcpy(&number, Take(sizeof(number)).data(), sizeof(number));
+        return number;
+    }
+
+    std::string ReadString() {
+        return std::string{Take(ReadNumber<uint32_t>())};
+    }
+
+private:
+    std::string_view Take(size_t size) {
+        if (data_.size() < size) {
+            throw std::runtime_error("Malformed log record");
+        }
+        const auto bytes = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return bytes;
+    }
+
+    std::string_view data_;
+};
+
+Tags NormalizeTags(Tags tags) {
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+    return tags;
+}
+
+// Упорядочивает книги результата и убирает повторы одной книги
+template <typename Ref>
+void SortUnique(std::vector<Ref>& refs) {
+    std::sort(refs.begin(), refs.end());
+    refs.erase(std::unique(refs.begin(), refs.end(),
+                           [](const Ref& lhs, const Ref& rhs) {
+                               return lhs.id == rhs.id;
+                           }),
+               refs.end());
+}
+
+}  // namespace
+
+void Catalog::SaveAuthor(const Author& author, UndoLog& undo) {
+    if (const auto existing = FindAuthorByName(author.GetName()); existing && existing->GetId() != author.GetId()) {
+        throw AuthorExistsError{};
+    }
+    SetAuthor(author.GetId(), author.GetName(), undo);
+}
+
+void Catalog::EditAuthor(const AuthorId& id, const std::string& new_name, UndoLog& undo) {
+    if (FindAuthorName(id)) {
+        SaveAuthor({id, new_name}, undo);
+    }
+}
+
+// Как INSERT ... ON CONFLICT (name) DO NOTHING: сначала добавленные авторы, затем уже существовавшие.
+// Повтор имени, добавленного этим же вызовом, не попадает в результат
+Authors Catalog::AddMissingAuthors(const Authors& authors, UndoLog& undo) {
+    Authors inserted;
+    Authors existing;
+    std::unordered_set<std::string> inserted_names;
+    for (const auto& author : authors) {
+        if (auto found = FindAuthorByName(author.GetName())) {
+            if (!inserted_names.contains(author.GetName())) {
+                existing.push_back(std::move(*found));
+            }
+        } else {
+            SetAuthor(author.GetId(), author.GetName(), undo);
+            inserted_names.insert(author.GetName());
+            inserted.push_back(author);
+        }
+    }
+    inserted.insert(inserted.end(), std::make_move_iterator(existing.begin()),
+                    std::make_move_iterator(existing.end()));
+    return inserted;
+}
+
+void Catalog::DeleteAuthor(const AuthorId& id, UndoLog& undo) {
+    if (!FindAuthorName(id)) {
+        return;
+    }
+    for (const auto& ref : GetBookRefsOfAuthor(id)) {
+        SetBook(ref.id, std::nullopt, undo);
+    }
+    SetAuthor(id, std::nullopt, undo);
+}
+
+void Catalog::SaveBook(const Book& book, UndoLog& undo) {
+    if (!FindAuthorName(book.GetAuthorId())) {
+        throw std::runtime_error("Author " + book.GetAuthorId().ToString() + " does not exist");
+    }
+    SetBook(book.GetBookId(),
+            BookRow{book.GetAuthorId(), book.GetTitle(), book.GetPublicationYear(), NormalizeTags(book.GetTags())},
+            undo);
+}
+
+void Catalog::AddBooks(const Books& books, UndoLog& undo) {
+    for (const auto& book : books) {
+        if (FindBookRow(book.GetBookId())) {
+            throw std::runtime_error("Book " + book.GetBookId().ToString() + " already exists");
+        }
+        SaveBook(book, undo);
+    }
+}
+
+void Catalog::EditBook(const BookId& id, const std::string& title, int publication_year, const Tags& tags,
+                       UndoLog& undo) {
+    if (const auto row = FindBookRow(id)) {
+        SetBook(id, BookRow{row->author_id, title, publication_year, NormalizeTags(tags)}, undo);
+    }
+}
+
+void Catalog::DeleteBook(const BookId& id, UndoLog& undo) {
+    if (FindBookRow(id)) {
+        SetBook(id, std::nullopt, undo);
+    }
+}
+
+void Catalog::Undo(UndoLog& undo) noexcept {
+    for (auto it = undo.rbegin(); it != undo.rend(); ++it) {
+        if (auto* author = std::get_if<AuthorChange>(&*it)) {
+            PutAuthor(author->id, author->had_entry, std::move(author->old_value));
+        } else {
+            auto& book = std::get<BookChange>(*it);
+            PutBook(book.id, book.had_entry, std::move(book.old_value));
+        }
+    }
+    undo.clear();
+}
+
+// Строка, изменённая несколько раз, попадает в запись один раз — с итоговым значением
+std::string Catalog::EncodeChanges(const UndoLog& undo) const {
+    RecordWriter writer;
+    std::unordered_set<AuthorId, util::TaggedHasher<AuthorId>> authors;
+    std::unordered_set<BookId, util::TaggedHasher<BookId>> books;
+    for (const auto& change : undo) {
+        if (const auto* author = std::get_if<AuthorChange>(&change)) {
+            if (!authors.insert(author->id).second) {
+                continue;
+            }
+            const auto it = authors_.find(author->id);
+            if (it != authors_.end() && it->second) {
+                writer.Write(Op::PutAuthor);
+                writer.WriteId(author->id);
+                writer.WriteString(*it->second);
+            } else {
+                writer.Write(Op::DeleteAuthor);
+                writer.WriteId(author->id);
+            }
+            continue;
+        }
+
+        const auto& book = std::get<BookChange>(change);
+        if (!books.insert(book.id).second) {
+            continue;
+        }
+        const auto it = books_.find(book.id);
+        if (it != books_.end() && it->second) {
+            const auto& row = *it->second;
+            writer.Write(Op::PutBook);
+            writer.WriteId(book.id);
+            writer.WriteId(row.author_id);
+            writer.WriteString(row.title);
+            writer.WriteNumber(static_cast<int32_t>(row.publication_year));
+            writer.WriteNumber(static_cast<uint32_t>(row.tags.size()));
+            for (const auto& tag : row.tags) {
+                writer.WriteString(tag);
+            }
+        } else {
+            writer.Write(Op::DeleteBook);
+            writer.WriteId(book.id);
+        }
+    }
+    return std::move(writer.GetData());
+}
+
+void Catalog::ApplyChanges(std::string_view record) {
+    UndoLog undo;
+    RecordReader reader{record};
+    while (!reader.AtEnd()) {
+        switch (reader.ReadOp()) {
+            case Op::PutAuthor: {
+                const auto id = reader.ReadId<AuthorId>();
+                SetAuthor(id, reader.ReadString(), undo);
+                break;
+            }
+            case Op::DeleteAuthor:
+                SetAuthor(reader.ReadId<AuthorId>(), std::nullopt, undo);
+                break;
+            case Op::PutBook: {
+                const auto id = reader.ReadId<BookId>();
+                BookRow row;
+                row.author_id = reader.ReadId<AuthorId>();
+                row.title = reader.ReadString();
+                row.publication_year = reader.ReadNumber<int32_t>();
+                row.tags.resize(reader.ReadNumber<uint32_t>());
+                for (auto& tag : row.tags) {
+                    tag = reader.ReadString();
+                }
+                SetBook(id, std::move(row), undo);
+                break;
+            }
+            case Op::DeleteBook:
+                SetBook(reader.ReadId<BookId>(), std::nullopt, undo);
+                break;
+            default:
+                throw std::runtime_error("Malformed log record");
+        }
+    }
+}
+
+size_t Catalog::GetChangeCount() const noexcept {
+    return authors_.size() + books_.size();
+}
+
+void Catalog::WriteSegment(const std::filesystem::path& path) const {
+    std::vector<Segment::AuthorEntry> authors;
+    VisitAuthors(std::nullopt, [&authors](const AuthorId& id, std::string_view name) {
+        authors.push_back({id, std::string{name}});
+        return true;
+    });
+    std::vector<Segment::BookEntry> books;
+    VisitBooks(std::nullopt, [&books](const BookId& id, BookRow&& row) {
+        books.push_back({id, std::move(row)});
+        return true;
+    });
+    Segment::Write(path, authors, books);
+}
+
+// Строки, изменённые после копии, — те, чьё изменение появилось или стало другим. Изменения копии
+// не пропадают: убрать изменение может только откат транзакции, начатой уже после копии
+void Catalog::Rebase(std::shared_ptr<const Segment> segment, const Catalog& frozen) {
+    Catalog rebased{std::move(segment)};
+    for (const auto& [id, name] : authors_) {
+        const auto it = frozen.authors_.find(id);
+        if (it == frozen.authors_.end() || it->second != name) {
+            rebased.PutAuthor(id, true, name);
+        }
+    }
+    for (const auto& [id, row] : books_) {
+        const auto it = frozen.books_.find(id);
+        if (it == frozen.books_.end() || it->second != row) {
+            rebased.PutBook(id, true, row);
+        }
+    }
+    *this = std::move(rebased);
+}
+
+void Catalog::SetAuthor(const AuthorId& id, std::optional<std::string> name, UndoLog& undo) {
+    const auto it = authors_.find(id);
+    undo.push_back(it != authors_.end() ? AuthorChange{id, true, it->second} : AuthorChange{id, false, std::nullopt});
+    // Удаление строки, которой нет в сегменте, не нужно помнить
+    const bool has_entry = name || segment_->FindAuthor(id);
+    PutAuthor(id, has_entry, std::move(name));
+}
+
+void Catalog::SetBook(const BookId& id, std::optional<BookRow> row, UndoLog& undo) {
+    const auto it = books_.find(id);
+    undo.push_back(it != books_.end() ? BookChange{id, true, it->second} : BookChange{id, false, std::nullopt});
+    const bool has_entry = row || segment_->FindBook(id);
+    PutBook(id, has_entry, std::move(row));
+}
+
+void Catalog::PutAuthor(const AuthorId& id, bool has_entry, std::optional<std::string> name) {
+    if (auto it = authors_.find(id); it != authors_.end()) {
+        if (it->second) {
+            authors_by_name_.erase({*it->second, id});
+        }
+        authors_.erase(it);
+    }
+    if (name) {
+        authors_by_name_.insert({*name, id});
+    }
+    if (has_entry) {
+        authors_.emplace(id, std::move(name));
+    }
+}
+
+void Catalog::PutBook(const BookId& id, bool has_entry, std::optional<BookRow> row) {
+    if (auto it = books_.find(id); it != books_.end()) {
+        if (it->second) {
+            books_by_title_.erase({it->second->title, id});
+        }
+        books_.erase(it);
+    }
+    if (row) {
+        books_by_title_.insert({row->title, id});
+    }
+    if (has_entry) {
+        books_.emplace(id, std::move(row));
+    }
+}
+
+std::optional<std::string_view> Catalog::FindAuthorName(const AuthorId& id) const {
+    if (auto it = authors_.find(id); it != authors_.end()) {
+        return it->second ? std::optional<std::string_view>{*it->second} : std::nullopt;
+    }
+    if (const auto position = segment_->FindAuthor(id)) {
+        return segment_->GetAuthor(*position).name;
+    }
+    return std::nullopt;
+}
+
+std::optional<BookRow> Catalog::FindBookRow(const BookId& id) const {
+    if (auto it = books_.find(id); it != books_.end()) {
+        return it->second;
+    }
+    if (const auto position = segment_->FindBook(id)) {
+        return ReadRow(segment_->GetBook(*position));
+    }
+    return std::nullopt;
+}
+
+BookRow Catalog::ReadRow(const BookView& view) const {
+    BookRow row{view.author_id, std::string{view.title}, view.publication_year, {}};
+    row.tags.reserve(view.tag_count);
+    for (uint32_t i = 0; i < view.tag_count; ++i) {
+        row.tags.emplace_back(segment_->GetTag(view.first_tag + i));
+    }
+    return row;
+}
+
+Book Catalog::ToBook(const BookId& id, BookRow row) const {
+    std::string author_name{*FindAuthorName(row.author_id)};
+    return {id, row.author_id, std::move(row.title), row.publication_year, std::move(row.tags), std::move(author_name)};
+}
+
+Books Catalog::ToBooks(const std::vector<BookRef>& refs) const {
+    Books books;
+    books.reserve(refs.size());
+    for (const auto& ref : refs) {
+        books.push_back(ToBook(ref.id, *FindBookRow(ref.id)));
+    }
+    return books;
+}
+
+// Книги автора в сегменте и среди изменений; изменения ищутся перебором, их немного до уплотнения
+std::vector<Catalog::BookRef> Catalog::GetBookRefsOfAuthor(const AuthorId& author_id) const {
+    std::vector<BookRef> refs;
+    for (const auto position : segment_->GetBooksOfAuthor(author_id)) {
+        const auto book = segment_->GetBook(position);
+        if (!books_.contains(book.id)) {
+            refs.push_back({book.title, book.id});
+        }
+    }
+    for (const auto& [id, row] : books_) {
+        if (row && row->author_id == author_id) {
+            refs.push_back({row->title, id});
+        }
+    }
+    return refs;
+}
+
+template <typename Visitor>
+void Catalog::VisitAuthors(const std::optional<AuthorsPageKey>& after, Visitor&& visitor) const {
+    size_t position = after ? segment_->GetAuthorAfter(after->name, after->id) : 0;
+    auto it = after ? authors_by_name_.upper_bound({after->name, after->id}) : authors_by_name_.begin();
+    for (;;) {
+        std::optional<AuthorView> stored;
+        for (; position < segment_->GetAuthorCount() && !stored; ++position) {
+            if (auto author = segment_->GetAuthor(position); !authors_.contains(author.id)) {
+                stored = author;
+            }
+        }
+        // Из двух строк выдаётся меньшая, строка сегмента без пары остаётся следующему шагу
+        if (stored && (it == authors_by_name_.end() ||
+                       std::tie(stored->name, *stored->id) < std::tie(it->text, *it->id))) {
+            if (!visitor(stored->id, stored->name)) {
+                return;
+            }
+        } else if (it != authors_by_name_.end()) {
+            if (stored) {
+                --position;
+            }
+            if (!visitor(it->id, std::string_view{it->text})) {
+                return;
+            }
+            ++it;
+        } else {
+            return;
+        }
+    }
+}
+
+template <typename Visitor>
+void Catalog::VisitBooks(const std::optional<BooksPageKey>& after, Visitor&& visitor) const {
+    size_t position = after ? segment_->GetBookAfter(after->title, after->id) : 0;
+    auto it = after ? books_by_title_.upper_bound({after->title, after->id}) : books_by_title_.begin();
+    for (;;) {
+        std::optional<BookView> stored;
+        for (; position < segment_->GetBookCount() && !stored; ++position) {
+            if (auto book = segment_->GetBook(position); !books_.contains(book.id)) {
+                stored = book;
+            }
+        }
+        if (stored && (it == books_by_title_.end() ||
+                       std::tie(stored->title, *stored->id) < std::tie(it->text, *it->id))) {
+            if (!visitor(stored->id, ReadRow(*stored))) {
+                return;
+            }
+        } else if (it != books_by_title_.end()) {
+            if (stored) {
+                --position;
+            }
+            if (!visitor(it->id, BookRow{*books_.at(it->id)})) {
+                return;
+            }
+            ++it;
+        } else {
+            return;
+        }
+    }
+}
+
+Authors Catalog::GetAuthorsPage(const std::optional<AuthorsPageKey>& after, size_t limit) const {
+    Authors authors;
+    if (limit == 0) {
+        return authors;
+    }
+    VisitAuthors(after, [&authors, limit](const AuthorId& id, std::string_view name) {
+        authors.emplace_back(id, std::string{name});
+        return authors.size() < limit;
+    });
+    return authors;
+}
+
+void Catalog::ForEachAuthor(const AuthorVisitor& visitor) const {
+    VisitAuthors(std::nullopt, [&visitor](const AuthorId& id, std::string_view name) {
+        visitor(Author{id, std::string{name}});
+        return true;
+    });
+}
+
+std::optional<Author> Catalog::FindAuthorById(const AuthorId& id) const {
+    if (const auto name = FindAuthorName(id)) {
+        return Author{id, std::string{*name}};
+    }
+    return std::nullopt;
+}
+
+std::optional<Author> Catalog::FindAuthorByName(const std::string& name) const {
+    if (auto it = authors_by_name_.lower_bound({name, AuthorId{}}); it != authors_by_name_.end() && it->text == name) {
+        return Author{it->id, it->text};
+    }
+    for (size_t position = segment_->GetFirstAuthorFrom(name); position < segment_->GetAuthorCount(); ++position) {
+        const auto author = segment_->GetAuthor(position);
+        if (author.name != name) {
+            break;
+        }
+        if (!authors_.contains(author.id)) {
+            return Author{author.id, name};
+        }
+    }
+    return std::nullopt;
+}
+
+size_t Catalog::DumpAuthors(const DumpPart& part, const DumpLineSink& sink) const {
+    size_t count = 0;
+    std::string line;
+    auto dump = [&](const AuthorId& id, std::string_view name) {
+        if (InDumpPart(id, part)) {
+            line = id.ToString();
+            line.push_back('\t');
+            AppendCopyField(line, name);
+            sink(line);
+            ++count;
+        }
+    };
+    for (size_t position = 0; position < segment_->GetAuthorCount(); ++position) {
+        if (const auto author = segment_->GetAuthor(position); !authors_.contains(author.id)) {
+            dump(author.id, author.name);
+        }
+    }
+    for (const auto& [id, name] : authors_) {
+        if (name) {
+            dump(id, *name);
+        }
+    }
+    return count;
+}
+
+Books Catalog::GetBooksPage(const std::optional<BooksPageKey>& after, size_t limit) const {
+    Books books;
+    if (limit == 0) {
+        return books;
+    }
+    VisitBooks(after, [this, &books, limit](const BookId& id, BookRow&& row) {
+        books.push_back(ToBook(id, std::move(row)));
+        return books.size() < limit;
+    });
+    return books;
+}
+
+void Catalog::ForEachBook(const BookVisitor& visitor) const {
+    VisitBooks(std::nullopt, [this, &visitor](const BookId& id, BookRow&& row) {
+        visitor(ToBook(id, std::move(row)));
+        return true;
+    });
+}
+
+// Как и в Postgres, книги автора выдаются без его имени в порядке (publication_year, title)
+Books Catalog::GetBooksByAuthorId(const AuthorId& author_id) const {
+    Books books;
+    for (const auto& ref : GetBookRefsOfAuthor(author_id)) {
+        auto row = *FindBookRow(ref.id);
+        books.emplace_back(ref.id, row.author_id, std::move(row.title), row.publication_year, std::move(row.tags));
+    }
+    std::sort(books.begin(), books.end(), [](const Book& lhs, const Book& rhs) {
+        return std::forward_as_tuple(lhs.GetPublicationYear(), lhs.GetTitle(), *lhs.GetBookId()) <
+               std::forward_as_tuple(rhs.GetPublicationYear(), rhs.GetTitle(), *rhs.GetBookId());
+    });
+    return books;
+}
+
+Books Catalog::GetBooksByTitle(const std::string& title) const {
+    std::vector<BookRef> refs;
+    for (size_t position = segment_->GetFirstBookFrom(title); position < segment_->GetBookCount(); ++position) {
+        const auto book = segment_->GetBook(position);
+        if (book.title != title) {
+            break;
+        }
+        if (!books_.contains(book.id)) {
+            refs.push_back({book.title, book.id});
+        }
+    }
+    for (auto it = books_by_title_.lower_bound({title, BookId{}}); it != books_by_title_.end() && it->text == title;
+         ++it) {
+        refs.push_back({it->text, it->id});
+    }
+    std::sort(refs.begin(), refs.end());
+
+    auto books = ToBooks(refs);
+    std::stable_sort(books.begin(), books.end(), [](const Book& lhs, const Book& rhs) {
+        return lhs.GetPublicationYear() < rhs.GetPublicationYear();
+    });
+    return books;
+}
+
+// Ранжирование то же, что в хранилище в памяти: точные совпадения названия, совпадения по названию,
+// затем по автору. Индекса слов в сегменте нет, поэтому названия и имена проверяются перебором на месте
+Books Catalog::SearchBooks(const std::string& query, size_t limit) const {
+    const auto words = util::SplitWords(query);
+    if (words.empty()) {
+        return {};
+    }
+
+    std::vector<BookRef> title_matches;
+    for (size_t position = 0; position < segment_->GetBookCount(); ++position) {
+        const auto book = segment_->GetBook(position);
+        if (util::StartsWords(book.title, words) && !books_.contains(book.id)) {
+            title_matches.push_back({book.title, book.id});
+        }
+    }
+    for (const auto& key : books_by_title_) {
+        if (util::StartsWords(key.text, words)) {
+            title_matches.push_back({key.text, key.id});
+        }
+    }
+    std::sort(title_matches.begin(), title_matches.end());
+
+    std::vector<BookRef> author_matches;
+    VisitAuthors(std::nullopt, [&](const AuthorId& id, std::string_view name) {
+        if (util::StartsWords(name, words)) {
+            const auto refs = GetBookRefsOfAuthor(id);
+            author_matches.insert(author_matches.end(), refs.begin(), refs.end());
+        }
+        return true;
+    });
+    std::sort(author_matches.begin(), author_matches.end());
+
+    std::vector<BookRef> exact;
+    std::vector<BookRef> refs;
+    for (const auto& ref : title_matches) {
+        (ref.title == query ? exact : refs).push_back(ref);
+    }
+    std::set_difference(author_matches.begin(), author_matches.end(), title_matches.begin(), title_matches.end(),
+                        std::back_inserter(refs));
+    refs.insert(refs.begin(), exact.begin(), exact.end());
+
+    refs.resize(std::min(refs.size(), limit));
+    return ToBooks(refs);
+}
+
+// Из сегмента берутся списки книг тегов: для всех тегов — самый короткий из них с проверкой остальных тегов,
+// для любого — первые limit книг каждого списка после ключа страницы. Изменённые книги проверяются перебором
+Books Catalog::GetBooksByTags(const Tags& tags, TagMatch match, const std::optional<BooksPageKey>& after,
+                              size_t limit) const {
+    const auto unique_tags = NormalizeTags(tags);
+    if (unique_tags.empty()) {
+        return {};
+    }
+
+    auto is_after = [&after](std::string_view title, const BookId& id) {
+        return !after || std::tie(after->title, *after->id) < std::tie(title, *id);
+    };
+    auto has_tags = [&unique_tags, match](auto&& book_tags) {
+        if (match == TagMatch::All) {
+            return std::includes(book_tags.begin(), book_tags.end(), unique_tags.begin(), unique_tags.end());
+        }
+        return std::find_first_of(book_tags.begin(), book_tags.end(), unique_tags.begin(), unique_tags.end()) !=
+               book_tags.end();
+    };
+
+    std::vector<BookRef> refs;
+    for (const auto& [id, row] : books_) {
+        if (row && is_after(row->title, id) && has_tags(row->tags)) {
+            refs.push_back({row->title, id});
+        }
+    }
+
+    // Позиции в списках тегов возрастают, то есть идут в порядке (title, id)
+    auto first_after = [this, &after](std::span<const uint32_t> positions) {
+        if (!after) {
+            return positions.begin();
+        }
+        const auto first = segment_->GetBookAfter(after->title, after->id);
+        return std::lower_bound(positions.begin(), positions.end(), first);
+    };
+    auto take = [&](std::span<const uint32_t> positions, auto&& accept) {
+        size_t taken = 0;
+        for (auto it = first_after(positions); it != positions.end() && taken < limit; ++it) {
+            const auto book = segment_->GetBook(*it);
+            if (!books_.contains(book.id) && accept(book)) {
+                refs.push_back({book.title, book.id});
+                ++taken;
+            }
+        }
+    };
+
+    if (match == TagMatch::All) {
+        std::span<const uint32_t> shortest = segment_->GetBooksWithTag(unique_tags.front());
+        for (const auto& tag : unique_tags) {
+            if (const auto positions = segment_->GetBooksWithTag(tag); positions.size() < shortest.size()) {
+                shortest = positions;
+            }
+        }
+        take(shortest, [&](const BookView& book) {
+            return has_tags(ReadRow(book).tags);
+        });
+    } else {
+        for (const auto& tag : unique_tags) {
+            take(segment_->GetBooksWithTag(tag), [](const BookView&) {
+                return true;
+            });
+        }
+    }
+
+    SortUnique(refs);
+    refs.resize(std::min(refs.size(), limit));
+    return ToBooks(refs);
+}
+
+size_t Catalog::DumpBooks(const DumpPart& part, const DumpLineSink& sink) const {
+    size_t count = 0;
+    std::string line;
+    auto dump = [&](const BookId& id, const AuthorId& author_id, std::string_view title, int publication_year) {
+        if (InDumpPart(id, part)) {
+            line = id.ToString();
+            line.append("\t").append(author_id.ToString()).push_back('\t');
+            AppendCopyField(line, title);
+            line.append("\t").append(std::to_string(publication_year));
+            sink(line);
+            ++count;
+        }
+    };
+    for (size_t position = 0; position < segment_->GetBookCount(); ++position) {
+        if (const auto book = segment_->GetBook(position); !books_.contains(book.id)) {
+            dump(book.id, book.author_id, book.title, book.publication_year);
+        }
+    }
+    for (const auto& [id, row] : books_) {
+        if (row) {
+            dump(id, row->author_id, row->title, row->publication_year);
+        }
+    }
+    return count;
+}
+
+size_t Catalog::DumpBookTags(const DumpPart& part, const DumpLineSink& sink) const {
+    size_t count = 0;
+    std::string line;
+    auto dump = [&](const BookId& id, std::string_view tag) {
+        line = id.ToString();
+        line.push_back('\t');
+        AppendCopyField(line, tag);
+        sink(line);
+        ++count;
+    };
+    for (size_t position = 0; position < segment_->GetBookCount(); ++position) {
+        const auto book = segment_->GetBook(position);
+        if (InDumpPart(book.id, part) && !books_.contains(book.id)) {
+            for (uint32_t i = 0; i < book.tag_count; ++i) {
+                dump(book.id, segment_->GetTag(book.first_tag + i));
+            }
+        }
+    }
+    for (const auto& [id, row] : books_) {
+        if (row && InDumpPart(id, part)) {
+            for (const auto& tag : row->tags) {
+                dump(id, tag);
+            }
+        }
+    }
+    return count;
+}
+
+}  // namespace embedded
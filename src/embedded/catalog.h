@@ -0,0 +1,140 @@
+#pragma once
+
+#include <boost/uuid/uuid_hash.hpp>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+#include "segment.h"
+
+namespace embedded {
+
+// Ключ изменённой строки в порядке выдачи Postgres: (name, id) у авторов, (title, id) у книг
+template <typename Id>
+struct TextKey {
+    std::string text;
+    Id id;
+
+    bool operator<(const TextKey& other) const {
+        return std::tie(text, *id) < std::tie(other.text, *other.id);
+    }
+};
+
+// Прежнее состояние изменённой строки: была ли она среди изменений поверх сегмента и с каким значением
+template <typename Id, typename Value>
+struct Change {
+    Id id;
+    bool had_entry = false;
+    std::optional<Value> old_value;
+};
+
+using AuthorChange = Change<domain::AuthorId, std::string>;
+using BookChange = Change<domain::BookId, BookRow>;
+
+// Журнал отката транзакции; по нему же при фиксации выбираются строки для записи в журнал на диске
+using UndoLog = std::vector<std::variant<AuthorChange, BookChange>>;
+
+// Каталог из неизменяемого сегмента и изменений поверх него. Изменение хранит итоговое значение строки
+// или nullopt, если строка удалена; строки сегмента без изменений читаются прямо из отображённого файла.
+// Выдача сливает строки сегмента с изменёнными в порядке и с ограничениями таблиц Postgres.
+// Синхронизацию обеспечивает владелец каталога
+class Catalog {
+public:
+    explicit Catalog(std::shared_ptr<const Segment> segment) : segment_{std::move(segment)} {}
+
+    // Бросают domain::AuthorExistsError, если имя занято другим автором
+    void SaveAuthor(const domain::Author& author, UndoLog& undo);
+    void EditAuthor(const domain::AuthorId& id, const std::string& new_name, UndoLog& undo);
+    domain::Authors AddMissingAuthors(const domain::Authors& authors, UndoLog& undo);
+    // Удаляет автора вместе с его книгами, как каскадный внешний ключ
+    void DeleteAuthor(const domain::AuthorId& id, UndoLog& undo);
+
+    // Бросают std::runtime_error, если автора книги нет, а AddBooks — ещё и если книга с таким id уже есть
+    void SaveBook(const domain::Book& book, UndoLog& undo);
+    void AddBooks(const domain::Books& books, UndoLog& undo);
+    void EditBook(const domain::BookId& id, const std::string& title, int publication_year, const domain::Tags& tags,
+                  UndoLog& undo);
+    void DeleteBook(const domain::BookId& id, UndoLog& undo);
+
+    // Возвращает изменения к состоянию до транзакции и очищает журнал
+    void Undo(UndoLog& undo) noexcept;
+
+    // Запись журнала на диске с итоговыми значениями строк, изменённых транзакцией
+    std::string EncodeChanges(const UndoLog& undo) const;
+    // Применяет запись журнала при его чтении; повторное применение ничего не меняет
+    void ApplyChanges(std::string_view record);
+    // Сколько строк изменено поверх сегмента
+    size_t GetChangeCount() const noexcept;
+    // Записывает весь каталог в новый сегмент по пути path; сам каталог продолжает читать прежний
+    void WriteSegment(const std::filesystem::path& path) const;
+    // Переходит на сегмент, записанный WriteSegment из копии frozen этого каталога. Поверх него остаются
+    // только строки, изменённые после того, как копия была сделана
+    void Rebase(std::shared_ptr<const Segment> segment, const Catalog& frozen);
+
+    domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) const;
+    void ForEachAuthor(const domain::AuthorVisitor& visitor) const;
+    std::optional<domain::Author> FindAuthorById(const domain::AuthorId& id) const;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) const;
+    size_t DumpAuthors(const domain::DumpPart& part, const domain::DumpLineSink& sink) const;
+
+    domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) const;
+    void ForEachBook(const domain::BookVisitor& visitor) const;
+    domain::Books GetBooksByAuthorId(const domain::AuthorId& author_id) const;
+    domain::Books GetBooksByTitle(const std::string& title) const;
+    domain::Books SearchBooks(const std::string& query, size_t limit) const;
+    domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                 const std::optional<domain::BooksPageKey>& after, size_t limit) const;
+    size_t DumpBooks(const domain::DumpPart& part, const domain::DumpLineSink& sink) const;
+    size_t DumpBookTags(const domain::DumpPart& part, const domain::DumpLineSink& sink) const;
+
+private:
+    using AuthorKey = TextKey<domain::AuthorId>;
+    using BookKey = TextKey<domain::BookId>;
+
+    // Книга результата: название указывает в сегмент или в изменённую строку
+    struct BookRef {
+        std::string_view title;
+        domain::BookId id;
+
+        bool operator<(const BookRef& other) const {
+            return std::tie(title, *id) < std::tie(other.title, *other.id);
+        }
+    };
+
+    // Записывают прежнее состояние строки в журнал и заменяют строку; nullopt удаляет её
+    void SetAuthor(const domain::AuthorId& id, std::optional<std::string> name, UndoLog& undo);
+    void SetBook(const domain::BookId& id, std::optional<BookRow> row, UndoLog& undo);
+    // Заменяют изменение строки вместе с индексом изменённых строк; has_entry == false убирает изменение
+    void PutAuthor(const domain::AuthorId& id, bool has_entry, std::optional<std::string> name);
+    void PutBook(const domain::BookId& id, bool has_entry, std::optional<BookRow> row);
+
+    std::optional<std::string_view> FindAuthorName(const domain::AuthorId& id) const;
+    std::optional<BookRow> FindBookRow(const domain::BookId& id) const;
+    BookRow ReadRow(const BookView& view) const;
+    domain::Book ToBook(const domain::BookId& id, BookRow row) const;
+    domain::Books ToBooks(const std::vector<BookRef>& refs) const;
+    std::vector<BookRef> GetBookRefsOfAuthor(const domain::AuthorId& author_id) const;
+
+    // Обходят строки в порядке выдачи после ключа страницы, пока visitor возвращает true
+    template <typename Visitor>
+    void VisitAuthors(const std::optional<domain::AuthorsPageKey>& after, Visitor&& visitor) const;
+    template <typename Visitor>
+    void VisitBooks(const std::optional<domain::BooksPageKey>& after, Visitor&& visitor) const;
+
+    std::shared_ptr<const Segment> segment_;
+    std::unordered_map<domain::AuthorId, std::optional<std::string>, util::TaggedHasher<domain::AuthorId>> authors_;
+    std::set<AuthorKey> authors_by_name_;
+    std::unordered_map<domain::BookId, std::optional<BookRow>, util::TaggedHasher<domain::BookId>> books_;
+    std::set<BookKey> books_by_title_;
+};
+
+}  // namespace embedded
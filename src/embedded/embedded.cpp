@@ -0,0 +1,125 @@
+#include "embedded.h"
+
+#include <optional>
+
+namespace embedded {
+
+namespace {
+
+constexpr const char SEGMENT_FILE_NAME[]{"catalog.segment"};
+constexpr const char LOG_FILE_NAME[]{"catalog.log"};
+
+std::filesystem::path PrepareDirectory(const std::filesystem::path& directory) {
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+}  // namespace
+
+SharedCatalog::SharedCatalog(const DatabaseConfig& config)
+    : config{config},
+      segment_path{PrepareDirectory(config.directory) / SEGMENT_FILE_NAME},
+      catalog{Segment::Open(segment_path)},
+      log{config.directory / LOG_FILE_NAME, [this](std::string_view record) {
+              catalog.ApplyChanges(record);
+          }},
+      compactor_{[this] {
+          RunCompactor();
+      }} {
+}
+
+SharedCatalog::~SharedCatalog() {
+    {
+        std::lock_guard lock{compactor_mutex_};
+        stopping_ = true;
+    }
+    compactor_cv_.notify_one();
+    compactor_.join();
+}
+
+void SharedCatalog::CommitChanges(UndoLog& undo, const std::function<void()>& release) {
+    if (undo.empty()) {
+        release();
+        return;
+    }
+
+    const auto lsn = log.Append(catalog.EncodeChanges(undo));
+    undo.clear();
+    const bool compact = catalog.GetChangeCount() >= config.compaction_threshold;
+    release();
+
+    try {
+        log.Sync(lsn);
+    } catch (const std::exception& e) {
+        // Каталог уже отпущен, и отменять изменения поздно
+        throw NotDurableError{e.what()};
+    }
+    if (compact) {
+        {
+            std::lock_guard lock{compactor_mutex_};
+            compaction_requested_ = true;
+        }
+        compactor_cv_.notify_one();
+    }
+}
+
+void SharedCatalog::Compact(size_t min_changes) {
+    std::lock_guard compaction_lock{compaction_mutex_};
+    // Копия разделяет сегмент с каталогом и повторяет только изменения поверх него
+    std::optional<Catalog> frozen;
+    Log::Lsn frozen_lsn = 0;
+    {
+        std::shared_lock lock{mutex};
+        if (catalog.GetChangeCount() < min_changes) {
+            return;
+        }
+        frozen.emplace(catalog);
+        frozen_lsn = log.GetWrittenLsn();
+    }
+
+    frozen->WriteSegment(segment_path);
+    auto segment = Segment::Open(segment_path);
+
+    {
+        std::lock_guard lock{mutex};
+        catalog.Rebase(std::move(segment), *frozen);
+    }
+    // Журнал дописывается под своей блокировкой, поэтому записи после копии сохранятся и без каталога
+    log.DropBefore(frozen_lsn);
+}
+
+void SharedCatalog::RunCompactor() {
+    std::unique_lock lock{compactor_mutex_};
+    for (;;) {
+        compactor_cv_.wait(lock, [this] {
+            return compaction_requested_ || stopping_;
+        });
+        if (stopping_) {
+            return;
+        }
+        compaction_requested_ = false;
+        lock.unlock();
+        try {
+            Compact(config.compaction_threshold);
+        } catch (const std::exception&) {
+            // Изменения остаются в журнале, и уплотнение повторится после следующей фиксации
+        }
+        lock.lock();
+    }
+}
+
+Database::~Database() {
+    if (shared_.config.compact_on_close) {
+        // Не перенесённые изменения останутся в журнале и будут прочитаны при следующем запуске
+        try {
+            shared_.Compact(1);
+        } catch (const std::exception&) {
+        }
+    }
+}
+
+void Database::Compact() {
+    shared_.Compact(1);
+}
+
+}  // namespace embedded
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../memory/catalog_storage.h"
+#include "catalog.h"
+#include "log.h"
+
+namespace embedded {
+
+struct DatabaseConfig {
+    // Каталог с файлами сегмента и журнала; создаётся, если его нет
+    std::filesystem::path directory;
+    // Сколько изменённых строк накапливается поверх сегмента до его перезаписи
+    size_t compaction_threshold = 10'000;
+    // Переносить изменения в сегмент при закрытии, чтобы следующий запуск только отображал файлы
+    bool compact_on_close = true;
+};
+
+// Журнал не удалось сохранить на диск уже после того, как изменения стали видны другим транзакциям.
+// Изменения не отменены и могут попасть в сегмент, но после сбоя способны пропасть; новые изменения
+// база больше не принимает
+class NotDurableError : public std::runtime_error {
+public:
+    explicit NotDurableError(const std::string& reason)
+        : std::runtime_error{"Changes are applied but may be lost after a crash: " + reason} {}
+};
+
+// Каталог, общий для единиц работы одной базы, вместе с его файлами
+struct SharedCatalog {
+    using UndoLog = ::embedded::UndoLog;
+
+    explicit SharedCatalog(const DatabaseConfig& config);
+    SharedCatalog(const SharedCatalog&) = delete;
+    SharedCatalog& operator=(const SharedCatalog&) = delete;
+    // Дожидается уплотнения, начатого в фоне
+    ~SharedCatalog();
+
+    // Дописывает изменения в журнал, освобождает каталог и только затем ждёт диска,
+    // поэтому одновременные фиксации сохраняются одним fdatasync. Другие транзакции могут увидеть
+    // изменения чуть раньше, чем фиксация завершится. Если журнал не сохранился, бросает NotDurableError.
+    // Когда изменений накопилось compaction_threshold, будит поток уплотнения
+    void CommitChanges(UndoLog& undo, const std::function<void()>& release);
+    // Переносит изменения в новый сегмент, если их не меньше min_changes, и убирает их из журнала.
+    // Сегмент пишется из копии каталога без его захвата; каталог захватывается ненадолго, чтобы сделать
+    // копию и затем перейти на новый сегмент. Вызывается без захвата каталога
+    void Compact(size_t min_changes);
+
+    DatabaseConfig config;
+    std::filesystem::path segment_path;
+    Catalog catalog;
+    // Открывается после каталога: записи журнала применяются к нему при открытии
+    Log log;
+    std::shared_mutex mutex;
+    // Поток, чья транзакция держит каталог для изменений
+    std::atomic<std::thread::id> writer;
+
+private:
+    void RunCompactor();
+
+    // Уплотнения выполняются по очереди
+    std::mutex compaction_mutex_;
+    std::mutex compactor_mutex_;
+    std::condition_variable compactor_cv_;
+    bool compaction_requested_ = false;
+    bool stopping_ = false;
+    // Запускается последним, когда остальные поля готовы
+    std::thread compactor_;
+};
+
+// Встроенное хранилище каталога в локальных файлах, для установок без сервера Postgres.
+// Каталог читается из неизменяемого сегмента, отображённого в память, а зафиксированные изменения
+// дописываются в журнал и держатся в памяти поверх сегмента. Когда изменений накапливается
+// compaction_threshold, фоновый поток переносит их в новый сегмент, не останавливая транзакции,
+// и убирает из журнала. При закрытии база уплотняется сразу, поэтому запуск после штатного закрытия
+// только отображает сегмент. Журнал читается при запуске лишь после сбоя.
+// Порядок выдачи и ограничения те же, что у репозиториев Postgres.
+// Снимок для параллельного чтения копирует только изменения поверх общего сегмента.
+// Файлы открывает один процесс
+class Database : public memory::BasicDatabase<SharedCatalog> {
+public:
+    explicit Database(const DatabaseConfig& config) : BasicDatabase{config} {}
+    ~Database() override;
+
+    // Переносит изменения из журнала в новый сегмент
+    void Compact();
+
+    // Сколько раз журнал сохранялся на диск; меньше числа фиксаций, если они шли одновременно
+    size_t GetSyncCount() const {
+        return shared_.log.GetSyncCount();
+    }
+};
+
+}  // namespace embedded
@@ -0,0 +1,222 @@
+#include "log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace embedded {
+
+namespace {
+
+struct RecordHeader {
+    uint32_t size;
+    uint32_t crc;
+};
+
+uint32_t Checksum(std::string_view data) {
+    boost::crc_32_type crc;
+    crc.process_bytes(data.data(), data.size());
+    return crc.checksum();
+}
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::string ReadAll(int fd, const std::filesystem::path& path) {
+    std::string data;
+    char buffer[1 << 16];
+    for (;;) {
+        const auto count = ::read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            ThrowSystemError("Can't read " + path.string());
+        }
+        if (count == 0) {
+            return data;
+        }
+        data.append(buffer, count);
+    }
+}
+
+}  // namespace
+
+Log::Log(const std::filesystem::path& path, const RecordHandler& handler) : path_{path} {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        ThrowSystemError("Can't open " + path.string());
+    }
+
+    const auto data = ReadAll(fd_, path);
+    size_t end = 0;
+    while (data.size() - end >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        std::memcpy(&header, data.data() + end, sizeof(header));
+        if (header.size > data.size() - end - sizeof(header)) {
+            break;
+        }
+        const std::string_view record{data.data() + end + sizeof(header), header.size};
+        if (Checksum(record) != header.crc) {
+            break;
+        }
+        handler(record);
+        end += sizeof(header) + header.size;
+    }
+    if (end != data.size() && ::ftruncate(fd_, static_cast<off_t>(end)) != 0) {
+        ::close(fd_);
+        ThrowSystemError("Can't truncate " + path.string());
+    }
+    if (::lseek(fd_, static_cast<off_t>(end), SEEK_SET) < 0) {
+        ::close(fd_);
+        ThrowSystemError("Can't seek " + path.string());
+    }
+    written_ = synced_ = size_ = end;
+}
+
+Log::~Log() {
+    ::close(fd_);
+}
+
+Log::Lsn Log::Append(std::string_view record) {
+    const RecordHeader header{static_cast<uint32_t>(record.size()), Checksum(record)};
+    std::string data{reinterpret_cast<const char*>(&header), sizeof(header)};
+    data.append(record);
+
+    std::lock_guard lock{mutex_};
+    CheckNotFailed();
+    std::string_view rest{data};
+    while (!rest.empty()) {
+        const auto written = ::write(fd_, rest.data(), rest.size());
+        if (written < 0 && errno != EINTR) {
+            const int error = errno;
+            // Иначе следующие записи легли бы после испорченной и пропали бы при чтении журнала
+            const auto size = static_cast<off_t>(size_);
+            if (::ftruncate(fd_, size) != 0 || ::lseek(fd_, size, SEEK_SET) != size) {
+                failed_ = true;
+            }
+            throw std::system_error(error, std::generic_category(), "Can't write " + path_.string());
+        }
+        rest.remove_prefix(std::max<ssize_t>(written, 0));
+    }
+    size_ += data.size();
+    written_ += data.size();
+    return written_;
+}
+
+void Log::Sync(Lsn lsn) {
+    std::unique_lock lock{mutex_};
+    while (synced_ < lsn) {
+        CheckNotFailed();
+        if (syncing_) {
+            synced_cv_.wait(lock);
+            continue;
+        }
+        // Этот поток сохраняет и свои записи, и всё, что дописано к этому моменту другими
+        syncing_ = true;
+        const Lsn target = written_;
+        lock.unlock();
+        const int result = ::fdatasync(fd_);
+        const int error = errno;
+        lock.lock();
+        syncing_ = false;
+        synced_cv_.notify_all();
+        if (result != 0) {
+            // После неудачного fdatasync повторный может вернуть успех, не сохранив данные
+            failed_ = true;
+            throw std::system_error(error, std::generic_category(), "Can't sync " + path_.string());
+        }
+        synced_ = std::max(synced_, target);
+        ++sync_count_;
+    }
+}
+
+void Log::DropBefore(Lsn lsn) {
+    std::unique_lock lock{mutex_};
+    synced_cv_.wait(lock, [this] {
+        return !syncing_;
+    });
+    CheckNotFailed();
+    if (lsn < written_) {
+        RewriteTail(written_ - lsn);
+    } else if (::ftruncate(fd_, 0) != 0 || ::lseek(fd_, 0, SEEK_SET) < 0 || ::fdatasync(fd_) != 0) {
+        failed_ = true;
+        ThrowSystemError("Can't clear " + path_.string());
+    } else {
+        size_ = 0;
+    }
+    // Записи до lsn уже сохранены в сегменте, а остальные — в новом файле
+    synced_ = written_;
+    synced_cv_.notify_all();
+}
+
+// Прежний файл заменяется переименованием, поэтому после сбоя читается либо он целиком, либо хвост;
+// записи хранят итоговые значения строк, и повторное применение уже перенесённых в сегмент безвредно
+void Log::RewriteTail(uint64_t tail_size) {
+    std::string tail(tail_size, '\0');
+    const uint64_t offset = size_ - tail_size;
+    for (uint64_t done = 0; done < tail_size;) {
+        const auto count = ::pread(fd_, tail.data() + done, tail_size - done, static_cast<off_t>(offset + done));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            ThrowSystemError("Can't read " + path_.string());
+        }
+        done += count;
+    }
+
+    auto temp_path = path_;
+    temp_path += ".tmp";
+    const int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ThrowSystemError("Can't create " + temp_path.string());
+    }
+    std::string_view rest{tail};
+    while (!rest.empty()) {
+        const auto written = ::write(fd, rest.data(), rest.size());
+        if (written < 0 && errno != EINTR) {
+            ::close(fd);
+            ThrowSystemError("Can't write " + temp_path.string());
+        }
+        rest.remove_prefix(std::max<ssize_t>(written, 0));
+    }
+    if (::fdatasync(fd) != 0 || ::rename(temp_path.c_str(), path_.c_str()) != 0) {
+        ::close(fd);
+        ThrowSystemError("Can't replace " + path_.string());
+    }
+    ::close(fd_);
+    fd_ = fd;
+    size_ = tail_size;
+    if (const int dir = ::open(path_.parent_path().empty() ? "." : path_.parent_path().c_str(),
+                               O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+}
+
+void Log::CheckNotFailed() const {
+    if (failed_) {
+        throw std::runtime_error("The log " + path_.string() + " is in an unknown state after a failed write");
+    }
+}
+
+Log::Lsn Log::GetWrittenLsn() const {
+    std::lock_guard lock{mutex_};
+    return written_;
+}
+
+size_t Log::GetSyncCount() const {
+    std::lock_guard lock{mutex_};
+    return sync_count_;
+}
+
+}  // namespace embedded
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace embedded {
+
+// Журнал изменений, дописываемый в конец файла. Запись — длина, CRC-32 и данные,
+// поэтому недописанный при сбое хвост обнаруживается и отбрасывается при открытии.
+// Если файл не удалось вернуть к последней целой записи или сохранить на диске, его содержимое
+// неизвестно: журнал больше не принимает записей, и Append и Sync бросают исключение
+class Log {
+public:
+    // Номер байта журнала, до которого записаны данные; растёт и после очистки файла
+    using Lsn = uint64_t;
+    using RecordHandler = std::function<void(std::string_view record)>;
+
+    // Передаёт handler целые записи журнала по порядку и обрезает файл после последней из них
+    Log(const std::filesystem::path& path, const RecordHandler& handler);
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+    ~Log();
+
+    // Дописывает запись в файл без ожидания диска и возвращает её конец. Если запись не удалась,
+    // недописанная часть обрезается, чтобы следующие записи не оказались после испорченной
+    Lsn Append(std::string_view record);
+    // Дожидается сохранения на диске записей до lsn. Потоки, пришедшие во время fdatasync,
+    // сохраняются следующим вызовом одного из них, поэтому одновременные фиксации делят один вызов
+    void Sync(Lsn lsn);
+    // Убирает записи до lsn, когда они перенесены в сегмент и сохранены на диске. Если после них
+    // дописаны новые, те переписываются в новый файл, который заменяет прежний
+    void DropBefore(Lsn lsn);
+
+    // Конец последней дописанной записи
+    Lsn GetWrittenLsn() const;
+
+    // Сколько раз журнал сохранялся на диск
+    size_t GetSyncCount() const;
+
+private:
+    // Бросает исключение, если журнал больше не принимает записей
+    void CheckNotFailed() const;
+    // Заменяет файл новым, в котором только последние tail_size байт
+    void RewriteTail(uint64_t tail_size);
+
+    int fd_ = -1;
+    std::filesystem::path path_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable synced_cv_;
+    Lsn written_ = 0;
+    // Размер файла: целые записи после последней очистки
+    uint64_t size_ = 0;
+    Lsn synced_ = 0;
+    bool syncing_ = false;
+    size_t sync_count_ = 0;
+    bool failed_ = false;
+};
+
+}  // namespace embedded
@@ -0,0 +1,459 @@
+#include "segment.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+
+namespace embedded {
+using namespace domain;
+
+namespace {
+
+constexpr char MAGIC[8]{'B', 'K', 'P', 'S', 'E', 'G', '0', '1'};
+
+// Строка в разделе строк сегмента
+struct StringRef {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct AuthorRecord {
+    unsigned char id[16];
+    StringRef name;
+};
+
+struct BookRecord {
+    unsigned char id[16];
+    unsigned char author_id[16];
+    StringRef title;
+    uint64_t first_tag;
+    uint32_t tag_count;
+    int32_t publication_year;
+};
+
+// Тег и позиции его книг в разделе postings
+struct TagRecord {
+    StringRef tag;
+    uint64_t first_posting;
+    uint64_t posting_count;
+};
+
+template <typename Id>
+Id IdFrom(const unsigned char (&bytes)[16]) {
+    util::detail::UUIDType uuid;
+    std::memcpy(uuid.data, bytes, sizeof(bytes));
+    return Id{uuid};
+}
+
+template <typename Id>
+void CopyId(const Id& id, unsigned char (&bytes)[16]) {
+    std::memcpy(bytes, (*id).data, sizeof(bytes));
+}
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void CheckFormat(bool condition, const std::filesystem::path& path) {
+    if (!condition) {
+        throw std::runtime_error("Segment " + path.string() + " is corrupted");
+    }
+}
+
+// Собирает файл в памяти: разделы выравниваются по 8 байт, чтобы записи можно было читать прямо из отображения
+class SegmentBuilder {
+public:
+    template <typename T>
+    uint64_t AddSection(const std::vector<T>& records) {
+        Align();
+        const uint64_t offset = data_.size();
+        data_.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+        return offset;
+    }
+
+    uint64_t AddBytes(std::string_view bytes) {
+        Align();
+        const uint64_t offset = data_.size();
+        data_.append(bytes);
+        return offset;
+    }
+
+    std::string& GetData() noexcept {
+        return data_;
+    }
+
+private:
+    void Align() {
+        data_.resize((data_.size() + 7) / 8 * 8, '\0');
+    }
+
+    std::string data_;
+};
+
+void WriteFile(const std::filesystem::path& path, std::string_view data) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ThrowSystemError("Can't create " + path.string());
+    }
+    while (!data.empty()) {
+        const auto written = ::write(fd, data.data(), data.size());
+        if (written < 0 && errno != EINTR) {
+            ::close(fd);
+            ThrowSystemError("Can't write " + path.string());
+        }
+        data.remove_prefix(std::max<ssize_t>(written, 0));
+    }
+    if (::fsync(fd) != 0) {
+        ::close(fd);
+        ThrowSystemError("Can't sync " + path.string());
+    }
+    ::close(fd);
+}
+
+}  // namespace
+
+struct Segment::Header {
+    char magic[8];
+    uint64_t author_count;
+    uint64_t book_count;
+    uint64_t tag_ref_count;
+    uint64_t tag_count;
+    uint64_t posting_count;
+    uint64_t strings_size;
+    uint64_t authors;
+    uint64_t authors_by_id;
+    uint64_t books;
+    uint64_t books_by_id;
+    uint64_t books_by_author;
+    uint64_t tag_refs;
+    uint64_t tags;
+    uint64_t postings;
+    uint64_t strings;
+};
+
+Segment::~Segment() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+std::shared_ptr<const Segment> Segment::Open(const std::filesystem::path& path) {
+    auto segment = std::make_shared<Segment>();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return segment;
+        }
+        ThrowSystemError("Can't open " + path.string());
+    }
+
+    struct stat status{};
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        ThrowSystemError("Can't stat " + path.string());
+    }
+    const auto size = static_cast<size_t>(status.st_size);
+    CheckFormat(size >= sizeof(Header), path);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        ThrowSystemError("Can't map " + path.string());
+    }
+    segment->data_ = static_cast<const char*>(data);
+    segment->size_ = size;
+
+    // Проверяются только границы разделов: содержимое записывает Write и защищает fsync перед rename
+    const auto& header = segment->GetHeader();
+    CheckFormat(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0, path);
+    auto section_fits = [size](uint64_t offset, uint64_t count, size_t record_size) {
+        return offset <= size && count <= (size - offset) / record_size;
+    };
+    CheckFormat(section_fits(header.authors, header.author_count, sizeof(AuthorRecord)) &&
+                    section_fits(header.authors_by_id, header.author_count, sizeof(uint32_t)) &&
+                    section_fits(header.books, header.book_count, sizeof(BookRecord)) &&
+                    section_fits(header.books_by_id, header.book_count, sizeof(uint32_t)) &&
+                    section_fits(header.books_by_author, header.book_count, sizeof(uint32_t)) &&
+                    section_fits(header.tag_refs, header.tag_ref_count, sizeof(StringRef)) &&
+                    section_fits(header.tags, header.tag_count, sizeof(TagRecord)) &&
+                    section_fits(header.postings, header.posting_count, sizeof(uint32_t)) &&
+                    section_fits(header.strings, header.strings_size, 1),
+                path);
+    return segment;
+}
+
+void Segment::Write(const std::filesystem::path& path, const std::vector<AuthorEntry>& authors,
+                    const std::vector<BookEntry>& books) {
+    if (authors.size() > UINT32_MAX || books.size() > UINT32_MAX) {
+        throw std::length_error("The catalog is too large for a segment");
+    }
+
+    std::string strings;
+    auto add_string = [&strings](std::string_view text) {
+        const StringRef ref{strings.size(), text.size()};
+        strings.append(text);
+        return ref;
+    };
+
+    std::vector<AuthorRecord> author_records(authors.size());
+    for (size_t i = 0; i < authors.size(); ++i) {
+        CopyId(authors[i].id, author_records[i].id);
+        author_records[i].name = add_string(authors[i].name);
+    }
+
+    // Одинаковые теги хранятся в разделе строк один раз
+    std::map<std::string_view, std::pair<StringRef, std::vector<uint32_t>>> tags;
+    std::vector<StringRef> tag_refs;
+    std::vector<BookRecord> book_records(books.size());
+    for (size_t i = 0; i < books.size(); ++i) {
+        const auto& [id, row] = books[i];
+        auto& record = book_records[i];
+        CopyId(id, record.id);
+        CopyId(row.author_id, record.author_id);
+        record.title = add_string(row.title);
+        record.publication_year = row.publication_year;
+        record.first_tag = tag_refs.size();
+        record.tag_count = static_cast<uint32_t>(row.tags.size());
+        for (const auto& tag : row.tags) {
+            auto [it, inserted] = tags.try_emplace(tag);
+            if (inserted) {
+                it->second.first = add_string(tag);
+            }
+            it->second.second.push_back(static_cast<uint32_t>(i));
+            tag_refs.push_back(it->second.first);
+        }
+    }
+
+    std::vector<TagRecord> tag_records;
+    std::vector<uint32_t> postings;
+    for (auto& [tag, entry] : tags) {
+        auto& [ref, positions] = entry;
+        tag_records.push_back({ref, postings.size(), positions.size()});
+        postings.insert(postings.end(), positions.begin(), positions.end());
+    }
+
+    auto positions_by = [](size_t count, auto less) {
+        std::vector<uint32_t> positions(count);
+        std::iota(positions.begin(), positions.end(), 0);
+        std::sort(positions.begin(), positions.end(), less);
+        return positions;
+    };
+    const auto authors_by_id = positions_by(authors.size(), [&authors](uint32_t lhs, uint32_t rhs) {
+        return *authors[lhs].id < *authors[rhs].id;
+    });
+    const auto books_by_id = positions_by(books.size(), [&books](uint32_t lhs, uint32_t rhs) {
+        return *books[lhs].id < *books[rhs].id;
+    });
+    // Позиции уже идут в порядке (title, id), поэтому достаточно устойчиво упорядочить их по автору и году
+    auto books_by_author = positions_by(books.size(), [](uint32_t lhs, uint32_t rhs) {
+        return lhs < rhs;
+    });
+    std::stable_sort(books_by_author.begin(), books_by_author.end(), [&books](uint32_t lhs, uint32_t rhs) {
+        const auto& left = books[lhs].row;
+        const auto& right = books[rhs].row;
+        return std::tie(*left.author_id, left.publication_year) < std::tie(*right.author_id, right.publication_year);
+    });
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.author_count = authors.size();
+    header.book_count = books.size();
+    header.tag_ref_count = tag_refs.size();
+    header.tag_count = tag_records.size();
+    header.posting_count = postings.size();
+    header.strings_size = strings.size();
+
+    SegmentBuilder builder;
+    builder.AddBytes({reinterpret_cast<const char*>(&header), sizeof(header)});
+    header.authors = builder.AddSection(author_records);
+    header.authors_by_id = builder.AddSection(authors_by_id);
+    header.books = builder.AddSection(book_records);
+    header.books_by_id = builder.AddSection(books_by_id);
+    header.books_by_author = builder.AddSection(books_by_author);
+    header.tag_refs = builder.AddSection(tag_refs);
+    header.tags = builder.AddSection(tag_records);
+    header.postings = builder.AddSection(postings);
+    header.strings = builder.AddBytes(strings);
+    std::memcpy(builder.GetData().data(), &header, sizeof(header));
+
+    // Новый сегмент заменяет прежний целиком: читатели видят либо старый файл, либо новый
+    auto temp_path = path;
+    temp_path += ".tmp";
+    WriteFile(temp_path, builder.GetData());
+    std::filesystem::rename(temp_path, path);
+    if (const int dir = ::open(path.parent_path().empty() ? "." : path.parent_path().c_str(),
+                               O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+}
+
+const Segment::Header& Segment::GetHeader() const {
+    return *reinterpret_cast<const Header*>(data_);
+}
+
+template <typename T>
+std::span<const T> Segment::GetSection(uint64_t offset, uint64_t count) const {
+    return {reinterpret_cast<const T*>(data_ + offset), count};
+}
+
+std::string_view Segment::GetString(uint64_t offset, uint64_t size) const {
+    return {data_ + GetHeader().strings + offset, size};
+}
+
+size_t Segment::GetAuthorCount() const noexcept {
+    return data_ ? GetHeader().author_count : 0;
+}
+
+AuthorView Segment::GetAuthor(size_t position) const {
+    const auto& record = GetSection<AuthorRecord>(GetHeader().authors, GetAuthorCount())[position];
+    return {IdFrom<AuthorId>(record.id), GetString(record.name.offset, record.name.size)};
+}
+
+std::optional<size_t> Segment::FindAuthor(const AuthorId& id) const {
+    if (!data_) {
+        return std::nullopt;
+    }
+    const auto positions = GetSection<uint32_t>(GetHeader().authors_by_id, GetAuthorCount());
+    const auto it = std::partition_point(positions.begin(), positions.end(), [this, &id](uint32_t position) {
+        return *GetAuthor(position).id < *id;
+    });
+    if (it != positions.end() && GetAuthor(*it).id == id) {
+        return *it;
+    }
+    return std::nullopt;
+}
+
+size_t Segment::GetAuthorAfter(std::string_view name, const AuthorId& id) const {
+    size_t first = 0;
+    size_t count = GetAuthorCount();
+    // Двоичный поиск по позициям: записи упорядочены по (name, id)
+    while (count > 0) {
+        const size_t step = count / 2;
+        const auto author = GetAuthor(first + step);
+        if (std::tie(author.name, *author.id) <= std::tie(name, *id)) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+size_t Segment::GetFirstAuthorFrom(std::string_view name) const {
+    size_t first = 0;
+    size_t count = GetAuthorCount();
+    while (count > 0) {
+        const size_t step = count / 2;
+        if (GetAuthor(first + step).name < name) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+size_t Segment::GetBookCount() const noexcept {
+    return data_ ? GetHeader().book_count : 0;
+}
+
+BookView Segment::GetBook(size_t position) const {
+    const auto& record = GetSection<BookRecord>(GetHeader().books, GetBookCount())[position];
+    return {IdFrom<BookId>(record.id), IdFrom<AuthorId>(record.author_id),
+            GetString(record.title.offset, record.title.size), record.publication_year, record.first_tag,
+            record.tag_count};
+}
+
+std::string_view Segment::GetTag(uint64_t index) const {
+    const auto& ref = GetSection<StringRef>(GetHeader().tag_refs, GetHeader().tag_ref_count)[index];
+    return GetString(ref.offset, ref.size);
+}
+
+std::optional<size_t> Segment::FindBook(const BookId& id) const {
+    if (!data_) {
+        return std::nullopt;
+    }
+    const auto positions = GetSection<uint32_t>(GetHeader().books_by_id, GetBookCount());
+    const auto it = std::partition_point(positions.begin(), positions.end(), [this, &id](uint32_t position) {
+        return *GetBook(position).id < *id;
+    });
+    if (it != positions.end() && GetBook(*it).id == id) {
+        return *it;
+    }
+    return std::nullopt;
+}
+
+size_t Segment::GetBookAfter(std::string_view title, const BookId& id) const {
+    size_t first = 0;
+    size_t count = GetBookCount();
+    while (count > 0) {
+        const size_t step = count / 2;
+        const auto book = GetBook(first + step);
+        if (std::tie(book.title, *book.id) <= std::tie(title, *id)) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+size_t Segment::GetFirstBookFrom(std::string_view title) const {
+    size_t first = 0;
+    size_t count = GetBookCount();
+    while (count > 0) {
+        const size_t step = count / 2;
+        if (GetBook(first + step).title < title) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+std::span<const uint32_t> Segment::GetBooksOfAuthor(const AuthorId& author_id) const {
+    if (!data_) {
+        return {};
+    }
+    const auto positions = GetSection<uint32_t>(GetHeader().books_by_author, GetBookCount());
+    const auto first = std::partition_point(positions.begin(), positions.end(), [&](uint32_t position) {
+        return *GetBook(position).author_id < *author_id;
+    });
+    const auto last = std::partition_point(first, positions.end(), [&](uint32_t position) {
+        return GetBook(position).author_id == author_id;
+    });
+    return {first, last};
+}
+
+std::span<const uint32_t> Segment::GetBooksWithTag(std::string_view tag) const {
+    if (!data_) {
+        return {};
+    }
+    const auto& header = GetHeader();
+    const auto tags = GetSection<TagRecord>(header.tags, header.tag_count);
+    const auto it = std::partition_point(tags.begin(), tags.end(), [this, tag](const TagRecord& record) {
+        return GetString(record.tag.offset, record.tag.size) < tag;
+    });
+    if (it == tags.end() || GetString(it->tag.offset, it->tag.size) != tag) {
+        return {};
+    }
+    return GetSection<uint32_t>(header.postings, header.posting_count).subspan(it->first_posting, it->posting_count);
+}
+
+}  // namespace embedded
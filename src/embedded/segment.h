@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+
+namespace embedded {
+
+// Строка книги вне сегмента. Теги упорядочены и не повторяются
+struct BookRow {
+    domain::AuthorId author_id;
+    std::string title;
+    int publication_year = 0;
+    domain::Tags tags;
+
+    bool operator==(const BookRow&) const = default;
+};
+
+// Автор и книга, прочитанные из сегмента: строки указывают прямо в отображённый файл
+// и действительны, пока жив сегмент
+struct AuthorView {
+    domain::AuthorId id;
+    std::string_view name;
+};
+
+struct BookView {
+    domain::BookId id;
+    domain::AuthorId author_id;
+    std::string_view title;
+    int publication_year = 0;
+    // Теги книги — записи сегмента с first_tag по first_tag + tag_count, см. Segment::GetTag
+    uint64_t first_tag = 0;
+    uint32_t tag_count = 0;
+};
+
+// Неизменяемый снимок каталога в файле, отображённом в память. Авторы записаны в порядке (name, id),
+// книги — в порядке (title, id), а индексы по id, книгам автора и тегам — массивами позиций,
+// поэтому чтение — это двоичный поиск по отображению без разбора файла.
+// Позиция автора или книги — её номер в этом порядке.
+// Формат файла зависит от платформы: байты чисел в порядке процессора
+class Segment {
+public:
+    struct AuthorEntry {
+        domain::AuthorId id;
+        std::string name;
+    };
+
+    struct BookEntry {
+        domain::BookId id;
+        BookRow row;
+    };
+
+    // Пустой сегмент: каталог ещё ни разу не переносился в файл
+    Segment() = default;
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+    ~Segment();
+
+    // Отображает файл в память; файла нет — пустой сегмент. Бросает std::runtime_error, если файл повреждён
+    static std::shared_ptr<const Segment> Open(const std::filesystem::path& path);
+    // Записывает сегмент и дожидается его сохранения на диске. Авторы должны быть в порядке (name, id),
+    // книги — в порядке (title, id)
+    static void Write(const std::filesystem::path& path, const std::vector<AuthorEntry>& authors,
+                      const std::vector<BookEntry>& books);
+
+    size_t GetAuthorCount() const noexcept;
+    AuthorView GetAuthor(size_t position) const;
+    std::optional<size_t> FindAuthor(const domain::AuthorId& id) const;
+    // Первая позиция после ключа (name, id) и первая позиция с именем не меньше name
+    size_t GetAuthorAfter(std::string_view name, const domain::AuthorId& id) const;
+    size_t GetFirstAuthorFrom(std::string_view name) const;
+
+    size_t GetBookCount() const noexcept;
+    BookView GetBook(size_t position) const;
+    std::string_view GetTag(uint64_t index) const;
+    std::optional<size_t> FindBook(const domain::BookId& id) const;
+    size_t GetBookAfter(std::string_view title, const domain::BookId& id) const;
+    size_t GetFirstBookFrom(std::string_view title) const;
+    // Позиции книг автора в порядке (publication_year, title)
+    std::span<const uint32_t> GetBooksOfAuthor(const domain::AuthorId& author_id) const;
+    // Позиции книг с тегом по возрастанию, то есть в порядке (title, id)
+    std::span<const uint32_t> GetBooksWithTag(std::string_view tag) const;
+
+private:
+    struct Header;
+
+    const Header& GetHeader() const;
+    template <typename T>
+    std::span<const T> GetSection(uint64_t offset, uint64_t count) const;
+    std::string_view GetString(uint64_t offset, uint64_t size) const;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace embedded
@@ -1,6 +1,16 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <optional>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "bookypedia.h"
 
@@ -8,24 +18,171 @@ using namespace std::literals;
 
 namespace {
 
+constexpr const char STORAGE_ENV_NAME[]{"BOOKYPEDIA_STORAGE"};
+constexpr const char DATA_DIR_ENV_NAME[]{"BOOKYPEDIA_DATA_DIR"};
 constexpr const char DB_URL_ENV_NAME[]{"BOOKYPEDIA_DB_URL"};
+constexpr const char DB_POOL_SIZE_ENV_NAME[]{"BOOKYPEDIA_DB_POOL_SIZE"};
+constexpr const char DB_ACQUIRE_TIMEOUT_ENV_NAME[]{"BOOKYPEDIA_DB_ACQUIRE_TIMEOUT_MS"};
+constexpr const char DB_IDLE_CHECK_ENV_NAME[]{"BOOKYPEDIA_DB_IDLE_CHECK_MS"};
+constexpr const char DB_REPLICA_URLS_ENV_NAME[]{"BOOKYPEDIA_DB_REPLICA_URLS"};
+constexpr const char DB_REPLICA_SELECTION_ENV_NAME[]{"BOOKYPEDIA_DB_REPLICA_SELECTION"};
+constexpr const char DB_READ_YOUR_WRITES_ENV_NAME[]{"BOOKYPEDIA_DB_READ_YOUR_WRITES_MS"};
+constexpr const char DB_BINARY_UUIDS_ENV_NAME[]{"BOOKYPEDIA_DB_BINARY_UUIDS"};
+constexpr const char READ_MODEL_ENV_NAME[]{"BOOKYPEDIA_READ_MODEL"};
+constexpr const char STATS_FILE_ENV_NAME[]{"BOOKYPEDIA_STATS_FILE"};
+constexpr const char STATS_INTERVAL_ENV_NAME[]{"BOOKYPEDIA_STATS_INTERVAL_MS"};
+
+std::vector<std::string> SplitUrls(const std::string& urls) {
+    std::vector<std::string> result;
+    std::istringstream stream{urls};
+    std::string url;
+    while (std::getline(stream, url, ',')) {
+        if (!url.empty()) {
+            result.push_back(std::move(url));
+        }
+    }
+    return result;
+}
+
+// Разбирает число целиком; ошибка называет переменную или ключ и неверное значение
+template <typename Number>
+Number ParseNumber(std::string_view name, std::string_view value) {
+    Number number{};
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (error != std::errc{} || end != value.data() + value.size()) {
+        const auto* expected = std::is_signed_v<Number> ? " must be an integer" : " must be a non-negative integer";
+        throw std::runtime_error(std::string{name} + expected + ", got \""s.append(value) + "\"");
+    }
+    return number;
+}
+
+std::chrono::milliseconds ParseMilliseconds(std::string_view name, std::string_view value) {
+    return std::chrono::milliseconds{ParseNumber<std::chrono::milliseconds::rep>(name, value)};
+}
+
+postgres::ReplicaSelection ParseReplicaSelection(std::string_view name) {
+    if (name == "round-robin"sv) {
+        return postgres::ReplicaSelection::RoundRobin;
+    }
+    if (name == "least-loaded"sv) {
+        return postgres::ReplicaSelection::LeastLoaded;
+    }
+    throw std::runtime_error(DB_REPLICA_SELECTION_ENV_NAME + " must be round-robin or least-loaded"s);
+}
+
+bookypedia::StorageType ParseStorageType(std::string_view name) {
+    if (name == "postgres"sv) {
+        return bookypedia::StorageType::Postgres;
+    }
+    if (name == "memory"sv) {
+        return bookypedia::StorageType::Memory;
+    }
+    if (name == "embedded"sv) {
+        return bookypedia::StorageType::Embedded;
+    }
+    throw std::runtime_error(STORAGE_ENV_NAME + " must be postgres, memory or embedded"s);
+}
 
 bookypedia::AppConfig GetConfigFromEnv() {
     bookypedia::AppConfig config;
+    if (const auto* storage = std::getenv(STORAGE_ENV_NAME)) {
+        config.storage = ParseStorageType(storage);
+    }
     if (const auto* url = std::getenv(DB_URL_ENV_NAME)) {
-        config.db_url = url;
-    } else {
+        config.db.url = url;
+    } else if (config.storage == bookypedia::StorageType::Postgres) {
         throw std::runtime_error(DB_URL_ENV_NAME + " environment variable not found"s);
     }
+    if (const auto* data_dir = std::getenv(DATA_DIR_ENV_NAME)) {
+        config.embedded.directory = data_dir;
+    } else if (config.storage == bookypedia::StorageType::Embedded) {
+        throw std::runtime_error(DATA_DIR_ENV_NAME + " environment variable not found"s);
+    }
+
+    config.db.pool.capacity = std::max(1u, std::thread::hardware_concurrency());
+    if (const auto* pool_size = std::getenv(DB_POOL_SIZE_ENV_NAME)) {
+        config.db.pool.capacity = ParseNumber<size_t>(DB_POOL_SIZE_ENV_NAME, pool_size);
+    }
+    if (const auto* timeout = std::getenv(DB_ACQUIRE_TIMEOUT_ENV_NAME)) {
+        config.db.pool.acquire_timeout = ParseMilliseconds(DB_ACQUIRE_TIMEOUT_ENV_NAME, timeout);
+    }
+    if (const auto* interval = std::getenv(DB_IDLE_CHECK_ENV_NAME)) {
+        config.db.pool.idle_check_interval = ParseMilliseconds(DB_IDLE_CHECK_ENV_NAME, interval);
+    }
+
+    if (const auto* replica_urls = std::getenv(DB_REPLICA_URLS_ENV_NAME)) {
+        config.db.replica_urls = SplitUrls(replica_urls);
+    }
+    if (const auto* selection = std::getenv(DB_REPLICA_SELECTION_ENV_NAME)) {
+        config.db.replica_selection = ParseReplicaSelection(selection);
+    }
+    if (const auto* window = std::getenv(DB_READ_YOUR_WRITES_ENV_NAME)) {
+        config.db.read_your_writes_window = ParseMilliseconds(DB_READ_YOUR_WRITES_ENV_NAME, window);
+    }
+    if (const auto* binary_uuids = std::getenv(DB_BINARY_UUIDS_ENV_NAME)) {
+        config.db.uuid_format = binary_uuids == "1"sv ? postgres::UuidFormat::Binary : postgres::UuidFormat::Text;
+    }
+    if (const auto* read_model = std::getenv(READ_MODEL_ENV_NAME)) {
+        config.read_model = read_model == "1"sv;
+    }
+    if (const auto* stats_file = std::getenv(STATS_FILE_ENV_NAME)) {
+        config.stats_file = stats_file;
+    }
+    if (const auto* interval = std::getenv(STATS_INTERVAL_ENV_NAME)) {
+        config.stats_interval = ParseMilliseconds(STATS_INTERVAL_ENV_NAME, interval);
+    }
     return config;
 }
 
+struct CommandLine {
+    std::optional<std::string> script;
+    size_t transaction_group_size = 1;
+};
+
+// bookypedia [--script <file> [--group-size <N>]]
+CommandLine ParseCommandLine(int argc, const char* argv[]) {
+    CommandLine command_line;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg != "--script"sv && arg != "--group-size"sv) {
+            throw std::runtime_error("Unknown option "s.append(arg));
+        }
+        if (++i == argc) {
+            throw std::runtime_error("Missing value of "s.append(arg));
+        }
+        if (arg == "--script"sv) {
+            command_line.script = argv[i];
+        } else {
+            command_line.transaction_group_size = ParseNumber<size_t>(arg, argv[i]);
+            if (command_line.transaction_group_size == 0) {
+                throw std::runtime_error("--group-size must be positive");
+            }
+        }
+    }
+    if (!command_line.script && command_line.transaction_group_size > 1) {
+        throw std::runtime_error("--group-size requires --script");
+    }
+    return command_line;
+}
+
 }  // namespace
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] const char* argv[]) {
+int main(int argc, const char* argv[]) {
     try {
-        bookypedia::Application app{GetConfigFromEnv()};
-        app.Run();
+        const auto command_line = ParseCommandLine(argc, argv);
+        auto config = GetConfigFromEnv();
+        config.transaction_group_size = command_line.transaction_group_size;
+
+        if (command_line.script) {
+            // Вывод сценария не смешивается с stdio, поэтому std::cout буферизуется сам
+            // и сбрасывается, только когда заполнится буфер
+            std::ios::sync_with_stdio(false);
+            bookypedia::Application app{config};
+            app.RunScript(*command_line.script);
+        } else {
+            bookypedia::Application app{config};
+            app.Run();
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
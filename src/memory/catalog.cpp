@@ -0,0 +1,468 @@
+#include "catalog.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "../util/words.h"
+
+namespace memory {
+using namespace domain;
+
+namespace {
+
+// Нижняя граница ключей с заданным текстом: нулевой UUID меньше любого другого
+template <typename Id>
+TextKey<Id> FirstKeyWith(const std::string& text) {
+    return {text, Id{}};
+}
+
+BookKey TitleKey(const BookId& id, const BookRow& row) {
+    return {row.title, id};
+}
+
+AuthorBookKey AuthorKeyOf(const BookId& id, const BookRow& row) {
+    return {row.author_id, row.publication_year, row.title, id};
+}
+
+Tags NormalizeTags(Tags tags) {
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+    return tags;
+}
+
+template <typename Index, typename Key>
+void IndexWords(Index& index, std::string_view text, const Key& key) {
+    for (auto& word : util::SplitWords(text)) {
+        index[std::move(word)].insert(key);
+    }
+}
+
+template <typename Index, typename Key>
+void UnindexWords(Index& index, std::string_view text, const Key& key) {
+    for (const auto& word : util::SplitWords(text)) {
+        if (auto it = index.find(word); it != index.end() && it->second.erase(key) && it->second.empty()) {
+            index.erase(it);
+        }
+    }
+}
+
+// Упорядоченные ключи, у которых с каждого слова запроса начинается одно из слов текста ключа.
+// Кандидаты берутся по слову запроса с самым коротким списком, остальные слова проверяются по тексту кандидата
+template <typename Index>
+auto MatchAllWords(const Index& index, const std::vector<std::string>& words) {
+    using Key = typename Index::mapped_type::value_type;
+
+    auto prefix_range = [&index](const std::string& word) {
+        const auto first = index.lower_bound(word);
+        auto last = first;
+        while (last != index.end() && last->first.starts_with(word)) {
+            ++last;
+        }
+        return std::pair{first, last};
+    };
+
+    size_t rarest = 0;
+    size_t rarest_size = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < words.size() && rarest_size > 0; ++i) {
+        size_t size = 0;
+        for (auto [it, last] = prefix_range(words[i]); it != last; ++it) {
+            size += it->second.size();
+        }
+        if (size < rarest_size) {
+            rarest = i;
+            rarest_size = size;
+        }
+    }
+
+    std::vector<Key> result;
+    for (auto [it, last] = prefix_range(words[rarest]); it != last; ++it) {
+        for (const auto& key : it->second) {
+            const auto text_words = util::SplitWords(key.text);
+            const bool matches = std::all_of(words.begin(), words.end(), [&text_words](const std::string& word) {
+                return std::any_of(text_words.begin(), text_words.end(), [&word](const std::string& text_word) {
+                    return text_word.starts_with(word);
+                });
+            });
+            if (matches) {
+                result.push_back(key);
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end(),
+                             [](const Key& lhs, const Key& rhs) {
+                                 return lhs.id == rhs.id;
+                             }),
+                 result.end());
+    return result;
+}
+
+}  // namespace
+
+void Catalog::SaveAuthor(const Author& author, UndoLog& undo) {
+    if (const auto existing = FindAuthorByName(author.GetName()); existing && existing->GetId() != author.GetId()) {
+        throw AuthorExistsError{};
+    }
+    SetAuthor(author.GetId(), author.GetName(), undo);
+}
+
+void Catalog::EditAuthor(const AuthorId& id, const std::string& new_name, UndoLog& undo) {
+    if (authors_.contains(id)) {
+        SaveAuthor({id, new_name}, undo);
+    }
+}
+
+// Как INSERT ... ON CONFLICT (name) DO NOTHING: сначала добавленные авторы, затем уже существовавшие.
+// Повтор имени, добавленного этим же вызовом, не попадает в результат
+Authors Catalog::AddMissingAuthors(const Authors& authors, UndoLog& undo) {
+    Authors inserted;
+    Authors existing;
+    std::unordered_set<std::string> inserted_names;
+    for (const auto& author : authors) {
+        if (auto found = FindAuthorByName(author.GetName())) {
+            if (!inserted_names.contains(author.GetName())) {
+                existing.push_back(std::move(*found));
+            }
+        } else {
+            SetAuthor(author.GetId(), author.GetName(), undo);
+            inserted_names.insert(author.GetName());
+            inserted.push_back(author);
+        }
+    }
+    inserted.insert(inserted.end(), std::make_move_iterator(existing.begin()),
+                    std::make_move_iterator(existing.end()));
+    return inserted;
+}
+
+void Catalog::DeleteAuthor(const AuthorId& id, UndoLog& undo) {
+    if (!authors_.contains(id)) {
+        return;
+    }
+
+    std::vector<BookId> book_ids;
+    for (auto it = books_by_author_.lower_bound({id, std::numeric_limits<int>::min(), {}, {}});
+         it != books_by_author_.end() && it->author_id == id; ++it) {
+        book_ids.push_back(it->id);
+    }
+    for (const auto& book_id : book_ids) {
+        SetBook(book_id, std::nullopt, undo);
+    }
+    SetAuthor(id, std::nullopt, undo);
+}
+
+void Catalog::SaveBook(const Book& book, UndoLog& undo) {
+    CheckAuthorExists(book.GetAuthorId());
+    SetBook(book.GetBookId(),
+            BookRow{book.GetAuthorId(), book.GetTitle(), book.GetPublicationYear(), NormalizeTags(book.GetTags())},
+            undo);
+}
+
+void Catalog::AddBooks(const Books& books, UndoLog& undo) {
+    for (const auto& book : books) {
+        if (books_.contains(book.GetBookId())) {
+            throw std::runtime_error("Book " + book.GetBookId().ToString() + " already exists");
+        }
+        SaveBook(book, undo);
+    }
+}
+
+void Catalog::EditBook(const BookId& id, const std::string& title, int publication_year, const Tags& tags,
+                       UndoLog& undo) {
+    if (auto it = books_.find(id); it != books_.end()) {
+        SetBook(id, BookRow{it->second.author_id, title, publication_year, NormalizeTags(tags)}, undo);
+    }
+}
+
+void Catalog::DeleteBook(const BookId& id, UndoLog& undo) {
+    if (books_.contains(id)) {
+        SetBook(id, std::nullopt, undo);
+    }
+}
+
+void Catalog::Undo(UndoLog& undo) noexcept {
+    for (auto it = undo.rbegin(); it != undo.rend(); ++it) {
+        if (auto* author = std::get_if<AuthorChange>(&*it)) {
+            PutAuthor(author->id, std::move(author->old_name));
+        } else {
+            auto& book = std::get<BookChange>(*it);
+            PutBook(book.id, std::move(book.old_row));
+        }
+    }
+    undo.clear();
+}
+
+void Catalog::SetAuthor(const AuthorId& id, std::optional<std::string> name, UndoLog& undo) {
+    const auto it = authors_.find(id);
+    undo.push_back(AuthorChange{id, it != authors_.end() ? std::optional{it->second} : std::nullopt});
+    PutAuthor(id, std::move(name));
+}
+
+void Catalog::SetBook(const BookId& id, std::optional<BookRow> row, UndoLog& undo) {
+    const auto it = books_.find(id);
+    undo.push_back(BookChange{id, it != books_.end() ? std::optional{it->second} : std::nullopt});
+    PutBook(id, std::move(row));
+}
+
+// Имя автора хранится только в его строке: книги берут его при чтении, поэтому их индексы не меняются
+void Catalog::PutAuthor(const AuthorId& id, std::optional<std::string> name) {
+    if (auto it = authors_.find(id); it != authors_.end()) {
+        const AuthorKey key{it->second, id};
+        authors_by_name_.erase(key);
+        UnindexWords(authors_by_name_word_, key.text, key);
+        authors_.erase(it);
+    }
+    if (name) {
+        const AuthorKey key{*name, id};
+        authors_by_name_.insert(key);
+        IndexWords(authors_by_name_word_, key.text, key);
+        authors_.emplace(id, std::move(*name));
+    }
+}
+
+void Catalog::PutBook(const BookId& id, std::optional<BookRow> row) {
+    if (auto it = books_.find(id); it != books_.end()) {
+        const auto& old_row = it->second;
+        const auto key = TitleKey(id, old_row);
+        books_by_title_.erase(key);
+        books_by_author_.erase(AuthorKeyOf(id, old_row));
+        for (const auto& tag : old_row.tags) {
+            if (auto tag_it = books_by_tag_.find(tag); tag_it->second.erase(key) && tag_it->second.empty()) {
+                books_by_tag_.erase(tag_it);
+            }
+        }
+        UnindexWords(books_by_title_word_, key.text, key);
+        books_.erase(it);
+    }
+    if (row) {
+        const auto key = TitleKey(id, *row);
+        books_by_title_.insert(key);
+        books_by_author_.insert(AuthorKeyOf(id, *row));
+        for (const auto& tag : row->tags) {
+            books_by_tag_[tag].insert(key);
+        }
+        IndexWords(books_by_title_word_, key.text, key);
+        books_.emplace(id, std::move(*row));
+    }
+}
+
+void Catalog::CheckAuthorExists(const AuthorId& id) const {
+    if (!authors_.contains(id)) {
+        throw std::runtime_error("Author " + id.ToString() + " does not exist");
+    }
+}
+
+Book Catalog::ToBook(const BookId& id, const BookRow& row) const {
+    return {id, row.author_id, row.title, row.publication_year, row.tags, authors_.at(row.author_id)};
+}
+
+Books Catalog::ToBooks(const std::vector<BookKey>& keys) const {
+    Books books;
+    books.reserve(keys.size());
+    for (const auto& key : keys) {
+        books.push_back(ToBook(key.id, books_.at(key.id)));
+    }
+    return books;
+}
+
+Authors Catalog::GetAuthorsPage(const std::optional<AuthorsPageKey>& after, size_t limit) const {
+    auto it = after ? authors_by_name_.upper_bound({after->name, after->id}) : authors_by_name_.begin();
+    Authors authors;
+    for (; it != authors_by_name_.end() && authors.size() < limit; ++it) {
+        authors.emplace_back(it->id, it->text);
+    }
+    return authors;
+}
+
+void Catalog::ForEachAuthor(const AuthorVisitor& visitor) const {
+    for (const auto& key : authors_by_name_) {
+        visitor(Author{key.id, key.text});
+    }
+}
+
+std::optional<Author> Catalog::FindAuthorById(const AuthorId& id) const {
+    if (auto it = authors_.find(id); it != authors_.end()) {
+        return Author{id, it->second};
+    }
+    return std::nullopt;
+}
+
+std::optional<Author> Catalog::FindAuthorByName(const std::string& name) const {
+    if (auto it = authors_by_name_.lower_bound(FirstKeyWith<AuthorId>(name));
+        it != authors_by_name_.end() && it->text == name) {
+        return Author{it->id, it->text};
+    }
+    return std::nullopt;
+}
+
+size_t Catalog::DumpAuthors(const DumpPart& part, const DumpLineSink& sink) const {
+    size_t count = 0;
+    std::string line;
+    for (const auto& [id, name] : authors_) {
+        if (InDumpPart(id, part)) {
+            line = id.ToString();
+            line.push_back('\t');
+            AppendCopyField(line, name);
+            sink(line);
+            ++count;
+        }
+    }
+    return count;
+}
+
+Books Catalog::GetBooksPage(const std::optional<BooksPageKey>& after, size_t limit) const {
+    auto it = after ? books_by_title_.upper_bound({after->title, after->id}) : books_by_title_.begin();
+    Books books;
+    for (; it != books_by_title_.end() && books.size() < limit; ++it) {
+        books.push_back(ToBook(it->id, books_.at(it->id)));
+    }
+    return books;
+}
+
+void Catalog::ForEachBook(const BookVisitor& visitor) const {
+    for (const auto& key : books_by_title_) {
+        visitor(ToBook(key.id, books_.at(key.id)));
+    }
+}
+
+// Как и в Postgres, книги автора выдаются без его имени
+Books Catalog::GetBooksByAuthorId(const AuthorId& author_id) const {
+    Books books;
+    for (auto it = books_by_author_.lower_bound({author_id, std::numeric_limits<int>::min(), {}, {}});
+         it != books_by_author_.end() && it->author_id == author_id; ++it) {
+        const auto& row = books_.at(it->id);
+        books.emplace_back(it->id, row.author_id, row.title, row.publication_year, row.tags);
+    }
+    return books;
+}
+
+Books Catalog::GetBooksByTitle(const std::string& title) const {
+    Books books;
+    for (auto it = books_by_title_.lower_bound(FirstKeyWith<BookId>(title));
+         it != books_by_title_.end() && it->text == title; ++it) {
+        books.push_back(ToBook(it->id, books_.at(it->id)));
+    }
+    std::stable_sort(books.begin(), books.end(), [](const Book& lhs, const Book& rhs) {
+        return lhs.GetPublicationYear() < rhs.GetPublicationYear();
+    });
+    return books;
+}
+
+// Ранжирование упрощено по сравнению с Postgres: после точных совпадений названия идут совпадения
+// по названию, затем по автору, внутри групп — в порядке (title, id)
+Books Catalog::SearchBooks(const std::string& query, size_t limit) const {
+    const auto words = util::SplitWords(query);
+    if (words.empty()) {
+        return {};
+    }
+
+    const auto title_matches = MatchAllWords(books_by_title_word_, words);
+    std::vector<BookKey> author_matches;
+    for (const auto& author : MatchAllWords(authors_by_name_word_, words)) {
+        for (auto it = books_by_author_.lower_bound({author.id, std::numeric_limits<int>::min(), {}, {}});
+             it != books_by_author_.end() && it->author_id == author.id; ++it) {
+            author_matches.push_back({it->title, it->id});
+        }
+    }
+    std::sort(author_matches.begin(), author_matches.end());
+
+    std::vector<BookKey> exact;
+    std::vector<BookKey> keys;
+    for (const auto& key : title_matches) {
+        (key.text == query ? exact : keys).push_back(key);
+    }
+    std::set_difference(author_matches.begin(), author_matches.end(), title_matches.begin(), title_matches.end(),
+                        std::back_inserter(keys));
+    keys.insert(keys.begin(), exact.begin(), exact.end());
+
+    keys.resize(std::min(keys.size(), limit));
+    return ToBooks(keys);
+}
+
+// Книги со всеми тегами ищутся перебором самого короткого из списков тегов, с любым из тегов —
+// слиянием первых limit книг каждого списка после ключа страницы
+Books Catalog::GetBooksByTags(const Tags& tags, TagMatch match, const std::optional<BooksPageKey>& after,
+                              size_t limit) const {
+    const auto unique_tags = NormalizeTags(tags);
+    std::vector<const std::set<BookKey>*> lists;
+    for (const auto& tag : unique_tags) {
+        if (auto it = books_by_tag_.find(tag); it != books_by_tag_.end()) {
+            lists.push_back(&it->second);
+        } else if (match == TagMatch::All) {
+            return {};
+        }
+    }
+    if (lists.empty()) {
+        return {};
+    }
+
+    auto first_after = [&after](const std::set<BookKey>& list) {
+        return after ? list.upper_bound({after->title, after->id}) : list.begin();
+    };
+
+    std::vector<BookKey> keys;
+    if (match == TagMatch::All) {
+        const auto& shortest = **std::min_element(lists.begin(), lists.end(), [](const auto* lhs, const auto* rhs) {
+            return lhs->size() < rhs->size();
+        });
+        for (auto it = first_after(shortest); it != shortest.end() && keys.size() < limit; ++it) {
+            const auto& book_tags = books_.at(it->id).tags;
+            if (std::includes(book_tags.begin(), book_tags.end(), unique_tags.begin(), unique_tags.end())) {
+                keys.push_back(*it);
+            }
+        }
+    } else {
+        for (const auto* list : lists) {
+            auto it = first_after(*list);
+            for (size_t i = 0; it != list->end() && i < limit; ++it, ++i) {
+                keys.push_back(*it);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end(),
+                               [](const BookKey& lhs, const BookKey& rhs) {
+                                   return lhs.id == rhs.id;
+                               }),
+                   keys.end());
+        keys.resize(std::min(keys.size(), limit));
+    }
+    return ToBooks(keys);
+}
+
+size_t Catalog::DumpBooks(const DumpPart& part, const DumpLineSink& sink) const {
+    size_t count = 0;
+    std::string line;
+    for (const auto& [id, row] : books_) {
+        if (InDumpPart(id, part)) {
+            line = id.ToString();
+            line.append("\t").append(row.author_id.ToString()).push_back('\t');
+            AppendCopyField(line, row.title);
+            line.append("\t").append(std::to_string(row.publication_year));
+            sink(line);
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t Catalog::DumpBookTags(const DumpPart& part, const DumpLineSink& sink) const {
+    size_t count = 0;
+    std::string line;
+    for (const auto& [id, row] : books_) {
+        if (!InDumpPart(id, part)) {
+            continue;
+        }
+        for (const auto& tag : row.tags) {
+            line = id.ToString();
+            line.push_back('\t');
+            AppendCopyField(line, tag);
+            sink(line);
+            ++count;
+        }
+    }
+    return count;
+}
+
+}  // namespace memory
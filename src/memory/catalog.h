@@ -0,0 +1,133 @@
+#pragma once
+
+#include <boost/uuid/uuid_hash.hpp>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+
+namespace memory {
+
+// Строка таблицы книг. Теги упорядочены и не повторяются, как их выдаёт Postgres
+struct BookRow {
+    domain::AuthorId author_id;
+    std::string title;
+    int publication_year = 0;
+    domain::Tags tags;
+};
+
+// Ключ упорядоченного индекса в порядке выдачи Postgres: (name, id) у авторов, (title, id) у книг
+template <typename Id>
+struct TextKey {
+    std::string text;
+    Id id;
+
+    bool operator<(const TextKey& other) const {
+        return std::tie(text, *id) < std::tie(other.text, *other.id);
+    }
+};
+
+using AuthorKey = TextKey<domain::AuthorId>;
+using BookKey = TextKey<domain::BookId>;
+
+// Ключ индекса книг автора: книги автора идут подряд в порядке (publication_year, title)
+struct AuthorBookKey {
+    domain::AuthorId author_id;
+    int publication_year = 0;
+    std::string title;
+    domain::BookId id;
+
+    bool operator<(const AuthorBookKey& other) const {
+        return std::tie(*author_id, publication_year, title, *id) <
+               std::tie(*other.author_id, other.publication_year, other.title, *other.id);
+    }
+};
+
+// Прежние значения изменённых строк; nullopt — строки не было
+struct AuthorChange {
+    domain::AuthorId id;
+    std::optional<std::string> old_name;
+};
+
+struct BookChange {
+    domain::BookId id;
+    std::optional<BookRow> old_row;
+};
+
+// Журнал отката транзакции: изменения откатываются в обратном порядке восстановлением прежних строк
+using UndoLog = std::vector<std::variant<AuthorChange, BookChange>>;
+
+// Каталог в памяти: строки авторов и книг в хеш-таблицах по id и упорядоченные индексы,
+// повторяющие порядок выдачи и ограничения таблиц Postgres. Методы изменения проверяют ограничения
+// до изменения строк и дописывают их прежние значения в журнал отката.
+// Синхронизацию обеспечивает владелец каталога
+class Catalog {
+public:
+    // Бросают domain::AuthorExistsError, если имя занято другим автором
+    void SaveAuthor(const domain::Author& author, UndoLog& undo);
+    void EditAuthor(const domain::AuthorId& id, const std::string& new_name, UndoLog& undo);
+    domain::Authors AddMissingAuthors(const domain::Authors& authors, UndoLog& undo);
+    // Удаляет автора вместе с его книгами, как каскадный внешний ключ
+    void DeleteAuthor(const domain::AuthorId& id, UndoLog& undo);
+
+    // Бросают std::runtime_error, если автора книги нет, а AddBooks — ещё и если книга с таким id уже есть
+    void SaveBook(const domain::Book& book, UndoLog& undo);
+    void AddBooks(const domain::Books& books, UndoLog& undo);
+    void EditBook(const domain::BookId& id, const std::string& title, int publication_year, const domain::Tags& tags,
+                  UndoLog& undo);
+    void DeleteBook(const domain::BookId& id, UndoLog& undo);
+
+    // Возвращает строки к значениям до изменений из журнала и очищает его
+    void Undo(UndoLog& undo) noexcept;
+
+    domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) const;
+    void ForEachAuthor(const domain::AuthorVisitor& visitor) const;
+    std::optional<domain::Author> FindAuthorById(const domain::AuthorId& id) const;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) const;
+    size_t DumpAuthors(const domain::DumpPart& part, const domain::DumpLineSink& sink) const;
+
+    domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) const;
+    void ForEachBook(const domain::BookVisitor& visitor) const;
+    domain::Books GetBooksByAuthorId(const domain::AuthorId& author_id) const;
+    domain::Books GetBooksByTitle(const std::string& title) const;
+    domain::Books SearchBooks(const std::string& query, size_t limit) const;
+    domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                 const std::optional<domain::BooksPageKey>& after, size_t limit) const;
+    size_t DumpBooks(const domain::DumpPart& part, const domain::DumpLineSink& sink) const;
+    size_t DumpBookTags(const domain::DumpPart& part, const domain::DumpLineSink& sink) const;
+
+private:
+    // Слова названий и имён в нижнем регистре; упорядочены для поиска по префиксу
+    template <typename Key>
+    using WordIndex = std::map<std::string, std::set<Key>, std::less<>>;
+
+    // Записывают строку в журнал и заменяют её новым значением; nullopt удаляет строку
+    void SetAuthor(const domain::AuthorId& id, std::optional<std::string> name, UndoLog& undo);
+    void SetBook(const domain::BookId& id, std::optional<BookRow> row, UndoLog& undo);
+    // Заменяют строку вместе со всеми её индексами
+    void PutAuthor(const domain::AuthorId& id, std::optional<std::string> name);
+    void PutBook(const domain::BookId& id, std::optional<BookRow> row);
+
+    void CheckAuthorExists(const domain::AuthorId& id) const;
+    domain::Book ToBook(const domain::BookId& id, const BookRow& row) const;
+    domain::Books ToBooks(const std::vector<BookKey>& keys) const;
+
+    std::unordered_map<domain::AuthorId, std::string, util::TaggedHasher<domain::AuthorId>> authors_;
+    std::set<AuthorKey> authors_by_name_;
+    WordIndex<AuthorKey> authors_by_name_word_;
+
+    std::unordered_map<domain::BookId, BookRow, util::TaggedHasher<domain::BookId>> books_;
+    std::set<BookKey> books_by_title_;
+    std::set<AuthorBookKey> books_by_author_;
+    std::unordered_map<std::string, std::set<BookKey>> books_by_tag_;
+    WordIndex<BookKey> books_by_title_word_;
+};
+
+}  // namespace memory
@@ -0,0 +1,506 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../app/unit_of_work.h"
+#include "../domain/author.h"
+#include "../domain/book.h"
+#include "../util/stats.h"
+
+// Транзакции, репозитории и единицы работы над каталогом в памяти процесса, общие для хранилищ
+// memory и embedded. Хранилище задаёт общий для единиц работы каталог Shared:
+//  catalog — каталог с методами изменения, принимающими UndoLog, и методами чтения;
+//  UndoLog — журнал отката изменений каталога;
+//  mutex и writer — блокировка каталога и поток, чья транзакция держит его для изменений;
+//  CommitChanges(undo, release) — фиксирует изменения транзакции из undo, очищает undo и вызывает
+//  release, чтобы освободить каталог. Если изменения не зафиксированы, бросает исключение,
+//  не вызывая release, и транзакция откатывается
+namespace memory {
+
+// Транзакция единицы работы. Как и в Postgres, чтения видят только зафиксированные изменения других
+// транзакций и свои незафиксированные. Первое изменение захватывает каталог до фиксации или отката,
+// поэтому пишущие транзакции выполняются по очереди, а чтения других транзакций ждут фиксации.
+// Поток, держащий каталог для изменений, не может читать и изменять его через другую транзакцию:
+// он ждал бы сам себя, поэтому такая попытка бросает std::logic_error
+template <typename Shared>
+class BasicTransaction {
+public:
+    using Catalog = std::remove_cvref_t<decltype(std::declval<Shared&>().catalog)>;
+    using UndoLog = typename Shared::UndoLog;
+
+    BasicTransaction(Shared& shared, bool writable) : shared_{&shared}, writable_{writable} {}
+    // Транзакция только для чтения над неизменяемым снимком
+    explicit BasicTransaction(std::shared_ptr<const Catalog> snapshot) : snapshot_{std::move(snapshot)} {}
+
+    BasicTransaction(const BasicTransaction&) = delete;
+    BasicTransaction& operator=(const BasicTransaction&) = delete;
+
+    // Незафиксированные изменения откатываются
+    ~BasicTransaction() {
+        Rollback();
+    }
+
+    template <typename Reader>
+    decltype(auto) Read(Reader&& reader) {
+        if (snapshot_) {
+            return reader(std::as_const(*snapshot_));
+        }
+        if (lock_.owns_lock()) {
+            return reader(std::as_const(shared_->catalog));
+        }
+        CheckNotWriter();
+        std::shared_lock lock{shared_->mutex};
+        return reader(std::as_const(shared_->catalog));
+    }
+
+    template <typename Writer>
+    decltype(auto) Write(Writer&& writer) {
+        if (!writable_) {
+            throw std::logic_error("Read-only unit of work can't change the catalog");
+        }
+        if (!lock_.owns_lock()) {
+            CheckNotWriter();
+            lock_ = std::unique_lock{shared_->mutex};
+            shared_->writer = std::this_thread::get_id();
+        }
+        return writer(shared_->catalog, undo_);
+    }
+
+    void Commit() {
+        if (!lock_.owns_lock()) {
+            return;
+        }
+        try {
+            shared_->CommitChanges(undo_, [this] {
+                Release();
+            });
+        } catch (...) {
+            Rollback();
+            throw;
+        }
+    }
+
+    void Rollback() noexcept {
+        if (lock_.owns_lock()) {
+            shared_->catalog.Undo(undo_);
+        }
+        Release();
+    }
+
+    // Точка сохранения — позиция в журнале отката: откат к ней отменяет записи после неё
+    void SetSavepoint() {
+        savepoints_.push_back(undo_.size());
+    }
+
+    void ReleaseSavepoint() {
+        PopSavepoint();
+    }
+
+    void RollbackToSavepoint() {
+        const auto savepoint = PopSavepoint();
+        if (undo_.size() > savepoint) {
+            const auto first = undo_.begin() + static_cast<std::ptrdiff_t>(savepoint);
+            UndoLog changes{std::make_move_iterator(first), std::make_move_iterator(undo_.end())};
+            undo_.erase(first, undo_.end());
+            shared_->catalog.Undo(changes);
+        }
+    }
+
+private:
+    void CheckNotWriter() const {
+        if (shared_->writer.load() == std::this_thread::get_id()) {
+            throw std::logic_error("The catalog is locked by an uncommitted unit of work of this thread");
+        }
+    }
+
+    void Release() noexcept {
+        savepoints_.clear();
+        if (lock_.owns_lock()) {
+            shared_->writer = std::thread::id{};
+            lock_.unlock();
+        }
+    }
+
+    size_t PopSavepoint() {
+        if (savepoints_.empty()) {
+            throw std::logic_error("No savepoint is set");
+        }
+        const auto savepoint = savepoints_.back();
+        savepoints_.pop_back();
+        return savepoint;
+    }
+
+    Shared* shared_ = nullptr;
+    std::shared_ptr<const Catalog> snapshot_;
+    bool writable_ = false;
+    std::unique_lock<std::shared_mutex> lock_;
+    UndoLog undo_;
+    // Размеры undo_ в точках сохранения
+    std::vector<size_t> savepoints_;
+};
+
+template <typename Shared>
+class BasicAuthorRepository : public domain::AuthorRepository {
+public:
+    explicit BasicAuthorRepository(BasicTransaction<Shared>& transaction) : transaction_{transaction} {}
+
+    void Save(const domain::Author& author) override;
+    domain::Authors AddMissingAuthors(const domain::Authors& authors) override;
+    void Delete(const domain::AuthorId& author_id) override;
+    void Edit(const domain::AuthorId& author_id, const std::string& new_name) override;
+
+    domain::Authors GetAllAuthors() override;
+    domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) override;
+    // visitor вызывается под блокировкой каталога и не должен менять его
+    void ForEachAuthor(const domain::AuthorVisitor& visitor) override;
+    std::optional<domain::Author> FindAuthorById(const domain::AuthorId& author_id) override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+
+    size_t DumpAuthors(const domain::DumpPart& part, const domain::DumpLineSink& sink) override;
+
+private:
+    using Catalog = typename BasicTransaction<Shared>::Catalog;
+    using UndoLog = typename BasicTransaction<Shared>::UndoLog;
+
+    BasicTransaction<Shared>& transaction_;
+};
+
+template <typename Shared>
+class BasicBookRepository : public domain::BookRepository {
+public:
+    explicit BasicBookRepository(BasicTransaction<Shared>& transaction) : transaction_{transaction} {}
+
+    void Save(const domain::Book& book) override;
+    void AddBooks(const domain::Books& books) override;
+    domain::Books GetAllBooks() override;
+    domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) override;
+    // visitor вызывается под блокировкой каталога и не должен менять его
+    void ForEachBook(const domain::BookVisitor& visitor) override;
+    domain::Books GetBooksByAuthorId(const domain::AuthorId& author_id) override;
+    domain::Books GetBooksByTitle(const std::string& title) override;
+    domain::Books SearchBooks(const std::string& query, size_t limit) override;
+    domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                 const std::optional<domain::BooksPageKey>& after, size_t limit) override;
+    void DeleteBook(const domain::BookId& book_id) override;
+    void EditBook(const domain::BookId& book_id, const std::string& title, int publication_year,
+                  const domain::Tags& tags) override;
+
+    size_t DumpBooks(const domain::DumpPart& part, const domain::DumpLineSink& sink) override;
+    size_t DumpBookTags(const domain::DumpPart& part, const domain::DumpLineSink& sink) override;
+
+private:
+    using Catalog = typename BasicTransaction<Shared>::Catalog;
+    using UndoLog = typename BasicTransaction<Shared>::UndoLog;
+
+    BasicTransaction<Shared>& transaction_;
+};
+
+template <typename Shared>
+class BasicUnitOfWork : public app::UnitOfWork {
+public:
+    explicit BasicUnitOfWork(Shared& shared) : transaction_{shared, true} {}
+
+    domain::AuthorRepository& Authors() override {
+        return authors_;
+    }
+
+    domain::BookRepository& Books() override {
+        return books_;
+    }
+
+    void Commit() override {
+        transaction_.Commit();
+    }
+
+    void SetSavepoint() override {
+        transaction_.SetSavepoint();
+    }
+
+    void ReleaseSavepoint() override {
+        transaction_.ReleaseSavepoint();
+    }
+
+    void RollbackToSavepoint() override {
+        transaction_.RollbackToSavepoint();
+    }
+
+private:
+    BasicTransaction<Shared> transaction_;
+    BasicAuthorRepository<Shared> authors_{transaction_};
+    BasicBookRepository<Shared> books_{transaction_};
+};
+
+template <typename Shared>
+class BasicReadOnlyUnitOfWork : public app::ReadOnlyUnitOfWork {
+public:
+    using Catalog = typename BasicTransaction<Shared>::Catalog;
+
+    explicit BasicReadOnlyUnitOfWork(Shared& shared) : transaction_{shared, false} {}
+    explicit BasicReadOnlyUnitOfWork(std::shared_ptr<const Catalog> snapshot) : transaction_{std::move(snapshot)} {}
+
+    domain::AuthorRepository& Authors() override {
+        return authors_;
+    }
+
+    domain::BookRepository& Books() override {
+        return books_;
+    }
+
+private:
+    BasicTransaction<Shared> transaction_;
+    BasicAuthorRepository<Shared> authors_{transaction_};
+    BasicBookRepository<Shared> books_{transaction_};
+};
+
+// Фабрика единиц работы над общим каталогом
+template <typename Shared>
+class BasicDatabase : public app::UnitOfWorkFactory {
+public:
+    app::UnitOfWorkPtr GetUnitOfWork() override {
+        ++transaction_count_;
+        return std::make_unique<BasicUnitOfWork<Shared>>(shared_);
+    }
+
+    // Изменения применяются к каталогу сразу, их не нужно отправлять пачками, поэтому это обычная единица работы
+    app::UnitOfWorkPtr GetBatchUnitOfWork() override {
+        return GetUnitOfWork();
+    }
+
+    app::ReadOnlyUnitOfWorkPtr GetReadOnlyUnitOfWork() override {
+        ++transaction_count_;
+        return std::make_unique<BasicReadOnlyUnitOfWork<Shared>>(shared_);
+    }
+
+    // Единицы работы читают одну копию каталога, снятую под блокировкой: пишущие транзакции
+    // не ждут, пока снимок читается
+    std::vector<app::ReadOnlyUnitOfWorkPtr> GetSnapshotUnitsOfWork(size_t count) override;
+
+    // Сколько транзакций открыто с момента создания, включая транзакции только для чтения
+    size_t GetTransactionCount() const noexcept {
+        return transaction_count_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    template <typename... Args>
+    explicit BasicDatabase(Args&&... args) : shared_{std::forward<Args>(args)...} {}
+
+    Shared shared_;
+
+private:
+    std::atomic<size_t> transaction_count_{0};
+};
+
+template <typename Shared>
+void BasicAuthorRepository<Shared>::Save(const domain::Author& author) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.Save");
+    transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        catalog.SaveAuthor(author, undo);
+    });
+}
+
+template <typename Shared>
+domain::Authors BasicAuthorRepository<Shared>::AddMissingAuthors(const domain::Authors& authors) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.AddMissingAuthors");
+    return transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.AddMissingAuthors(authors, undo));
+    });
+}
+
+template <typename Shared>
+void BasicAuthorRepository<Shared>::Delete(const domain::AuthorId& author_id) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.Delete");
+    transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        catalog.DeleteAuthor(author_id, undo);
+    });
+}
+
+template <typename Shared>
+void BasicAuthorRepository<Shared>::Edit(const domain::AuthorId& author_id, const std::string& new_name) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.Edit");
+    transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        catalog.EditAuthor(author_id, new_name, undo);
+    });
+}
+
+template <typename Shared>
+domain::Authors BasicAuthorRepository<Shared>::GetAllAuthors() {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.GetAllAuthors");
+    return BOOKYPEDIA_COUNT_ROWS(GetAuthorsPage(std::nullopt, std::numeric_limits<size_t>::max()));
+}
+
+template <typename Shared>
+domain::Authors BasicAuthorRepository<Shared>::GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after,
+                                                              size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.GetAuthorsPage");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.GetAuthorsPage(after, limit));
+    });
+}
+
+template <typename Shared>
+void BasicAuthorRepository<Shared>::ForEachAuthor(const domain::AuthorVisitor& visitor) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.ForEachAuthor");
+    transaction_.Read([&](const Catalog& catalog) {
+        catalog.ForEachAuthor(visitor);
+    });
+}
+
+template <typename Shared>
+std::optional<domain::Author> BasicAuthorRepository<Shared>::FindAuthorById(const domain::AuthorId& author_id) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.FindAuthorById");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.FindAuthorById(author_id));
+    });
+}
+
+template <typename Shared>
+std::optional<domain::Author> BasicAuthorRepository<Shared>::FindAuthorByName(const std::string& name) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.FindAuthorByName");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.FindAuthorByName(name));
+    });
+}
+
+template <typename Shared>
+size_t BasicAuthorRepository<Shared>::DumpAuthors(const domain::DumpPart& part, const domain::DumpLineSink& sink) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.DumpAuthors");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.DumpAuthors(part, sink));
+    });
+}
+
+template <typename Shared>
+void BasicBookRepository<Shared>::Save(const domain::Book& book) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.Save");
+    transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        catalog.SaveBook(book, undo);
+    });
+}
+
+template <typename Shared>
+void BasicBookRepository<Shared>::AddBooks(const domain::Books& books) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.AddBooks");
+    transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        catalog.AddBooks(books, undo);
+    });
+}
+
+template <typename Shared>
+domain::Books BasicBookRepository<Shared>::GetAllBooks() {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetAllBooks");
+    return BOOKYPEDIA_COUNT_ROWS(GetBooksPage(std::nullopt, std::numeric_limits<size_t>::max()));
+}
+
+template <typename Shared>
+domain::Books BasicBookRepository<Shared>::GetBooksPage(const std::optional<domain::BooksPageKey>& after,
+                                                       size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksPage");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.GetBooksPage(after, limit));
+    });
+}
+
+template <typename Shared>
+void BasicBookRepository<Shared>::ForEachBook(const domain::BookVisitor& visitor) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.ForEachBook");
+    transaction_.Read([&](const Catalog& catalog) {
+        catalog.ForEachBook(visitor);
+    });
+}
+
+template <typename Shared>
+domain::Books BasicBookRepository<Shared>::GetBooksByAuthorId(const domain::AuthorId& author_id) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksByAuthorId");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.GetBooksByAuthorId(author_id));
+    });
+}
+
+template <typename Shared>
+domain::Books BasicBookRepository<Shared>::GetBooksByTitle(const std::string& title) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksByTitle");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.GetBooksByTitle(title));
+    });
+}
+
+template <typename Shared>
+domain::Books BasicBookRepository<Shared>::SearchBooks(const std::string& query, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.SearchBooks");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.SearchBooks(query, limit));
+    });
+}
+
+template <typename Shared>
+domain::Books BasicBookRepository<Shared>::GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                                         const std::optional<domain::BooksPageKey>& after,
+                                                         size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksByTags");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.GetBooksByTags(tags, match, after, limit));
+    });
+}
+
+template <typename Shared>
+void BasicBookRepository<Shared>::DeleteBook(const domain::BookId& book_id) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.DeleteBook");
+    transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        catalog.DeleteBook(book_id, undo);
+    });
+}
+
+template <typename Shared>
+void BasicBookRepository<Shared>::EditBook(const domain::BookId& book_id, const std::string& title,
+                                           int publication_year, const domain::Tags& tags) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.EditBook");
+    transaction_.Write([&](Catalog& catalog, UndoLog& undo) {
+        catalog.EditBook(book_id, title, publication_year, tags, undo);
+    });
+}
+
+template <typename Shared>
+size_t BasicBookRepository<Shared>::DumpBooks(const domain::DumpPart& part, const domain::DumpLineSink& sink) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.DumpBooks");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.DumpBooks(part, sink));
+    });
+}
+
+template <typename Shared>
+size_t BasicBookRepository<Shared>::DumpBookTags(const domain::DumpPart& part, const domain::DumpLineSink& sink) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.DumpBookTags");
+    return transaction_.Read([&](const Catalog& catalog) {
+        return BOOKYPEDIA_COUNT_ROWS(catalog.DumpBookTags(part, sink));
+    });
+}
+template <typename Shared>
+std::vector<app::ReadOnlyUnitOfWorkPtr> BasicDatabase<Shared>::GetSnapshotUnitsOfWork(size_t count) {
+    using Catalog = typename BasicTransaction<Shared>::Catalog;
+    const auto snapshot = BasicTransaction<Shared>{shared_, false}.Read([](const Catalog& catalog) {
+        return std::make_shared<const Catalog>(catalog);
+    });
+
+    std::vector<app::ReadOnlyUnitOfWorkPtr> units;
+    units.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        units.push_back(std::make_unique<BasicReadOnlyUnitOfWork<Shared>>(snapshot));
+    }
+    transaction_count_ += count;
+    return units;
+}
+
+}  // namespace memory
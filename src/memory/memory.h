@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <shared_mutex>
+#include <thread>
+
+#include "catalog.h"
+#include "catalog_storage.h"
+
+namespace memory {
+
+// Каталог, общий для единиц работы одной базы
+struct SharedCatalog {
+    using UndoLog = ::memory::UndoLog;
+
+    // Изменения в памяти зафиксированы, как только транзакция освобождает каталог
+    void CommitChanges(UndoLog& undo, const std::function<void()>& release) {
+        undo.clear();
+        release();
+    }
+
+    Catalog catalog;
+    std::shared_mutex mutex;
+    // Поток, чья транзакция держит каталог для изменений
+    std::atomic<std::thread::id> writer;
+};
+
+// Хранилище каталога в памяти процесса: не переживает перезапуск, зато не требует сервера.
+// Повторяет порядок выдачи и ограничения репозиториев Postgres, поэтому подходит для тестов,
+// демонстраций и как нижняя граница стоимости хранилища в бенчмарках
+class Database : public BasicDatabase<SharedCatalog> {};
+
+}  // namespace memory
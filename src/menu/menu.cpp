@@ -20,14 +20,17 @@ void Menu::AddAction(std::string action_name, std::string args, std::string desc
     }
 }
 
-void Menu::Run() {
+size_t Menu::Run() {
+    size_t count = 0;
     std::string line;
     while (std::getline(input_, line)) {
+        ++count;
         std::istringstream cmd_stream{std::move(line)};
         if (!ParseCommand(cmd_stream)) {
             break;
         }
     }
+    return count;
 }
 
 void Menu::ShowInstructions() const {
@@ -53,7 +56,7 @@ void Menu::ShowInstructions() const {
         for (const auto& [action_name, info] : actions_) {
             output_ << std::setw(actions_width + 1) << action_name;
             output_ << std::setw(args_width + 1) << info.args;
-            output_ << info.description << std::endl;
+            output_ << info.description << '\n';
         }
     } catch (...) {
         restore_flags();
@@ -73,13 +76,13 @@ bool Menu::ParseCommand(std::istream& input) {
                     return false;
                 }
             } else {
-                output_ << "Command '"sv << cmd << "' has not been found."sv << std::endl;
+                output_ << "Command '"sv << cmd << "' has not been found."sv << '\n';
             }
         } else {
-            output_ << "Invalid command"sv << std::endl;
+            output_ << "Invalid command"sv << '\n';
         }
     } catch (const std::exception& e) {
-        output_ << e.what() << std::endl;
+        output_ << e.what() << '\n';
     }
     return true;
 }
@@ -15,7 +15,8 @@ public:
     void AddAction(std::string action_name, std::string args, std::string description,
                    Handler handler);
 
-    void Run();
+    // Выполняет команды до конца ввода или до команды выхода; возвращает число прочитанных команд
+    size_t Run();
 
     void ShowInstructions() const;
 
@@ -0,0 +1,90 @@
+#include "connection_pool.h"
+
+#include <optional>
+#include <pqxx/except>
+#include <pqxx/nontransaction>
+#include <stdexcept>
+
+namespace postgres {
+
+using namespace std::literals;
+
+ConnectionPool::ConnectionPool(Config config, ConnectionFactory connection_factory)
+    : config_{config}, connection_factory_{std::move(connection_factory)} {
+    if (config_.capacity == 0) {
+        throw std::invalid_argument("Connection pool capacity must be positive"s);
+    }
+    idle_connections_.reserve(config_.capacity);
+}
+
+ConnectionPool::ConnectionWrapper ConnectionPool::GetConnection() {
+    std::unique_lock lock{mutex_};
+    const bool acquired = cond_var_.wait_for(lock, config_.acquire_timeout, [this] {
+        return !idle_connections_.empty() || opened_connections_ < config_.capacity;
+    });
+    if (!acquired) {
+        throw std::runtime_error("Timed out waiting for a database connection"s);
+    }
+
+    std::optional<IdleConnection> idle;
+    if (!idle_connections_.empty()) {
+        idle = std::move(idle_connections_.back());
+        idle_connections_.pop_back();
+    } else {
+        ++opened_connections_;
+    }
+
+    // Соединение проверяется и открывается без блокировки, чтобы не задерживать остальные потоки
+    lock.unlock();
+    if (idle) {
+        if (IsAlive(*idle)) {
+            return {std::move(idle->conn), *this};
+        }
+        // Разорванное соединение закрывается, а его место в пуле занимает новое
+        idle.reset();
+    }
+    try {
+        return {connection_factory_(), *this};
+    } catch (...) {
+        lock.lock();
+        --opened_connections_;
+        lock.unlock();
+        cond_var_.notify_one();
+        throw;
+    }
+}
+
+size_t ConnectionPool::GetBusyConnectionCount() const {
+    std::lock_guard lock{mutex_};
+    return opened_connections_ - idle_connections_.size();
+}
+
+bool ConnectionPool::IsAlive(const IdleConnection& idle) const {
+    if (!idle.conn->is_open()) {
+        return false;
+    }
+    if (std::chrono::steady_clock::now() - idle.idle_since < config_.idle_check_interval) {
+        return true;
+    }
+    try {
+        pqxx::nontransaction{*idle.conn}.exec("SELECT 1");
+        return true;
+    } catch (const pqxx::failure&) {
+        // Соединение, на котором не выполняется даже такой запрос, не выдаётся
+        return false;
+    }
+}
+
+void ConnectionPool::ReturnConnection(ConnectionPtr&& conn) {
+    {
+        std::lock_guard lock{mutex_};
+        if (conn->is_open()) {
+            idle_connections_.push_back({std::move(conn), std::chrono::steady_clock::now()});
+        } else {
+            --opened_connections_;
+        }
+    }
+    cond_var_.notify_one();
+}
+
+}  // namespace postgres
@@ -0,0 +1,99 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <pqxx/connection>
+#include <vector>
+
+namespace postgres {
+
+class ConnectionPool {
+    using PoolType = ConnectionPool;
+    using ConnectionPtr = std::unique_ptr<pqxx::connection>;
+
+public:
+    using ConnectionFactory = std::function<ConnectionPtr()>;
+
+    // Соединение, взятое из пула. При разрушении возвращается обратно в пул
+    class ConnectionWrapper {
+    public:
+        ConnectionWrapper(ConnectionPtr&& conn, PoolType& pool) noexcept : conn_{std::move(conn)}, pool_{&pool} {}
+
+        ConnectionWrapper(const ConnectionWrapper&) = delete;
+        ConnectionWrapper& operator=(const ConnectionWrapper&) = delete;
+
+        ConnectionWrapper(ConnectionWrapper&&) = default;
+        // Соединение, которое держала обёртка, возвращается в пул, прежде чем она примет другое
+        ConnectionWrapper& operator=(ConnectionWrapper&& other) noexcept {
+            if (this != &other) {
+                Release();
+                conn_ = std::move(other.conn_);
+                pool_ = other.pool_;
+            }
+            return *this;
+        }
+
+        pqxx::connection& operator*() const& noexcept {
+            return *conn_;
+        }
+        pqxx::connection& operator*() const&& = delete;
+
+        pqxx::connection* operator->() const& noexcept {
+            return conn_.get();
+        }
+
+        ~ConnectionWrapper() {
+            Release();
+        }
+
+    private:
+        void Release() noexcept {
+            if (conn_) {
+                pool_->ReturnConnection(std::move(conn_));
+            }
+        }
+
+        ConnectionPtr conn_;
+        PoolType* pool_;
+    };
+
+    struct Config {
+        size_t capacity = 1;
+        std::chrono::milliseconds acquire_timeout{5000};
+        // Соединение, простоявшее в пуле дольше, перед выдачей проверяется запросом: libpq замечает разрыв
+        // (перезапуск сервера, отключение по таймауту простоя) только при следующем обращении к серверу
+        std::chrono::milliseconds idle_check_interval{10000};
+    };
+
+    // Соединения создаются фабрикой по мере необходимости, но не больше config.capacity
+    ConnectionPool(Config config, ConnectionFactory connection_factory);
+
+    ConnectionWrapper GetConnection();
+
+    // Число соединений, выданных из пула и ещё не возвращённых
+    size_t GetBusyConnectionCount() const;
+
+    size_t GetCapacity() const noexcept {
+        return config_.capacity;
+    }
+
+private:
+    struct IdleConnection {
+        ConnectionPtr conn;
+        std::chrono::steady_clock::time_point idle_since;
+    };
+
+    void ReturnConnection(ConnectionPtr&& conn);
+    bool IsAlive(const IdleConnection& idle) const;
+
+    Config config_;
+    ConnectionFactory connection_factory_;
+    mutable std::mutex mutex_;
+    std::condition_variable cond_var_;
+    std::vector<IdleConnection> idle_connections_;
+    size_t opened_connections_ = 0;
+};
+
+}  // namespace postgres
@@ -1,167 +1,881 @@
 #include "postgres.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
 #include <pqxx/pqxx>
 #include <pqxx/zview.hxx>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "../util/stats.h"
 
 namespace postgres {
 
 using namespace std::literals;
 using pqxx::operator""_zv;
 
-void AuthorRepositoryImpl::Save(const domain::Author& author) {
-    work_.exec_params(
-        R"(
+namespace {
+
+namespace statements {
+
+constexpr auto SAVE_AUTHOR = "save_author"_zv;
+constexpr auto DELETE_AUTHOR = "delete_author"_zv;
+constexpr auto EDIT_AUTHOR = "edit_author"_zv;
+constexpr auto GET_ALL_AUTHORS = "get_all_authors"_zv;
+constexpr auto GET_FIRST_AUTHORS_PAGE = "get_first_authors_page"_zv;
+constexpr auto GET_AUTHORS_PAGE_AFTER = "get_authors_page_after"_zv;
+constexpr auto FIND_AUTHOR_BY_ID = "find_author_by_id"_zv;
+constexpr auto FIND_AUTHOR_BY_NAME = "find_author_by_name"_zv;
+constexpr auto ADD_MISSING_AUTHORS = "add_missing_authors"_zv;
+constexpr auto FIND_AUTHORS_BY_NAMES = "find_authors_by_names"_zv;
+
+constexpr auto SAVE_BOOK = "save_book"_zv;
+constexpr auto EDIT_BOOK = "edit_book"_zv;
+constexpr auto DELETE_BOOK = "delete_book"_zv;
+constexpr auto SAVE_BOOK_TAGS = "save_book_tags"_zv;
+constexpr auto GET_ALL_BOOKS = "get_all_books"_zv;
+constexpr auto GET_ALL_BOOK_TAGS = "get_all_book_tags"_zv;
+constexpr auto GET_FIRST_BOOKS_PAGE = "get_first_books_page"_zv;
+constexpr auto GET_BOOKS_PAGE_AFTER = "get_books_page_after"_zv;
+constexpr auto GET_BOOK_TAGS_BY_BOOK_IDS = "get_book_tags_by_book_ids"_zv;
+constexpr auto GET_BOOKS_BY_AUTHOR_ID = "get_books_by_author_id"_zv;
+constexpr auto GET_BOOK_TAGS_BY_AUTHOR_ID = "get_book_tags_by_author_id"_zv;
+constexpr auto GET_BOOKS_BY_TITLE = "get_books_by_title"_zv;
+constexpr auto GET_BOOK_TAGS_BY_TITLE = "get_book_tags_by_title"_zv;
+constexpr auto SEARCH_BOOKS = "search_books"_zv;
+constexpr auto GET_FIRST_BOOKS_BY_TAGS_PAGE = "get_first_books_by_tags_page"_zv;
+constexpr auto GET_BOOKS_BY_TAGS_PAGE_AFTER = "get_books_by_tags_page_after"_zv;
+
+struct Statement {
+    pqxx::zview name;
+    pqxx::zview definition;
+};
+
+// Все запросы репозиториев; готовятся один раз на каждое соединение
+constexpr Statement CATALOG[]{
+    {SAVE_AUTHOR, R"(
 INSERT INTO authors (id, name) VALUES ($1, $2)
 ON CONFLICT (id) DO UPDATE SET name=$2;
-)"_zv,
-        author.GetId().ToString(), author.GetName());
+)"_zv},
+    // Книги автора и их теги удаляются каскадно внешними ключами books и book_tags
+    {DELETE_AUTHOR, "DELETE FROM authors WHERE id = $1;"_zv},
+    {EDIT_AUTHOR, "UPDATE authors SET name = $1 WHERE id = $2;"_zv},
+    {GET_ALL_AUTHORS, "SELECT id, name FROM authors ORDER BY name;"_zv},
+    {GET_FIRST_AUTHORS_PAGE, "SELECT id, name FROM authors ORDER BY name, id LIMIT $1;"_zv},
+    {GET_AUTHORS_PAGE_AFTER, R"(
+SELECT id, name FROM authors
+WHERE (name, id) > ($1::varchar, $2::uuid)
+ORDER BY name, id
+LIMIT $3;
+)"_zv},
+    {FIND_AUTHOR_BY_ID, "SELECT id, name FROM authors WHERE id = $1;"_zv},
+    {FIND_AUTHOR_BY_NAME, "SELECT id, name FROM authors WHERE name = $1;"_zv},
+    // Существовавшие до запроса авторы берутся из таблицы, новые — из RETURNING. Автора, которого
+    // параллельная транзакция добавила после начала запроса, не вернёт ни одна из частей: конфликтующая
+    // строка не попадает в RETURNING и не видна в снимке запроса. Таких авторов дочитывает FIND_AUTHORS_BY_NAMES
+    {ADD_MISSING_AUTHORS, R"(
+WITH candidates AS (
+    SELECT * FROM unnest($1::uuid[], $2::varchar[]) AS c(id, name)
+), inserted AS (
+    INSERT INTO authors (id, name)
+    SELECT id, name FROM candidates
+    ON CONFLICT (name) DO NOTHING
+    RETURNING id, name
+)
+SELECT id, name FROM inserted
+UNION ALL
+SELECT a.id, a.name FROM authors a JOIN candidates c ON a.name = c.name;
+)"_zv},
+    {FIND_AUTHORS_BY_NAMES, "SELECT id, name FROM authors WHERE name = ANY($1::varchar[]);"_zv},
+
+    {SAVE_BOOK, R"(
+INSERT INTO books (id, author_id, title, publication_year) VALUES ($1, $2, $3, $4)
+ON CONFLICT (id) DO UPDATE SET author_id=$2, title=$3, publication_year=$4;
+)"_zv},
+    {EDIT_BOOK, "UPDATE books SET title = $2, publication_year = $3 WHERE id = $1;"_zv},
+    {DELETE_BOOK, "DELETE FROM books WHERE id = $1;"_zv},
+    // Удаляет теги, которых нет в $2, и добавляет недостающие: неизменные теги не трогаются
+    {SAVE_BOOK_TAGS, R"(
+WITH removed AS (
+    DELETE FROM book_tags WHERE book_id = $1 AND tag <> ALL($2::varchar[])
+)
+INSERT INTO book_tags (book_id, tag)
+SELECT DISTINCT $1::uuid, new_tag FROM unnest($2::varchar[]) AS new_tag
+WHERE NOT EXISTS (SELECT 1 FROM book_tags bt WHERE bt.book_id = $1 AND bt.tag = new_tag);
+)"_zv},
+    {GET_ALL_BOOKS, R"(
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name
+FROM books b
+JOIN authors a ON b.author_id = a.id
+ORDER BY b.title, b.id;
+)"_zv},
+    {GET_ALL_BOOK_TAGS, "SELECT book_id, tag FROM book_tags ORDER BY tag;"_zv},
+    {GET_FIRST_BOOKS_PAGE, R"(
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name
+FROM books b
+JOIN authors a ON b.author_id = a.id
+ORDER BY b.title, b.id
+LIMIT $1;
+)"_zv},
+    {GET_BOOKS_PAGE_AFTER, R"(
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name
+FROM books b
+JOIN authors a ON b.author_id = a.id
+WHERE (b.title, b.id) > ($1::varchar, $2::uuid)
+ORDER BY b.title, b.id
+LIMIT $3;
+)"_zv},
+    {GET_BOOK_TAGS_BY_BOOK_IDS, "SELECT book_id, tag FROM book_tags WHERE book_id = ANY($1::uuid[]) ORDER BY tag;"_zv},
+    {GET_BOOKS_BY_AUTHOR_ID, R"(
+SELECT id, author_id, title, publication_year
+FROM books
+WHERE author_id = $1
+ORDER BY publication_year, title;
+)"_zv},
+    {GET_BOOK_TAGS_BY_AUTHOR_ID, R"(
+SELECT bt.book_id, bt.tag
+FROM book_tags bt
+JOIN books b ON b.id = bt.book_id
+WHERE b.author_id = $1
+ORDER BY bt.tag;
+)"_zv},
+    {GET_BOOKS_BY_TITLE, R"(
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name
+FROM books b
+JOIN authors a ON b.author_id = a.id
+WHERE b.title = $1
+ORDER BY b.publication_year;
+)"_zv},
+    {GET_BOOK_TAGS_BY_TITLE, R"(
+SELECT bt.book_id, bt.tag
+FROM book_tags bt
+JOIN books b ON b.id = bt.book_id
+WHERE b.title = $1
+ORDER BY bt.tag;
+)"_zv},
+    // Каждое слово запроса — префикс лексемы: "whi fan" находит "White Fang". Слова сравниваются
+    // по индексам books_title_fts_idx и authors_name_fts_idx, поэтому названия и авторы ищутся раздельно.
+    // Совпадение по автору весит вдвое меньше совпадения по названию
+    {SEARCH_BOOKS, R"(
+WITH search AS (
+    SELECT to_tsquery('simple', string_agg(word || ':*', ' & ')) AS query
+    FROM regexp_split_to_table(lower($1), '\W+') AS word
+    WHERE word <> ''
+), matches AS (
+    SELECT b.id, ts_rank(to_tsvector('simple', b.title), s.query) AS rank
+    FROM books b, search s
+    WHERE to_tsvector('simple', b.title) @@ s.query
+    UNION ALL
+    SELECT b.id, ts_rank(to_tsvector('simple', a.name), s.query) / 2
+    FROM authors a
+    JOIN books b ON b.author_id = a.id, search s
+    WHERE to_tsvector('simple', a.name) @@ s.query
+), ranked AS (
+    SELECT id, max(rank) AS rank FROM matches GROUP BY id
+)
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name
+FROM ranked r
+JOIN books b ON b.id = r.id
+JOIN authors a ON a.id = b.author_id
+ORDER BY b.title = $1 DESC, r.rank DESC, b.title, b.id
+LIMIT $2;
+)"_zv},
+    // Книги, у которых не меньше $2 тегов из $1: число тегов набора — все сразу, 1 — хотя бы один.
+    // Пары (book_id, tag) уникальны, а book_tags_tag_book_id_idx отдаёт их без чтения таблицы
+    {GET_FIRST_BOOKS_BY_TAGS_PAGE, R"(
+WITH matched AS (
+    SELECT book_id FROM book_tags
+    WHERE tag = ANY($1::varchar[])
+    GROUP BY book_id
+    HAVING count(*) >= $2
+)
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name
+FROM matched m
+JOIN books b ON b.id = m.book_id
+JOIN authors a ON a.id = b.author_id
+ORDER BY b.title, b.id
+LIMIT $3;
+)"_zv},
+    {GET_BOOKS_BY_TAGS_PAGE_AFTER, R"(
+WITH matched AS (
+    SELECT book_id FROM book_tags
+    WHERE tag = ANY($1::varchar[])
+    GROUP BY book_id
+    HAVING count(*) >= $2
+)
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name
+FROM matched m
+JOIN books b ON b.id = m.book_id
+JOIN authors a ON a.id = b.author_id
+WHERE (b.title, b.id) > ($3::varchar, $4::uuid)
+ORDER BY b.title, b.id
+LIMIT $5;
+)"_zv},
+};
+
+// Запросы для потоковой выдачи через COPY ... TO STDOUT: строки читаются по мере поступления,
+// а не накапливаются в pqxx::result. COPY не работает с подготовленными запросами, поэтому здесь только текст
+constexpr auto STREAM_ALL_AUTHORS = "SELECT id, name FROM authors ORDER BY name, id"_zv;
+// Книга занимает столько подряд идущих строк, сколько у неё тегов, и одну строку с NULL, если тегов нет
+constexpr auto STREAM_ALL_BOOKS = R"(
+SELECT b.id, b.author_id, b.title, b.publication_year, a.name, bt.tag
+FROM books b
+JOIN authors a ON b.author_id = a.id
+LEFT JOIN book_tags bt ON bt.book_id = b.id
+ORDER BY b.title, b.id, bt.tag
+)"_zv;
+
+// Запросы выгрузки: порядок строк не важен, поэтому сервер читает таблицы без сортировки
+constexpr auto DUMP_AUTHORS = "SELECT id, name FROM authors"_zv;
+constexpr auto DUMP_BOOKS = "SELECT id, author_id, title, publication_year FROM books"_zv;
+constexpr auto DUMP_BOOK_TAGS = "SELECT book_id, tag FROM book_tags"_zv;
+
+}  // namespace statements
+
+// Параметр запроса с UUID. Двоичный параметр подходит только туда, где сервер выводит для него тип uuid
+template <typename Tag>
+pqxx::params UuidParam(const util::TaggedUUID<Tag>& id, UuidFormat format) {
+    pqxx::params param;
+    if (format == UuidFormat::Binary) {
+        const auto& uuid = *id;
+        param.append(std::basic_string<std::byte>{reinterpret_cast<const std::byte*>(uuid.data), uuid.size()});
+    } else {
+        param.append(id.ToString());
+    }
+    return param;
+}
+
+// Параметры изменяющих запросов: UUID передаётся в формате репозитория, а в тексте команды EXECUTE — строкой
+template <typename T>
+const T& QueryArg(const T& value, UuidFormat) {
+    return value;
+}
+
+template <typename Tag>
+pqxx::params QueryArg(const util::TaggedUUID<Tag>& id, UuidFormat format) {
+    return UuidParam(id, format);
+}
+
+template <typename T>
+const T& TextArg(const T& value) {
+    return value;
+}
+
+template <typename Tag>
+std::string TextArg(const util::TaggedUUID<Tag>& id) {
+    return id.ToString();
+}
+
+template <typename... Args>
+void ExecuteWrite(pqxx::transaction_base& work, StatementPipeline* pipeline, UuidFormat uuid_format,
+                  pqxx::zview statement, const Args&... args) {
+    if (pipeline) {
+        pipeline->Execute(statement, TextArg(args)...);
+    } else {
+        work.exec_prepared(statement, QueryArg(args, uuid_format)...);
+    }
+}
+
+using TagsByBookId = std::unordered_map<domain::BookId, domain::Tags, util::TaggedHasher<domain::BookId>>;
+
+TagsByBookId GroupTagsByBookId(const pqxx::result& rows) {
+    TagsByBookId tags;
+    for (const auto& row : rows) {
+        tags[domain::BookId::FromString(row[0].view())].push_back(row[1].as<std::string>());
+    }
+    return tags;
+}
+
+domain::Tags ExtractBookTags(TagsByBookId& tags, const domain::BookId& book_id) {
+    auto it = tags.find(book_id);
+    if (it == tags.end()) {
+        return {};
+    }
+    return std::move(it->second);
+}
+
+std::optional<domain::Author> ToAuthor(const pqxx::result& rows) {
+    if (rows.empty()) {
+        return std::nullopt;
+    }
+
+    const auto& row = rows[0];
+    return domain::Author{domain::AuthorId::FromString(row[0].view()), row[1].as<std::string>()};
+}
+
+// UUID как беззнаковое 128-битное число: Postgres сравнивает UUID побайтно, как такие числа
+using UuidValue = unsigned __int128;
+
+UuidValue ToUuidValue(const util::detail::UUIDType& uuid) {
+    UuidValue value = 0;
+    for (const auto byte : uuid) {
+        value = value << 8 | byte;
+    }
+    return value;
+}
+
+std::string UuidValueToString(UuidValue value) {
+    util::detail::UUIDType uuid;
+    for (auto it = uuid.end(); it != uuid.begin(); value >>= 8) {
+        *--it = static_cast<uint8_t>(value);
+    }
+    return util::detail::UUIDToString(uuid);
+}
+
+// Запрос выгрузки части таблицы. Промежуток от наименьшего до наибольшего id таблицы bounds_table в снимке
+// делится на count равных диапазонов: оба конца находятся по индексу первичного ключа, и каждая часть
+// читает только строки, у которых id_column попадает в её диапазон. Части видят один снимок, поэтому
+// границы у них совпадают; теги делятся по границам books, чтобы попасть в часть своей книги.
+// UUID v4 распределены равномерно, а v7 растут со временем, поэтому части близки по размеру, если строки
+// добавлялись с постоянной скоростью
+std::string DumpPartQuery(pqxx::transaction_base& work, std::string_view query, std::string_view bounds_table,
+                          std::string_view id_column, const domain::DumpPart& part) {
+    std::string result{query};
+    if (part.count <= 1) {
+        return result;
+    }
+
+    const std::string column{id_column};
+    const auto bounds = work.exec("SELECT min(id)::text, max(id)::text FROM " + std::string{bounds_table})[0];
+    // В пустой таблице выгружать нечего ни одной из частей: без книг нет и их тегов
+    if (bounds[0].is_null()) {
+        return result;
+    }
+
+    const auto low = ToUuidValue(util::detail::UUIDFromString(bounds[0].view()));
+    const auto span = ToUuidValue(util::detail::UUIDFromString(bounds[1].view())) - low;
+    const auto boundary = [low, span, count = part.count](size_t index) {
+        return low + span / count * index + span % count * index / count;
+    };
+    const auto condition = [&](std::string_view op, size_t index) {
+        return std::string{column}
+            .append(op)
+            .append(work.quote(UuidValueToString(boundary(index))))
+            .append("::uuid"sv);
+    };
+
+    // Крайние части не ограничены снаружи, поэтому вместе части покрывают всю таблицу
+    if (part.index > 0) {
+        result.append(" WHERE "sv).append(condition(" >= "sv, part.index));
+    }
+    if (part.index + 1 < part.count) {
+        result.append(part.index > 0 ? " AND "sv : " WHERE "sv).append(condition(" < "sv, part.index + 1));
+    }
+    return result;
+}
+
+// Передаёт sink строки COPY ... TO STDOUT без разбора на поля
+size_t Dump(pqxx::transaction_base& work, const std::string& query, const domain::DumpLineSink& sink) {
+    auto stream = pqxx::stream_from::query(work, query);
+    size_t count = 0;
+    for (auto line = stream.get_raw_line(); line.first; line = stream.get_raw_line()) {
+        std::string_view text{line.first.get(), line.second};
+        if (!text.empty() && text.back() == '\n') {
+            text.remove_suffix(1);
+        }
+        sink(text);
+        ++count;
+    }
+    stream.complete();
+    return count;
+}
+
+ConnectionPool::ConnectionFactory MakeConnectionFactory(std::string url) {
+    return [url = std::move(url)] {
+        auto connection = std::make_unique<pqxx::connection>(url);
+        PrepareStatements(*connection);
+        return connection;
+    };
+}
+
+std::unique_ptr<pqxx::transaction_base> BeginReadOnlyTransaction(pqxx::connection& connection, bool deferrable) {
+    if (!deferrable) {
+        return std::make_unique<pqxx::read_transaction>(connection);
+    }
+
+    using SerializableReadTransaction =
+        pqxx::transaction<pqxx::isolation_level::serializable, pqxx::write_policy::read_only>;
+    auto transaction = std::make_unique<SerializableReadTransaction>(connection);
+    transaction->exec("SET TRANSACTION DEFERRABLE;"_zv);
+    return transaction;
+}
+
+using SnapshotTransaction = pqxx::transaction<pqxx::isolation_level::repeatable_read, pqxx::write_policy::read_only>;
+
+// Переводит текущее исключение запроса, отправленного конвейером, в то, что бросил бы запрос без него:
+// уникальность изменения репозиториев могут нарушить только именем автора. Если известна операция пакета,
+// исключение вкладывается в app::BatchOperationError с её номером
+[[noreturn]] void RethrowPipelinedError(const std::optional<size_t>& operation) {
+    try {
+        try {
+            throw;
+        } catch (const pqxx::unique_violation&) {
+            throw domain::AuthorExistsError{};
+        }
+    } catch (const std::exception& error) {
+        if (!operation) {
+            throw;
+        }
+        std::throw_with_nested(app::BatchOperationError{*operation, error.what()});
+    }
+}
+
+}  // namespace
+
+void PrepareStatements(pqxx::connection& connection) {
+    for (const auto& [name, definition] : statements::CATALOG) {
+        connection.prepare(name, definition);
+    }
+}
+
+void StatementPipeline::Flush() {
+    if (!pipeline_) {
+        return;
+    }
+    // Конвейер отсоединяется от транзакции в любом случае: после ошибки она всё равно прервана
+    const auto pipeline = std::move(pipeline_);
+    const auto statement_operations = std::exchange(statement_operations_, {});
+    // Результаты забираются по порядку отправки, поэтому первый неудачный — retrieved-й запрос
+    size_t retrieved = 0;
+    try {
+        pipeline->complete();
+        for (; !pipeline->empty(); ++retrieved) {
+            pipeline->retrieve();
+        }
+    } catch (const pqxx::sql_error&) {
+        RethrowPipelinedError(retrieved < statement_operations.size() ? statement_operations[retrieved]
+                                                                      : std::nullopt);
+    }
+}
+
+pqxx::transaction_base& AuthorRepositoryImpl::Work() {
+    if (pipeline_) {
+        pipeline_->Flush();
+    }
+    return work_;
+}
+
+template <typename... Args>
+void AuthorRepositoryImpl::Write(pqxx::zview statement, const Args&... args) {
+    ExecuteWrite(work_, pipeline_, uuid_format_, statement, args...);
+}
+
+pqxx::transaction_base& BookRepositoryImpl::Work() {
+    if (pipeline_) {
+        pipeline_->Flush();
+    }
+    return work_;
+}
+
+template <typename... Args>
+void BookRepositoryImpl::Write(pqxx::zview statement, const Args&... args) {
+    ExecuteWrite(work_, pipeline_, uuid_format_, statement, args...);
+}
+
+// В пакетной единице работы нарушение уникальности проявится при отправке пачки, и AuthorExistsError
+// бросит StatementPipeline::Flush
+void AuthorRepositoryImpl::Save(const domain::Author& author) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.Save");
+    try {
+        Write(statements::SAVE_AUTHOR, author.GetId(), author.GetName());
+    } catch (const pqxx::unique_violation&) {
+        throw domain::AuthorExistsError{};
+    }
+}
+
+domain::Authors AuthorRepositoryImpl::AddMissingAuthors(const domain::Authors& authors) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.AddMissingAuthors");
+    std::vector<std::string> ids;
+    std::vector<std::string> names;
+    ids.reserve(authors.size());
+    names.reserve(authors.size());
+    for (const auto& author : authors) {
+        ids.push_back(author.GetId().ToString());
+        names.push_back(author.GetName());
+    }
+
+    domain::Authors result;
+    result.reserve(authors.size());
+    auto read_authors = [&result](const pqxx::result& rows) {
+        for (const auto& [id, name] : rows.iter<std::string_view, std::string>()) {
+            result.emplace_back(domain::AuthorId::FromString(id), name);
+        }
+    };
+    read_authors(Work().exec_prepared(statements::ADD_MISSING_AUTHORS, ids, names));
+
+    // Имена, которые параллельные транзакции добавили во время вставки, читаются следующим запросом:
+    // в READ COMMITTED его снимок уже содержит их строки
+    if (result.size() < authors.size()) {
+        std::unordered_set<std::string_view> resolved;
+        for (const auto& author : result) {
+            resolved.insert(author.GetName());
+        }
+        std::erase_if(names, [&resolved](const std::string& name) {
+            return resolved.contains(name);
+        });
+        read_authors(Work().exec_prepared(statements::FIND_AUTHORS_BY_NAMES, names));
+    }
+    BOOKYPEDIA_RECORD_ROWS(result);
+    return result;
 }
 
 void AuthorRepositoryImpl::Delete(const domain::AuthorId& author_id) {
-    work_.exec_params("DELETE FROM authors WHERE id = $1", author_id.ToString());
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.Delete");
+    Write(statements::DELETE_AUTHOR, author_id);
 }
 
 void AuthorRepositoryImpl::Edit(const domain::AuthorId& author_id, const std::string& new_name) {
-    work_.exec_params("UPDATE authors SET name = $1 WHERE id = $2", new_name, author_id.ToString());
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.Edit");
+    try {
+        Write(statements::EDIT_AUTHOR, new_name, author_id);
+    } catch (const pqxx::unique_violation&) {
+        throw domain::AuthorExistsError{};
+    }
 }
 
 domain::Authors AuthorRepositoryImpl::GetAllAuthors() {
-    const pqxx::zview query_text = "SELECT id, name FROM authors ORDER BY name;"_zv;
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.GetAllAuthors");
+    const auto rows = Work().exec_prepared(statements::GET_ALL_AUTHORS);
 
     domain::Authors authors;
-    for (const auto& [id, name] : work_.query<std::string, std::string>(query_text)) {
+    authors.reserve(rows.size());
+    for (const auto& [id, name] : rows.iter<std::string_view, std::string>()) {
         authors.emplace_back(domain::AuthorId::FromString(id), name);
     }
+    BOOKYPEDIA_RECORD_ROWS(authors);
     return authors;
 }
 
-std::optional<domain::Author> AuthorRepositoryImpl::FindAuthorById(const domain::AuthorId& author_id) {
-    const std::string query_text = "SELECT id, name FROM authors WHERE id = " + work_.quote(author_id.ToString()) + ";";
+domain::Authors AuthorRepositoryImpl::GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after,
+                                                     size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.GetAuthorsPage");
+    const auto rows = after ? Work().exec_prepared(statements::GET_AUTHORS_PAGE_AFTER, after->name,
+                                                  UuidParam(after->id, uuid_format_), limit)
+                            : Work().exec_prepared(statements::GET_FIRST_AUTHORS_PAGE, limit);
 
-    auto query_result = work_.query01<std::string, std::string>(query_text);
+    domain::Authors authors;
+    authors.reserve(rows.size());
+    for (const auto& [id, name] : rows.iter<std::string_view, std::string>()) {
+        authors.emplace_back(domain::AuthorId::FromString(id), name);
+    }
+    BOOKYPEDIA_RECORD_ROWS(authors);
+    return authors;
+}
 
-    if (!query_result) {
-        return std::nullopt;
+void AuthorRepositoryImpl::ForEachAuthor(const domain::AuthorVisitor& visitor) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.ForEachAuthor");
+    for (const auto& [id, name] : Work().stream<std::string, std::string>(statements::STREAM_ALL_AUTHORS)) {
+        visitor(domain::Author{domain::AuthorId::FromString(id), name});
     }
+}
 
-    const auto& [id, name] = *query_result;
-    return domain::Author{domain::AuthorId::FromString(id), name};
+std::optional<domain::Author> AuthorRepositoryImpl::FindAuthorById(const domain::AuthorId& author_id) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.FindAuthorById");
+    return BOOKYPEDIA_COUNT_ROWS(
+        ToAuthor(Work().exec_prepared(statements::FIND_AUTHOR_BY_ID, UuidParam(author_id, uuid_format_))));
 }
 
 std::optional<domain::Author> AuthorRepositoryImpl::FindAuthorByName(const std::string& input_name) {
-    const std::string query_text = "SELECT id, name FROM authors WHERE name = " + work_.quote(input_name) + ";";
-
-    auto query_result = work_.query01<std::string, std::string>(query_text);
-
-    if (!query_result) {
-        return std::nullopt;
-    }
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.FindAuthorByName");
+    return BOOKYPEDIA_COUNT_ROWS(ToAuthor(Work().exec_prepared(statements::FIND_AUTHOR_BY_NAME, input_name)));
+}
 
-    const auto& [id, name] = *query_result;
-    return domain::Author{domain::AuthorId::FromString(id), name};
+size_t AuthorRepositoryImpl::DumpAuthors(const domain::DumpPart& part, const domain::DumpLineSink& sink) {
+    BOOKYPEDIA_TIME_OPERATION("AuthorRepository.DumpAuthors");
+    auto& work = Work();
+    const auto query = DumpPartQuery(work, statements::DUMP_AUTHORS, "authors"sv, "id"sv, part);
+    return BOOKYPEDIA_COUNT_ROWS(Dump(work, query, sink));
 }
 
 void BookRepositoryImpl::Save(const domain::Book& book) {
-    work_.exec_params(
-        R"(
-INSERT INTO books (id, author_id, title, publication_year) VALUES ($1, $2, $3, $4)
-ON CONFLICT (id) DO UPDATE SET author_id=$2, title=$3, publication_year=$4;
-)"_zv,
-        book.GetBookId().ToString(), book.GetAuthorId().ToString(), book.GetTitle(), book.GetPublicationYear());
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.Save");
+    Write(statements::SAVE_BOOK, book.GetBookId(), book.GetAuthorId(), book.GetTitle(), book.GetPublicationYear());
+    Write(statements::SAVE_BOOK_TAGS, book.GetBookId(), book.GetTags());
+}
 
-    work_.exec_params("DELETE FROM book_tags WHERE book_id = $1;", book.GetBookId().ToString());
-    for (const auto& tag : book.GetTags()) {
-        work_.exec_params("INSERT INTO book_tags (book_id, tag) VALUES ($1, $2);", book.GetBookId().ToString(), tag);
+// Книги и теги загружаются через COPY FROM STDIN: две команды на любой объём вместо запроса на каждую книгу
+void BookRepositoryImpl::AddBooks(const domain::Books& books) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.AddBooks");
+    {
+        auto stream =
+            pqxx::stream_to::table(Work(), {"books"sv}, {"id"sv, "author_id"sv, "title"sv, "publication_year"sv});
+        for (const auto& book : books) {
+            stream.write_values(book.GetBookId().ToString(), book.GetAuthorId().ToString(), book.GetTitle(),
+                                book.GetPublicationYear());
+        }
+        stream.complete();
     }
+
+    auto stream = pqxx::stream_to::table(Work(), {"book_tags"sv}, {"book_id"sv, "tag"sv});
+    for (const auto& book : books) {
+        const auto book_id = book.GetBookId().ToString();
+        for (const auto& tag : book.GetTags()) {
+            stream.write_values(book_id, tag);
+        }
+    }
+    stream.complete();
 }
 
 domain::Books BookRepositoryImpl::GetAllBooks() {
-    pqxx::zview query_text = R"(
-    SELECT b.id, b.author_id, b.title, b.publication_year, a.name
-    FROM books b
-    JOIN authors a ON b.author_id = a.id
-    ORDER BY b.title;
-)"_zv;
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetAllBooks");
+    const auto rows = Work().exec_prepared(statements::GET_ALL_BOOKS);
+    auto tags = GroupTagsByBookId(Work().exec_prepared(statements::GET_ALL_BOOK_TAGS));
 
     domain::Books books;
+    books.reserve(rows.size());
     for (const auto& [book_id, author_id, title, publication_year, author_name] :
-         work_.query<std::string, std::string, std::string, int, std::string>(query_text)) {
-        books.emplace_back(domain::BookId::FromString(book_id), domain::AuthorId::FromString(author_id), title,
-                           publication_year, GetBookTags(book_id), author_name);
+         rows.iter<std::string_view, std::string_view, std::string, int, std::string>()) {
+        auto id = domain::BookId::FromString(book_id);
+        auto book_tags = ExtractBookTags(tags, id);
+        books.emplace_back(std::move(id), domain::AuthorId::FromString(author_id), title, publication_year,
+                           std::move(book_tags), author_name);
     }
+    BOOKYPEDIA_RECORD_ROWS(books);
     return books;
 }
 
-domain::Tags BookRepositoryImpl::GetBookTags(const std::string& book_id) const {
-    const std::string query_text = "SELECT tag FROM book_tags WHERE book_id = " + work_.quote(book_id) + ";";
+domain::Books BookRepositoryImpl::GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksPage");
+    const auto rows = after ? Work().exec_prepared(statements::GET_BOOKS_PAGE_AFTER, after->title,
+                                                  UuidParam(after->id, uuid_format_), limit)
+                            : Work().exec_prepared(statements::GET_FIRST_BOOKS_PAGE, limit);
 
-    domain::Tags result;
-    for (const auto& [tag] : work_.query<std::string>(query_text)) {
-        result.push_back(tag);
+    std::vector<std::string> book_ids;
+    book_ids.reserve(rows.size());
+    for (const auto& row : rows) {
+        book_ids.push_back(row[0].as<std::string>());
     }
+    auto tags = GroupTagsByBookId(Work().exec_prepared(statements::GET_BOOK_TAGS_BY_BOOK_IDS, book_ids));
 
-    return result;
+    domain::Books books;
+    books.reserve(rows.size());
+    for (const auto& [book_id, author_id, title, publication_year, author_name] :
+         rows.iter<std::string_view, std::string_view, std::string, int, std::string>()) {
+        auto id = domain::BookId::FromString(book_id);
+        auto book_tags = ExtractBookTags(tags, id);
+        books.emplace_back(std::move(id), domain::AuthorId::FromString(author_id), title, publication_year,
+                           std::move(book_tags), author_name);
+    }
+    BOOKYPEDIA_RECORD_ROWS(books);
+    return books;
+}
+
+void BookRepositoryImpl::ForEachBook(const domain::BookVisitor& visitor) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.ForEachBook");
+    // В памяти только текущая книга: она передаётся visitor, когда начинаются строки следующей
+    std::optional<domain::Book> current;
+    domain::Tags tags;
+    auto flush = [&] {
+        if (current) {
+            visitor(domain::Book{current->GetBookId(), current->GetAuthorId(), current->GetTitle(),
+                                 current->GetPublicationYear(), std::move(tags), current->GetAuthorName()});
+            tags.clear();
+        }
+    };
+
+    for (auto [book_id, author_id, title, publication_year, author_name, tag] :
+         Work().stream<std::string, std::string, std::string, int, std::string, std::optional<std::string>>(
+             statements::STREAM_ALL_BOOKS)) {
+        auto id = domain::BookId::FromString(book_id);
+        if (!current || current->GetBookId() != id) {
+            flush();
+            current.emplace(std::move(id), domain::AuthorId::FromString(author_id), std::move(title),
+                            publication_year, domain::Tags{}, std::move(author_name));
+        }
+        if (tag) {
+            tags.push_back(std::move(*tag));
+        }
+    }
+    flush();
 }
 
 domain::Books BookRepositoryImpl::GetBooksByAuthorId(const domain::AuthorId& author_id) {
-    const std::string query_text =
-        R"(
-        SELECT id, author_id, title, publication_year
-        FROM books
-        WHERE author_id = )" +
-        work_.quote(author_id.ToString()) + R"(
-        ORDER BY publication_year, title;
-    )";
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksByAuthorId");
+    const auto rows = Work().exec_prepared(statements::GET_BOOKS_BY_AUTHOR_ID, UuidParam(author_id, uuid_format_));
+    auto tags = GroupTagsByBookId(
+        Work().exec_prepared(statements::GET_BOOK_TAGS_BY_AUTHOR_ID, UuidParam(author_id, uuid_format_)));
 
     domain::Books books;
+    books.reserve(rows.size());
     for (const auto& [book_id, author_id, title, publication_year] :
-         work_.query<std::string, std::string, std::string, int>(query_text)) {
-        books.emplace_back(domain::BookId::FromString(book_id), domain::AuthorId::FromString(author_id), title,
-                           publication_year, GetBookTags(book_id));
+         rows.iter<std::string_view, std::string_view, std::string, int>()) {
+        auto id = domain::BookId::FromString(book_id);
+        auto book_tags = ExtractBookTags(tags, id);
+        books.emplace_back(std::move(id), domain::AuthorId::FromString(author_id), title,
+                           publication_year, std::move(book_tags));
     }
+    BOOKYPEDIA_RECORD_ROWS(books);
     return books;
 }
 
 domain::Books BookRepositoryImpl::GetBooksByTitle(const std::string& title) {
-    const std::string query_text =
-        R"(
-        SELECT b.id, b.author_id, b.title, b.publication_year, a.name
-        FROM books b
-        JOIN authors a ON b.author_id = a.id
-        WHERE title = )" +
-        work_.quote(title) + R"(
-        ORDER BY b.publication_year;
-    )";
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksByTitle");
+    const auto rows = Work().exec_prepared(statements::GET_BOOKS_BY_TITLE, title);
+    auto tags = GroupTagsByBookId(Work().exec_prepared(statements::GET_BOOK_TAGS_BY_TITLE, title));
+
+    domain::Books books;
+    books.reserve(rows.size());
+    for (const auto& [book_id, author_id, title, publication_year, author_name] :
+         rows.iter<std::string_view, std::string_view, std::string, int, std::string>()) {
+        auto id = domain::BookId::FromString(book_id);
+        auto book_tags = ExtractBookTags(tags, id);
+        books.emplace_back(std::move(id), domain::AuthorId::FromString(author_id), title, publication_year,
+                           std::move(book_tags), author_name);
+    }
+    BOOKYPEDIA_RECORD_ROWS(books);
+    return books;
+}
+
+domain::Books BookRepositoryImpl::SearchBooks(const std::string& query, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.SearchBooks");
+    const auto rows = Work().exec_prepared(statements::SEARCH_BOOKS, query, limit);
+
+    std::vector<std::string> book_ids;
+    book_ids.reserve(rows.size());
+    for (const auto& row : rows) {
+        book_ids.push_back(row[0].as<std::string>());
+    }
+    auto tags = GroupTagsByBookId(Work().exec_prepared(statements::GET_BOOK_TAGS_BY_BOOK_IDS, book_ids));
 
     domain::Books books;
+    books.reserve(rows.size());
     for (const auto& [book_id, author_id, title, publication_year, author_name] :
-         work_.query<std::string, std::string, std::string, int, std::string>(query_text)) {
-        books.emplace_back(domain::BookId::FromString(book_id), domain::AuthorId::FromString(author_id), title,
-                           publication_year, GetBookTags(book_id), author_name);
+         rows.iter<std::string_view, std::string_view, std::string, int, std::string>()) {
+        auto id = domain::BookId::FromString(book_id);
+        auto book_tags = ExtractBookTags(tags, id);
+        books.emplace_back(std::move(id), domain::AuthorId::FromString(author_id), title, publication_year,
+                           std::move(book_tags), author_name);
     }
+    BOOKYPEDIA_RECORD_ROWS(books);
     return books;
 }
 
-void BookRepositoryImpl::DeleteBookTags(const domain::BookId& book_id) {
-    work_.exec_params("DELETE FROM book_tags WHERE book_id = $1", book_id.ToString());
+domain::Books BookRepositoryImpl::GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                                const std::optional<domain::BooksPageKey>& after, size_t limit) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.GetBooksByTags");
+    std::vector<std::string> unique_tags{tags.begin(), tags.end()};
+    std::sort(unique_tags.begin(), unique_tags.end());
+    unique_tags.erase(std::unique(unique_tags.begin(), unique_tags.end()), unique_tags.end());
+    if (unique_tags.empty()) {
+        return {};
+    }
+
+    const size_t required = match == domain::TagMatch::All ? unique_tags.size() : 1;
+    const auto rows = after ? Work().exec_prepared(statements::GET_BOOKS_BY_TAGS_PAGE_AFTER, unique_tags, required,
+                                                  after->title, UuidParam(after->id, uuid_format_), limit)
+                            : Work().exec_prepared(statements::GET_FIRST_BOOKS_BY_TAGS_PAGE, unique_tags, required,
+                                                  limit);
+
+    std::vector<std::string> book_ids;
+    book_ids.reserve(rows.size());
+    for (const auto& row : rows) {
+        book_ids.push_back(row[0].as<std::string>());
+    }
+    auto book_tags = GroupTagsByBookId(Work().exec_prepared(statements::GET_BOOK_TAGS_BY_BOOK_IDS, book_ids));
+
+    domain::Books books;
+    books.reserve(rows.size());
+    for (const auto& [book_id, author_id, title, publication_year, author_name] :
+         rows.iter<std::string_view, std::string_view, std::string, int, std::string>()) {
+        auto id = domain::BookId::FromString(book_id);
+        auto tags_of_book = ExtractBookTags(book_tags, id);
+        books.emplace_back(std::move(id), domain::AuthorId::FromString(author_id), title, publication_year,
+                           std::move(tags_of_book), author_name);
+    }
+    BOOKYPEDIA_RECORD_ROWS(books);
+    return books;
 }
 
 void BookRepositoryImpl::DeleteBook(const domain::BookId& book_id) {
-    work_.exec_params("DELETE FROM books WHERE id = $1", book_id.ToString());
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.DeleteBook");
+    Write(statements::DELETE_BOOK, book_id);
 }
 
 void BookRepositoryImpl::EditBook(const domain::BookId& book_id, const std::string& title, int publication_year,
                                   const domain::Tags& tags) {
-    work_.exec_params("UPDATE books SET title = $2, publication_year = $3 WHERE id = $1;", book_id.ToString(), title,
-                      publication_year);
-    work_.exec_params("DELETE FROM book_tags WHERE book_id = $1;", book_id.ToString());
-    for (const auto& tag : tags) {
-        work_.exec_params("INSERT INTO book_tags (book_id, tag) VALUES ($1, $2);", book_id.ToString(), tag);
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.EditBook");
+    Write(statements::EDIT_BOOK, book_id, title, publication_year);
+    Write(statements::SAVE_BOOK_TAGS, book_id, tags);
+}
+
+size_t BookRepositoryImpl::DumpBooks(const domain::DumpPart& part, const domain::DumpLineSink& sink) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.DumpBooks");
+    auto& work = Work();
+    const auto query = DumpPartQuery(work, statements::DUMP_BOOKS, "books"sv, "id"sv, part);
+    return BOOKYPEDIA_COUNT_ROWS(Dump(work, query, sink));
+}
+
+size_t BookRepositoryImpl::DumpBookTags(const domain::DumpPart& part, const domain::DumpLineSink& sink) {
+    BOOKYPEDIA_TIME_OPERATION("BookRepository.DumpBookTags");
+    auto& work = Work();
+    const auto query = DumpPartQuery(work, statements::DUMP_BOOK_TAGS, "books"sv, "book_id"sv, part);
+    return BOOKYPEDIA_COUNT_ROWS(Dump(work, query, sink));
+}
+
+// Точки сохранения называются одинаково: RELEASE и ROLLBACK TO относятся к последней из одноимённых
+void UnitOfWorkImpl::SetSavepoint() {
+    if (pipeline_) {
+        pipeline_->Flush();
+    }
+    work_.exec("SAVEPOINT unit_of_work");
+}
+
+void UnitOfWorkImpl::ReleaseSavepoint() {
+    if (pipeline_) {
+        pipeline_->Flush();
+    }
+    work_.exec("RELEASE SAVEPOINT unit_of_work");
+}
+
+void UnitOfWorkImpl::RollbackToSavepoint() {
+    if (pipeline_) {
+        // Ошибка изменений, отправленных после точки сохранения, отменяется вместе с ними. Flush переводит
+        // ошибки запросов в исключения предметной области; разрыв соединения проявится при ROLLBACK TO
+        try {
+            pipeline_->Flush();
+        } catch (const std::exception&) {
+        }
     }
+    // ROLLBACK TO оставляет точку сохранения, поэтому она снимается отдельно
+    work_.exec("ROLLBACK TO SAVEPOINT unit_of_work");
+    work_.exec("RELEASE SAVEPOINT unit_of_work");
 }
 
-Database::Database(pqxx::connection connection) : connection_{std::move(connection)} {
-    pqxx::work work{connection_};
+ReadOnlyUnitOfWorkImpl::ReadOnlyUnitOfWorkImpl(ConnectionPool::ConnectionWrapper connection, bool deferrable,
+                                               UuidFormat uuid_format)
+    : ReadOnlyUnitOfWorkImpl(
+          std::move(connection),
+          [deferrable](pqxx::connection& conn) {
+              return BeginReadOnlyTransaction(conn, deferrable);
+          },
+          uuid_format) {}
+
+ReadOnlyUnitOfWorkImpl::ReadOnlyUnitOfWorkImpl(ConnectionPool::ConnectionWrapper connection,
+                                               const TransactionFactory& begin_transaction, UuidFormat uuid_format)
+    : connection_{std::move(connection)},
+      transaction_{begin_transaction(*connection_)},
+      authors_{*transaction_, uuid_format},
+      books_{*transaction_, uuid_format} {}
+
+Database::Database(const DatabaseConfig& config)
+    : primary_pool_{config.pool, MakeConnectionFactory(config.url)},
+      deferrable_reads_{config.deferrable_reads},
+      replica_selection_{config.replica_selection},
+      read_your_writes_window_{config.read_your_writes_window},
+      uuid_format_{config.uuid_format} {
+    replica_pools_.reserve(config.replica_urls.size());
+    for (const auto& replica_url : config.replica_urls) {
+        replica_pools_.push_back(std::make_unique<ConnectionPool>(config.pool, MakeConnectionFactory(replica_url)));
+    }
+
+    // Схема создаётся до того, как пул откроет первое соединение: на нём сразу готовятся запросы к таблицам
+    pqxx::connection connection{config.url};
+    pqxx::work work{connection};
 
     work.exec(R"(
 CREATE TABLE IF NOT EXISTS authors (
@@ -173,7 +887,7 @@ CREATE TABLE IF NOT EXISTS authors (
     work.exec(R"(
 CREATE TABLE IF NOT EXISTS books (
     id UUID CONSTRAINT book_id_constraint PRIMARY KEY,
-    author_id UUID NOT NULL,
+    author_id UUID NOT NULL CONSTRAINT books_author_id_fkey REFERENCES authors(id) ON DELETE CASCADE,
     title varchar(100) NOT NULL,
     publication_year INTEGER NOT NULL
 );
@@ -181,12 +895,161 @@ CREATE TABLE IF NOT EXISTS books (
 
     work.exec(R"(
 CREATE TABLE IF NOT EXISTS book_tags (
-    book_id UUID REFERENCES books(id) NOT NULL,
-    tag varchar(30) NOT NULL
+    book_id UUID NOT NULL CONSTRAINT book_tags_book_id_fkey REFERENCES books(id) ON DELETE CASCADE,
+    tag varchar(30) NOT NULL,
+    CONSTRAINT book_tags_pkey PRIMARY KEY (book_id, tag)
 );
 )"_zv);
 
+    // Таблицы, созданные прежними версиями, получают первичный ключ после удаления повторов
+    work.exec(R"(
+DO $$
+BEGIN
+    IF NOT EXISTS (SELECT 1 FROM pg_constraint WHERE conname = 'book_tags_pkey') THEN
+        DELETE FROM book_tags a USING book_tags b
+        WHERE a.ctid < b.ctid AND a.book_id = b.book_id AND a.tag = b.tag;
+        ALTER TABLE book_tags ADD CONSTRAINT book_tags_pkey PRIMARY KEY (book_id, tag);
+    END IF;
+END
+$$;
+)"_zv);
+
+    // Прежние версии удаляли книги и теги сами: их внешние ключи заменяются каскадными. Книги без автора
+    // не видел ни один запрос, но удалять их при запуске нельзя: приложение не запускается, пока их не
+    // удалит или не вернёт им авторов администратор
+    work.exec(R"(
+DO $$
+DECLARE
+    orphan_books bigint;
+BEGIN
+    IF EXISTS (SELECT 1 FROM pg_constraint WHERE conname = 'book_tags_book_id_fkey' AND confdeltype <> 'c') THEN
+        ALTER TABLE book_tags DROP CONSTRAINT book_tags_book_id_fkey;
+    END IF;
+    IF NOT EXISTS (SELECT 1 FROM pg_constraint WHERE conname = 'book_tags_book_id_fkey') THEN
+        ALTER TABLE book_tags ADD CONSTRAINT book_tags_book_id_fkey
+            FOREIGN KEY (book_id) REFERENCES books(id) ON DELETE CASCADE;
+    END IF;
+    IF NOT EXISTS (SELECT 1 FROM pg_constraint WHERE conname = 'books_author_id_fkey') THEN
+        SELECT count(*) INTO orphan_books
+        FROM books b WHERE NOT EXISTS (SELECT 1 FROM authors a WHERE a.id = b.author_id);
+        IF orphan_books > 0 THEN
+            RAISE EXCEPTION '% books refer to missing authors, so books_author_id_fkey cannot be added', orphan_books
+                USING HINT = 'Restore their authors or delete them with their tags: '
+                    'DELETE FROM books b WHERE NOT EXISTS (SELECT 1 FROM authors a WHERE a.id = b.author_id)';
+        END IF;
+        ALTER TABLE books ADD CONSTRAINT books_author_id_fkey
+            FOREIGN KEY (author_id) REFERENCES authors(id) ON DELETE CASCADE;
+    END IF;
+END
+$$;
+)"_zv);
+
+    work.exec("CREATE INDEX IF NOT EXISTS books_author_id_idx ON books (author_id, publication_year, title);"_zv);
+    work.exec("CREATE INDEX IF NOT EXISTS books_title_idx ON books (title, publication_year);"_zv);
+    work.exec("CREATE INDEX IF NOT EXISTS books_title_id_idx ON books (title, id);"_zv);
+    work.exec("CREATE INDEX IF NOT EXISTS authors_name_id_idx ON authors (name, id);"_zv);
+    // Поиск по тегам: по тегу сразу находятся все его книги
+    work.exec("CREATE INDEX IF NOT EXISTS book_tags_tag_book_id_idx ON book_tags (tag, book_id);"_zv);
+    // Полнотекстовый поиск: выражения должны совпадать с запросом search_books
+    work.exec("CREATE INDEX IF NOT EXISTS books_title_fts_idx ON books USING GIN (to_tsvector('simple', title));"_zv);
+    work.exec("CREATE INDEX IF NOT EXISTS authors_name_fts_idx ON authors USING GIN (to_tsvector('simple', name));"_zv);
+
     work.commit();
 }
 
+app::UnitOfWorkPtr Database::GetUnitOfWork() {
+    transaction_count_.fetch_add(1, std::memory_order_relaxed);
+    return std::make_unique<UnitOfWorkImpl>(primary_pool_.GetConnection(), uuid_format_, [this] {
+        OnCommit();
+    });
+}
+
+app::UnitOfWorkPtr Database::GetBatchUnitOfWork() {
+    transaction_count_.fetch_add(1, std::memory_order_relaxed);
+    return std::make_unique<UnitOfWorkImpl>(
+        primary_pool_.GetConnection(), uuid_format_,
+        [this] {
+            OnCommit();
+        },
+        true);
+}
+
+app::ReadOnlyUnitOfWorkPtr Database::GetReadOnlyUnitOfWork() {
+    transaction_count_.fetch_add(1, std::memory_order_relaxed);
+    return std::make_unique<ReadOnlyUnitOfWorkImpl>(SelectReadPool().GetConnection(), deferrable_reads_,
+                                                    uuid_format_);
+}
+
+std::vector<app::ReadOnlyUnitOfWorkPtr> Database::GetSnapshotUnitsOfWork(size_t count) {
+    // Все транзакции открываются на одном сервере: снимок нельзя перенести на другой
+    auto& pool = SelectReadPool();
+    const size_t busy = pool.GetBusyConnectionCount();
+    const size_t free = busy < pool.GetCapacity() ? pool.GetCapacity() - busy : 0;
+    count = std::clamp<size_t>(count, 1, std::max<size_t>(free, 1));
+
+    // Импортировать снимок в SERIALIZABLE DEFERRABLE нельзя, поэтому все транзакции — REPEATABLE READ READ ONLY
+    std::string snapshot_id;
+    std::vector<app::ReadOnlyUnitOfWorkPtr> units;
+    units.reserve(count);
+    units.push_back(std::make_unique<ReadOnlyUnitOfWorkImpl>(
+        pool.GetConnection(),
+        [&snapshot_id](pqxx::connection& connection) {
+            auto transaction = std::make_unique<SnapshotTransaction>(connection);
+            snapshot_id = transaction->query_value<std::string>("SELECT pg_export_snapshot()"_zv);
+            return transaction;
+        },
+        uuid_format_));
+
+    // Экспортированный снимок действует, пока открыта первая транзакция, а она живёт вместе с units
+    const auto import_snapshot = [&snapshot_id](pqxx::connection& connection) {
+        auto transaction = std::make_unique<SnapshotTransaction>(connection);
+        transaction->exec("SET TRANSACTION SNAPSHOT " + transaction->quote(snapshot_id));
+        return transaction;
+    };
+    while (units.size() < count) {
+        units.push_back(std::make_unique<ReadOnlyUnitOfWorkImpl>(pool.GetConnection(), import_snapshot, uuid_format_));
+    }
+    transaction_count_.fetch_add(units.size(), std::memory_order_relaxed);
+    return units;
+}
+
+void Database::OnCommit() {
+    if (read_your_writes_window_.count() == 0) {
+        return;
+    }
+    const auto now = Clock::now();
+    std::lock_guard lock{commit_times_mutex_};
+    std::erase_if(commit_times_, [this, now](const auto& commit_time) {
+        return now - commit_time.second >= read_your_writes_window_;
+    });
+    commit_times_[std::this_thread::get_id()] = now;
+}
+
+bool Database::CommittedRecently() const {
+    if (read_your_writes_window_.count() == 0) {
+        return false;
+    }
+    std::lock_guard lock{commit_times_mutex_};
+    const auto it = commit_times_.find(std::this_thread::get_id());
+    return it != commit_times_.end() && Clock::now() - it->second < read_your_writes_window_;
+}
+
+ConnectionPool& Database::SelectReadPool() {
+    if (replica_pools_.empty()) {
+        return primary_pool_;
+    }
+
+    if (CommittedRecently()) {
+        return primary_pool_;
+    }
+
+    if (replica_selection_ == ReplicaSelection::LeastLoaded) {
+        return **std::min_element(replica_pools_.begin(), replica_pools_.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs->GetBusyConnectionCount() < rhs->GetBusyConnectionCount();
+        });
+    }
+
+    return *replica_pools_[next_replica_.fetch_add(1, std::memory_order_relaxed) % replica_pools_.size()];
+}
+
 }  // namespace postgres
@@ -1,51 +1,153 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <pqxx/connection>
+#include <pqxx/pipeline>
 #include <pqxx/transaction>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "../app/unit_of_work.h"
 #include "../domain/author.h"
 #include "../domain/book.h"
+#include "connection_pool.h"
 
 namespace postgres {
 
+// Готовит на соединении все запросы, которые выполняют репозитории
+void PrepareStatements(pqxx::connection& connection);
+
+// Как передаются UUID-параметры запросов: канонической строкой или 16 байтами двоичного формата,
+// который сервер читает без разбора текста
+enum class UuidFormat { Text, Binary };
+
+// Изменяющие запросы единицы работы, которые отправляются на сервер пачками без ожидания ответа на каждый:
+// пока сервер выполняет одну пачку, копится следующая. libpqxx 7.7 не даёт протокольного конвейера libpq,
+// поэтому пачки — это pqxx::pipeline из SQL-команд EXECUTE с подготовленными запросами, а параметры
+// подставляются в текст экранированными. Ошибка запроса становится известна только при Flush
+class StatementPipeline {
+public:
+    explicit StatementPipeline(pqxx::transaction_base& work) : work_{work} {}
+
+    // Следующие запросы относятся к операции пакета с номером index: их ошибка бросается
+    // как app::BatchOperationError с этим номером
+    void BeginOperation(size_t index) noexcept {
+        operation_ = index;
+    }
+
+    template <typename... Args>
+    void Execute(pqxx::zview statement, const Args&... args) {
+        std::string query{"EXECUTE "};
+        query.append(work_.quote_name(statement)).push_back('(');
+        bool first = true;
+        ((query.append(first ? "" : ", ").append(work_.quote(args)), first = false), ...);
+        query.push_back(')');
+
+        if (!pipeline_) {
+            pipeline_ = std::make_unique<pqxx::pipeline>(work_);
+            pipeline_->retain(BATCH_SIZE);
+        }
+        pipeline_->insert(query);
+        statement_operations_.push_back(operation_);
+    }
+
+    // Дожидается выполнения отправленных запросов и бросает исключение первого неудачного; нарушение
+    // уникальности становится domain::AuthorExistsError, как и без конвейера.
+    // Вызывается перед любым другим запросом транзакции и перед фиксацией
+    void Flush();
+
+private:
+    static constexpr int BATCH_SIZE = 256;
+
+    pqxx::transaction_base& work_;
+    std::unique_ptr<pqxx::pipeline> pipeline_;
+    std::optional<size_t> operation_;
+    // Операции пакета, к которым относятся отправленные запросы, в порядке отправки
+    std::vector<std::optional<size_t>> statement_operations_;
+};
+
 class AuthorRepositoryImpl : public domain::AuthorRepository {
 public:
-    explicit AuthorRepositoryImpl(pqxx::work& work) : work_{work} {}
+    // Изменения отправляются через pipeline, если он задан, а чтения сначала дожидаются его запросов
+    explicit AuthorRepositoryImpl(pqxx::transaction_base& work, UuidFormat uuid_format = UuidFormat::Text,
+                                  StatementPipeline* pipeline = nullptr)
+        : work_{work}, uuid_format_{uuid_format}, pipeline_{pipeline} {}
 
     void Save(const domain::Author& author) override;
+    domain::Authors AddMissingAuthors(const domain::Authors& authors) override;
     void Delete(const domain::AuthorId& author_id) override;
     void Edit(const domain::AuthorId& author_id, const std::string& new_name) override;
 
     domain::Authors GetAllAuthors() override;
+    domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) override;
+    void ForEachAuthor(const domain::AuthorVisitor& visitor) override;
     std::optional<domain::Author> FindAuthorById(const domain::AuthorId& author_id) override;
     std::optional<domain::Author> FindAuthorByName(const std::string&) override;
 
+    size_t DumpAuthors(const domain::DumpPart& part, const domain::DumpLineSink& sink) override;
+
 private:
-    pqxx::work& work_;
+    pqxx::transaction_base& Work();
+    template <typename... Args>
+    void Write(pqxx::zview statement, const Args&... args);
+
+    pqxx::transaction_base& work_;
+    UuidFormat uuid_format_;
+    StatementPipeline* pipeline_;
 };
 
 class BookRepositoryImpl : public domain::BookRepository {
 public:
-    explicit BookRepositoryImpl(pqxx::work& work) : work_{work} {}
+    explicit BookRepositoryImpl(pqxx::transaction_base& work, UuidFormat uuid_format = UuidFormat::Text,
+                                StatementPipeline* pipeline = nullptr)
+        : work_{work}, uuid_format_{uuid_format}, pipeline_{pipeline} {}
 
     void Save(const domain::Book& book) override;
+    void AddBooks(const domain::Books& books) override;
     domain::Books GetAllBooks() override;
+    domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) override;
+    void ForEachBook(const domain::BookVisitor& visitor) override;
     domain::Books GetBooksByAuthorId(const domain::AuthorId& author_id) override;
     domain::Books GetBooksByTitle(const std::string& title) override;
-    void DeleteBookTags(const domain::BookId& book_id) override;
+    domain::Books SearchBooks(const std::string& query, size_t limit) override;
+    domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                 const std::optional<domain::BooksPageKey>& after, size_t limit) override;
     void DeleteBook(const domain::BookId& book_id) override;
     void EditBook(const domain::BookId& book_id, const std::string& title, int publication_year,
                   const domain::Tags& tags) override;
 
+    size_t DumpBooks(const domain::DumpPart& part, const domain::DumpLineSink& sink) override;
+    size_t DumpBookTags(const domain::DumpPart& part, const domain::DumpLineSink& sink) override;
+
 private:
-    pqxx::work& work_;
+    pqxx::transaction_base& Work();
+    template <typename... Args>
+    void Write(pqxx::zview statement, const Args&... args);
 
-    domain::Tags GetBookTags(const std::string& book_id) const;
+    pqxx::transaction_base& work_;
+    UuidFormat uuid_format_;
+    StatementPipeline* pipeline_;
 };
 
 class UnitOfWorkImpl : public app::UnitOfWork {
 public:
-    explicit UnitOfWorkImpl(pqxx::connection& connection) : work_{connection}, authors_{work_}, books_{work_} {}
+    using CommitHandler = std::function<void()>;
+
+    // В режиме pipelined изменения отправляются пачками через StatementPipeline
+    explicit UnitOfWorkImpl(ConnectionPool::ConnectionWrapper connection, UuidFormat uuid_format = UuidFormat::Text,
+                            CommitHandler on_commit = {}, bool pipelined = false)
+        : connection_{std::move(connection)},
+          work_{*connection_},
+          pipeline_{pipelined ? std::make_unique<StatementPipeline>(work_) : nullptr},
+          authors_{work_, uuid_format, pipeline_.get()},
+          books_{work_, uuid_format, pipeline_.get()},
+          on_commit_{std::move(on_commit)} {}
 
     domain::AuthorRepository& Authors() override {
         return authors_;
@@ -56,25 +158,114 @@ public:
     }
 
     void Commit() override {
+        if (pipeline_) {
+            pipeline_->Flush();
+        }
         work_.commit();
+        if (on_commit_) {
+            on_commit_();
+        }
+    }
+
+    void SetSavepoint() override;
+    void ReleaseSavepoint() override;
+    void RollbackToSavepoint() override;
+
+    void BeginBatchOperation(size_t index) override {
+        if (pipeline_) {
+            pipeline_->BeginOperation(index);
+        }
     }
 
 private:
+    ConnectionPool::ConnectionWrapper connection_;
     pqxx::work work_;
+    std::unique_ptr<StatementPipeline> pipeline_;
     AuthorRepositoryImpl authors_;
     BookRepositoryImpl books_;
+    CommitHandler on_commit_;
+};
+
+// Транзакция только для чтения, без фиксации. В режиме deferrable открывается как
+// SERIALIZABLE READ ONLY DEFERRABLE: ждёт безопасного снимка и не может быть прервана конфликтом
+class ReadOnlyUnitOfWorkImpl : public app::ReadOnlyUnitOfWork {
+public:
+    // Открывает на соединении транзакцию, в которой будут работать репозитории
+    using TransactionFactory = std::function<std::unique_ptr<pqxx::transaction_base>(pqxx::connection&)>;
+
+    ReadOnlyUnitOfWorkImpl(ConnectionPool::ConnectionWrapper connection, bool deferrable,
+                           UuidFormat uuid_format = UuidFormat::Text);
+    ReadOnlyUnitOfWorkImpl(ConnectionPool::ConnectionWrapper connection, const TransactionFactory& begin_transaction,
+                           UuidFormat uuid_format = UuidFormat::Text);
+
+    domain::AuthorRepository& Authors() override {
+        return authors_;
+    }
+
+    domain::BookRepository& Books() override {
+        return books_;
+    }
+
+private:
+    ConnectionPool::ConnectionWrapper connection_;
+    std::unique_ptr<pqxx::transaction_base> transaction_;
+    AuthorRepositoryImpl authors_;
+    BookRepositoryImpl books_;
+};
+
+enum class ReplicaSelection { RoundRobin, LeastLoaded };
+
+struct DatabaseConfig {
+    // Основной сервер: принимает все изменения
+    std::string url;
+    // Реплики: обслуживают единицы работы только для чтения
+    std::vector<std::string> replica_urls;
+    // Настройки пула, общие для всех серверов
+    ConnectionPool::Config pool;
+    bool deferrable_reads = false;
+    ReplicaSelection replica_selection = ReplicaSelection::RoundRobin;
+    // Сколько после фиксации изменений поток читает с основного сервера; 0 — сразу с реплик.
+    // Окно лишь приближает проверку позиции WAL на реплике: если реплика отстаёт дольше окна,
+    // поток после него всё равно может прочитать данные без своих изменений
+    std::chrono::milliseconds read_your_writes_window{0};
+    UuidFormat uuid_format = UuidFormat::Text;
 };
 
 class Database : public app::UnitOfWorkFactory {
 public:
-    explicit Database(pqxx::connection connection);
+    explicit Database(const DatabaseConfig& config);
+
+    app::UnitOfWorkPtr GetUnitOfWork() override;
+    app::UnitOfWorkPtr GetBatchUnitOfWork() override;
+    app::ReadOnlyUnitOfWorkPtr GetReadOnlyUnitOfWork() override;
+    // Первая транзакция экспортирует снимок (pg_export_snapshot), остальные открываются на нём
+    // на других соединениях того же сервера. Единиц работы не больше, чем свободных соединений в его пуле
+    std::vector<app::ReadOnlyUnitOfWorkPtr> GetSnapshotUnitsOfWork(size_t count) override;
 
-    app::UnitOfWorkPtr GetUnitOfWork() override {
-        return std::make_unique<UnitOfWorkImpl>(connection_);
+    // Сколько транзакций открыто с момента создания, включая транзакции только для чтения
+    size_t GetTransactionCount() const noexcept {
+        return transaction_count_.load(std::memory_order_relaxed);
     }
 
 private:
-    pqxx::connection connection_;
+    using Clock = std::chrono::steady_clock;
+
+    ConnectionPool& SelectReadPool();
+    void OnCommit();
+    bool CommittedRecently() const;
+
+    ConnectionPool primary_pool_;
+    std::vector<std::unique_ptr<ConnectionPool>> replica_pools_;
+    std::atomic<size_t> next_replica_{0};
+    std::atomic<size_t> transaction_count_{0};
+    bool deferrable_reads_;
+    ReplicaSelection replica_selection_;
+    std::chrono::milliseconds read_your_writes_window_;
+    UuidFormat uuid_format_;
+    // Время последней фиксации потоков этой базы: от него отсчитывается чтение своих записей.
+    // Записи старше окна не нужны и удаляются при следующих фиксациях
+    mutable std::mutex commit_times_mutex_;
+    std::unordered_map<std::thread::id, Clock::time_point> commit_times_;
 };
 
 }  // namespace postgres
@@ -0,0 +1,58 @@
+#include "catalog_export.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::literals;
+
+namespace ui {
+namespace detail {
+
+std::string GetExportFileName(app::CatalogTable table, size_t part) {
+    std::string name;
+    switch (table) {
+        case app::CatalogTable::Authors:
+            name = "authors"s;
+            break;
+        case app::CatalogTable::Books:
+            name = "books"s;
+            break;
+        case app::CatalogTable::BookTags:
+            name = "book_tags"s;
+            break;
+    }
+    return name.append(".").append(std::to_string(part)).append(".tsv");
+}
+
+}  // namespace detail
+
+ExportReport ExportCatalog(app::UseCases& use_cases, const std::filesystem::path& directory, size_t workers) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::filesystem::create_directories(directory);
+
+    const auto start = std::chrono::steady_clock::now();
+    ExportReport report;
+    report.result = use_cases.ExportCatalog(workers, [&directory](app::CatalogTable table, size_t part) {
+        const auto path = directory / detail::GetExportFileName(table, part);
+        // Файл закрывается вместе с последней копией приёмника, когда часть таблицы выгружена
+        auto file = std::make_shared<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+        if (!*file) {
+            throw std::runtime_error("Can't create "s + path.string());
+        }
+        return [file, path](std::string_view line) {
+            file->write(line.data(), static_cast<std::streamsize>(line.size())).put('\n');
+            if (!*file) {
+                throw std::runtime_error("Failed to write "s + path.string());
+            }
+        };
+    });
+    report.elapsed = std::chrono::steady_clock::now() - start;
+    return report;
+}
+
+}  // namespace ui
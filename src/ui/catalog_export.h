@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+
+#include "../app/use_cases.h"
+
+namespace ui {
+
+struct ExportReport {
+    app::ExportResult result;
+    std::chrono::duration<double> elapsed{};
+};
+
+// Выгружает каталог в каталог directory файлами authors.<i>.tsv, books.<i>.tsv и book_tags.<i>.tsv
+// в текстовом формате COPY, который PostgreSQL загружает обратно командой COPY ... FROM.
+// Части пишутся параллельно в workers потоков; 0 — по числу ядер. Файлы одной части согласованы:
+// все части выгружаются из одного снимка данных
+ExportReport ExportCatalog(app::UseCases& use_cases, const std::filesystem::path& directory, size_t workers = 0);
+
+namespace detail {
+
+std::string GetExportFileName(app::CatalogTable table, size_t part);
+
+}  // namespace detail
+}  // namespace ui
@@ -0,0 +1,304 @@
+#include "catalog_import.h"
+
+#include <algorithm>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <charconv>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "view.h"
+
+using namespace std::literals;
+
+namespace ui {
+namespace detail {
+
+namespace {
+
+std::string_view Trim(std::string_view str) {
+    constexpr auto SPACES = " \t\r\n\f\v"sv;
+    const auto first = str.find_first_not_of(SPACES);
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return str.substr(first, str.find_last_not_of(SPACES) - first + 1);
+}
+
+std::string NormalizeField(std::string_view field, std::string_view name) {
+    std::string value{Trim(field)};
+    if (value.empty()) {
+        throw std::invalid_argument("Empty "s.append(name));
+    }
+    return value;
+}
+
+int ParseYear(std::string_view field) {
+    field = Trim(field);
+    int year = 0;
+    const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), year);
+    if (error != std::errc{} || end != field.data() + field.size()) {
+        throw std::invalid_argument("Invalid publication year: "s.append(field));
+    }
+    return year;
+}
+
+// Поля строки CSV (RFC 4180, запись в одной строке): поле в кавычках может содержать запятые и "" вместо "
+std::vector<std::string> SplitCsvLine(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if (quoted) {
+            if (c != '"') {
+                fields.back().push_back(c);
+            } else if (i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back().push_back('"');
+                ++i;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else {
+            fields.back().push_back(c);
+        }
+    }
+
+    if (quoted) {
+        throw std::invalid_argument("Unterminated quoted field");
+    }
+    return fields;
+}
+
+}  // namespace
+
+std::optional<CatalogFormat> GetCatalogFormat(std::string_view path) {
+    if (boost::algorithm::iends_with(path, ".csv"sv)) {
+        return CatalogFormat::Csv;
+    }
+    if (boost::algorithm::iends_with(path, ".jsonl"sv)) {
+        return CatalogFormat::JsonLines;
+    }
+    return std::nullopt;
+}
+
+CsvColumns ParseCsvHeader(std::string_view line) {
+    std::optional<size_t> title, author, year, tags;
+    const auto names = SplitCsvLine(line);
+    for (size_t i = 0; i < names.size(); ++i) {
+        const auto name = boost::algorithm::to_lower_copy(std::string{Trim(names[i])});
+        if (name == "title"sv) {
+            title = i;
+        } else if (name == "author"sv) {
+            author = i;
+        } else if (name == "year"sv) {
+            year = i;
+        } else if (name == "tags"sv) {
+            tags = i;
+        }
+    }
+
+    if (!title || !author || !year) {
+        throw std::invalid_argument("CSV header must name the title, author and year columns");
+    }
+    return {*title, *author, *year, tags};
+}
+
+app::ImportedBook ParseCsvRecord(std::string_view line, const CsvColumns& columns) {
+    const auto fields = SplitCsvLine(line);
+    const size_t last_column = std::max({columns.title, columns.author, columns.year, columns.tags.value_or(0)});
+    if (fields.size() <= last_column) {
+        throw std::invalid_argument("Expected at least "s + std::to_string(last_column + 1) + " fields");
+    }
+
+    return {NormalizeField(fields[columns.title], "title"sv), NormalizeField(fields[columns.author], "author"sv),
+            ParseYear(fields[columns.year]), columns.tags ? ParseTags(fields[*columns.tags]) : domain::Tags{}};
+}
+
+app::ImportedBook ParseJsonRecord(const std::string& line) {
+    namespace pt = boost::property_tree;
+
+    pt::ptree record;
+    try {
+        std::istringstream input{line};
+        pt::read_json(input, record);
+    } catch (const pt::json_parser_error& ex) {
+        throw std::invalid_argument("Invalid JSON: "s + ex.message());
+    }
+
+    auto get_field = [&record](const char* name) {
+        auto value = record.get_optional<std::string>(name);
+        if (!value) {
+            throw std::invalid_argument("Missing "s + name);
+        }
+        return std::move(*value);
+    };
+
+    domain::Tags tags;
+    if (auto tags_node = record.get_child_optional("tags")) {
+        if (tags_node->empty()) {
+            // Теги строкой через запятую, как при ручном вводе
+            tags = ParseTags(tags_node->data());
+        } else {
+            std::vector<std::string> raw_tags;
+            for (const auto& [_, tag] : *tags_node) {
+                raw_tags.push_back(tag.data());
+            }
+            tags = PrepareTags(std::move(raw_tags));
+        }
+    }
+
+    return {NormalizeField(get_field("title"), "title"sv), NormalizeField(get_field("author"), "author"sv),
+            ParseYear(get_field("year")), std::move(tags)};
+}
+
+}  // namespace detail
+
+namespace {
+
+// Сколько строк разбирается и записывается за раз; часть записывается в одной единице работы
+constexpr size_t CHUNK_SIZE = 50'000;
+// Меньше строк на поток не выделяется: запуск потока дороже их разбора
+constexpr size_t MIN_LINES_PER_WORKER = 1'000;
+
+using RecordParser = std::function<app::ImportedBook(const std::string& line)>;
+
+struct ParsedChunk {
+    size_t line_count = 0;
+    std::vector<app::ImportedBook> books;
+    size_t rejected = 0;
+    std::string first_error;
+
+    void Append(ParsedChunk&& other) {
+        books.insert(books.end(), std::make_move_iterator(other.books.begin()),
+                     std::make_move_iterator(other.books.end()));
+        if (first_error.empty()) {
+            first_error = std::move(other.first_error);
+        }
+        rejected += other.rejected;
+    }
+};
+
+ParsedChunk ParseLines(const std::vector<std::string>& lines, size_t begin, size_t end, size_t first_line_number,
+                       const RecordParser& parse) {
+    ParsedChunk chunk;
+    chunk.books.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        if (lines[i].find_first_not_of(" \t\r"sv) == std::string::npos) {
+            continue;
+        }
+        try {
+            chunk.books.push_back(parse(lines[i]));
+        } catch (const std::exception& ex) {
+            if (chunk.rejected++ == 0) {
+                chunk.first_error = "line "s + std::to_string(first_line_number + i) + ": " + ex.what();
+            }
+        }
+    }
+    return chunk;
+}
+
+// Делит строки между потоками поровну; порядок книг сохраняется
+ParsedChunk ParseChunk(std::vector<std::string> lines, size_t first_line_number, const RecordParser& parse) {
+    const size_t worker_count = std::clamp<size_t>(lines.size() / MIN_LINES_PER_WORKER, 1,
+                                                   std::max(1u, std::thread::hardware_concurrency()));
+    const size_t slice_size = (lines.size() + worker_count - 1) / worker_count;
+
+    std::vector<std::future<ParsedChunk>> slices;
+    for (size_t begin = slice_size; begin < lines.size(); begin += slice_size) {
+        slices.push_back(std::async(std::launch::async, ParseLines, std::cref(lines), begin,
+                                    std::min(begin + slice_size, lines.size()), first_line_number, std::cref(parse)));
+    }
+
+    auto chunk = ParseLines(lines, 0, std::min(slice_size, lines.size()), first_line_number, parse);
+    for (auto& slice : slices) {
+        chunk.Append(slice.get());
+    }
+    chunk.line_count = lines.size();
+    return chunk;
+}
+
+std::vector<std::string> ReadLines(std::istream& input, size_t max_count) {
+    std::vector<std::string> lines;
+    lines.reserve(max_count);
+    std::string line;
+    while (lines.size() < max_count && std::getline(input, line)) {
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+}  // namespace
+
+ImportReport ImportCatalog(app::UseCases& use_cases, const std::string& path) {
+    const auto format = detail::GetCatalogFormat(path);
+    if (!format) {
+        throw std::invalid_argument("Unsupported catalog format, expected .csv or .jsonl");
+    }
+
+    std::ifstream input{path};
+    if (!input) {
+        throw std::runtime_error("Can't open " + path);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t line_number = 0;
+
+    RecordParser parse = detail::ParseJsonRecord;
+    if (*format == detail::CatalogFormat::Csv) {
+        std::string header;
+        if (!std::getline(input, header)) {
+            throw std::invalid_argument("CSV header is missing");
+        }
+        ++line_number;
+        parse = [columns = detail::ParseCsvHeader(header)](const std::string& line) {
+            return detail::ParseCsvRecord(line, columns);
+        };
+    }
+
+    auto read_chunk = [&] {
+        auto lines = ReadLines(input, CHUNK_SIZE);
+        const size_t first_line_number = line_number + 1;
+        line_number += lines.size();
+        return ParseChunk(std::move(lines), first_line_number, parse);
+    };
+
+    ImportReport report;
+    auto next_chunk = std::async(std::launch::async, read_chunk);
+    for (;;) {
+        auto chunk = next_chunk.get();
+        if (chunk.line_count == 0) {
+            break;
+        }
+        next_chunk = std::async(std::launch::async, read_chunk);
+
+        report.rows += chunk.books.size() + chunk.rejected;
+        report.rejected += chunk.rejected;
+        if (report.first_error.empty()) {
+            report.first_error = std::move(chunk.first_error);
+        }
+
+        const auto result = use_cases.ImportBooks(chunk.books);
+        report.books += result.books;
+        report.new_authors += result.new_authors;
+    }
+
+    report.elapsed = std::chrono::steady_clock::now() - start;
+    return report;
+}
+
+}  // namespace ui
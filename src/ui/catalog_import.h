@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../app/use_cases.h"
+
+namespace ui {
+
+struct ImportReport {
+    // Прочитанные записи, включая отклонённые
+    size_t rows = 0;
+    size_t books = 0;
+    size_t new_authors = 0;
+    size_t rejected = 0;
+    // Причина отклонения первой неверной записи с номером её строки
+    std::string first_error;
+    std::chrono::duration<double> elapsed{};
+};
+
+// Загружает каталог из файла CSV (.csv) или JSON Lines (.jsonl).
+// Файл читается частями: пока одна часть записывается в хранилище, следующая разбирается на всех ядрах.
+// Неверные записи пропускаются и учитываются в отчёте
+ImportReport ImportCatalog(app::UseCases& use_cases, const std::string& path);
+
+namespace detail {
+
+enum class CatalogFormat { Csv, JsonLines };
+
+std::optional<CatalogFormat> GetCatalogFormat(std::string_view path);
+
+// Номера колонок CSV, найденные по заголовку; колонка tags необязательна
+struct CsvColumns {
+    size_t title = 0;
+    size_t author = 0;
+    size_t year = 0;
+    std::optional<size_t> tags;
+};
+
+CsvColumns ParseCsvHeader(std::string_view line);
+
+// Разбор одной записи с приведением полей к виду, в котором их сохраняет ручной ввод.
+// Неверная запись — исключение std::invalid_argument с описанием
+app::ImportedBook ParseCsvRecord(std::string_view line, const CsvColumns& columns);
+app::ImportedBook ParseJsonRecord(const std::string& line);
+
+}  // namespace detail
+}  // namespace ui
@@ -4,12 +4,21 @@
 #include <boost/algorithm/string/regex.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <algorithm>
 #include <cassert>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <tuple>
 #include <unordered_set>
 
 #include "../app/use_cases.h"
+#include "../domain/book.h"
 #include "../menu/menu.h"
+#include "../util/stats.h"
+#include "catalog_export.h"
+#include "catalog_import.h"
 
 using namespace std::literals;
 namespace ph = std::placeholders;
@@ -28,7 +37,8 @@ std::ostream& operator<<(std::ostream& out, const BookInfo& book) {
 }
 
 void NormalizeTag(std::string& tag) {
-    tag = boost::regex_replace(tag, boost::regex("\\s+"), " ");  // " +"
+    static const boost::regex whitespace{"\\s+"};
+    tag = boost::regex_replace(tag, whitespace, " ");  // " +"
     boost::algorithm::trim(tag);
 }
 
@@ -48,6 +58,12 @@ std::vector<std::string> PrepareTags(std::vector<std::string> raw_tags) {
     return result;
 }
 
+std::vector<std::string> ParseTags(std::string_view input) {
+    std::vector<std::string> raw_tags;
+    boost::split(raw_tags, input, boost::is_any_of(","));
+    return PrepareTags(std::move(raw_tags));
+}
+
 std::string NormalizeInput(std::istream& input) {
     std::string line;
     std::getline(input, line);
@@ -60,22 +76,107 @@ std::string FormatTags(const std::vector<std::string>& tags) {
 }
 
 void PrintBook(std::ostream& out, const detail::BookInfo& book) {
-    out << "Title: "sv << book.title << std::endl;
-    out << "Author: "sv << book.author_name << std::endl;
-    out << "Publication year: "sv << book.publication_year << std::endl;
+    out << "Title: "sv << book.title << '\n';
+    out << "Author: "sv << book.author_name << '\n';
+    out << "Publication year: "sv << book.publication_year << '\n';
     if (book.tags.empty()) {
         return;
     }
-    out << "Tags: "sv << FormatTags(book.tags) << std::endl;
+    out << "Tags: "sv << FormatTags(book.tags) << '\n';
+}
+
+BookInfo ToBookInfo(const domain::Book& book) {
+    return {book.GetBookId().ToString(), book.GetTitle(), book.GetAuthorName(), book.GetPublicationYear(),
+            book.GetTags()};
+}
+
+std::vector<BookInfo> BooksToInfo(const domain::Books& books) {
+    std::vector<BookInfo> result;
+    result.reserve(books.size());
+
+    for (const auto& book : books) {
+        result.push_back(ToBookInfo(book));
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.title, lhs.author_name, lhs.publication_year) <
+               std::tie(rhs.title, rhs.author_name, rhs.publication_year);
+    });
+
+    return result;
 }
 
 }  // namespace detail
 
+namespace {
+
+// Сколько элементов показывается при выборе
+constexpr size_t SELECT_PAGE_SIZE = 20;
+// Сколько книг, найденных по названию, предлагается на выбор
+constexpr size_t SEARCH_LIMIT = SELECT_PAGE_SIZE;
+// Книги по тегам читаются страницами: под частый тег может попасть весь каталог
+constexpr size_t TAG_PAGE_SIZE = 1000;
+
 template <typename T>
-void PrintVector(std::ostream& out, const std::vector<T>& vector) {
-    int i = 1;
+using PageFetcher = std::function<std::vector<T>(const std::optional<T>& after, size_t limit)>;
+
+}  // namespace
+
+template <typename T>
+void PrintVector(std::ostream& out, const std::vector<T>& vector, size_t first_number = 1) {
+    size_t i = first_number;
     for (auto& value : vector) {
-        out << i++ << " "sv << value << std::endl;
+        out << i++ << " "sv << value << '\n';
+    }
+}
+
+// Выводит элементы по страницам и возвращает выбранный пользователем.
+// Номера сквозные, выбрать можно элемент текущей страницы
+template <typename T>
+std::optional<T> SelectFromPages(std::istream& input, std::ostream& output, const PageFetcher<T>& fetch_page,
+                                 std::string_view prompt, const std::string& error, bool cancel_if_empty) {
+    size_t first_number = 1;
+    std::optional<T> after;
+    for (;;) {
+        auto page = fetch_page(after, SELECT_PAGE_SIZE + 1);
+        if (cancel_if_empty && page.empty() && !after) {
+            return std::nullopt;
+        }
+
+        const bool has_next_page = page.size() > SELECT_PAGE_SIZE;
+        if (has_next_page) {
+            page.pop_back();
+        }
+
+        PrintVector(output, page, first_number);
+        if (has_next_page) {
+            output << "Enter n for the next page"sv << '\n';
+        }
+        output << prompt << '\n';
+
+        std::string str;
+        if (!std::getline(input, str) || str.empty()) {
+            return std::nullopt;
+        }
+
+        if (has_next_page && str == "n"sv) {
+            first_number += page.size();
+            after = std::move(page.back());
+            continue;
+        }
+
+        size_t number;
+        try {
+            number = std::stoul(str);
+        } catch (const std::exception&) {
+            throw std::runtime_error(error);
+        }
+
+        if (number < first_number || number >= first_number + page.size()) {
+            throw std::runtime_error(error);
+        }
+
+        return page[number - first_number];
     }
 }
 
@@ -92,8 +193,19 @@ View::View(menu::Menu& menu, app::UseCases& use_cases, std::istream& input, std:
     menu_.AddAction("ShowBooks"s, {}, "Show books"s, std::bind(&View::ShowBooks, this));
     menu_.AddAction("ShowAuthors"s, {}, "Show authors"s, std::bind(&View::ShowAuthors, this));
     menu_.AddAction("ShowAuthorBooks"s, {}, "Show author books"s, std::bind(&View::ShowAuthorBooks, this));
-}
-
+    menu_.AddAction("ShowBooksByTag"s, "[--any] <tag>, ..."s, "Show books with all (or any) of the tags"s,
+                    std::bind(&View::ShowBooksByTag, this, ph::_1));
+    menu_.AddAction("ImportCatalog"s, "<file>"s, "Imports books from a .csv or .jsonl file"s,
+                    std::bind(&View::ImportCatalog, this, ph::_1));
+    menu_.AddAction("ExportCatalog"s, "<directory> [workers]"s, "Exports a consistent catalog snapshot in parallel"s,
+                    std::bind(&View::ExportCatalog, this, ph::_1));
+    menu_.AddAction("Stats"s, {}, "Shows call latencies of use cases and repositories"s,
+                    std::bind(&View::ShowStats, this));
+}
+
+// Изменяющая команда сначала собирает весь ввод: поиск и выбор читают данные в своих коротких единицах работы.
+// Затем изменения выполняются вместе одной командой, которая не ждёт пользователя с открытой транзакцией.
+// Если выбранную строку тем временем изменят или удалят, изменение не выполнится или не найдёт её
 bool View::AddAuthor(std::istream& cmd_input) const {
     try {
         std::string name = detail::NormalizeInput(cmd_input);
@@ -102,14 +214,13 @@ bool View::AddAuthor(std::istream& cmd_input) const {
             throw std::runtime_error("Empty author name"s);
         }
 
-        if (auto author = use_cases_.FindAuthorByName(name)) {
-            throw std::runtime_error("This author already exists"s);
-        }
-
-        use_cases_.AddAuthor(std::move(name));
+        // Занятое имя отклоняет хранилище: отдельная проверка перед записью не нужна
+        use_cases_.RunCommand([&] {
+            use_cases_.AddAuthor(name);
+        });
 
     } catch (const std::exception& ex) {
-        output_ << "Failed to add author: "sv << ex.what() << std::endl;
+        output_ << "Failed to add author: "sv << ex.what() << '\n';
     }
     return true;
 }
@@ -123,10 +234,12 @@ bool View::DeleteAuthor(std::istream& cmd_input) const {
             throw std::runtime_error("Author not found or not selected"s);
         }
 
-        use_cases_.DeleteAuthor(domain::AuthorId::FromString(author->id));
+        use_cases_.RunCommand([&] {
+            use_cases_.DeleteAuthor(domain::AuthorId::FromString(author->id));
+        });
 
     } catch (const std::exception& ex) {
-        output_ << "Failed to delete author: "sv << ex.what() << std::endl;
+        output_ << "Failed to delete author: "sv << ex.what() << '\n';
     }
     return true;
 }
@@ -140,17 +253,19 @@ bool View::EditAuthor(std::istream& cmd_input) const {
             throw std::runtime_error("Author not found or not selected"s);
         }
 
-        output_ << "Enter new name:"sv << std::endl;
+        output_ << "Enter new name:"sv << '\n';
         std::string new_name = detail::NormalizeInput(input_);
 
         if (new_name.empty()) {
             throw std::runtime_error("Empty input new name"s);
         }
 
-        use_cases_.EditAuthor(domain::AuthorId::FromString(author->id), new_name);
+        use_cases_.RunCommand([&] {
+            use_cases_.EditAuthor(domain::AuthorId::FromString(author->id), new_name);
+        });
 
     } catch (const std::exception& ex) {
-        output_ << "Failed to edit author: "sv << ex.what() << std::endl;
+        output_ << "Failed to edit author: "sv << ex.what() << '\n';
     }
     return true;
 }
@@ -163,11 +278,18 @@ bool View::AddBook(std::istream& cmd_input) const {
             throw std::runtime_error("Invalid book parameters"s);
         }
 
-        use_cases_.AddBook(domain::AuthorId::FromString(std::move(params->author_id)), std::move(params->title),
-                           params->publication_year, std::move(params->tags), std::move(params->author_name));
+        // Новый автор, выбранный при вводе, и книга фиксируются вместе
+        const auto author_id = domain::AuthorId::FromString(params->author_id);
+        use_cases_.RunCommand([&] {
+            if (params->new_author) {
+                use_cases_.AddAuthorWithId(author_id, params->author_name);
+            }
+            use_cases_.AddBook(author_id, params->title, params->publication_year, std::move(params->tags),
+                               params->author_name);
+        });
 
     } catch (const std::exception& ex) {
-        output_ << "Failed to add book: "sv << ex.what() << std::endl;
+        output_ << "Failed to add book: "sv << ex.what() << '\n';
     }
     return true;
 }
@@ -180,10 +302,12 @@ bool View::DeleteBook(std::istream& cmd_input) const {
             return true;
         }
 
-        use_cases_.DeleteBook(domain::BookId::FromString(book->id));
+        use_cases_.RunCommand([&] {
+            use_cases_.DeleteBook(domain::BookId::FromString(book->id));
+        });
 
     } catch (const std::exception& ex) {
-        output_ << "Failed to delete book: "sv << ex.what() << std::endl;
+        output_ << "Failed to delete book: "sv << ex.what() << '\n';
     }
     return true;
 }
@@ -193,7 +317,7 @@ bool View::EditBook(std::istream& cmd_input) const {
         auto book = SelectBookByTitle(cmd_input);
 
         if (!book) {
-            output_ << "Book not found"sv << std::endl;
+            output_ << "Book not found"sv << '\n';
             return true;
         }
 
@@ -201,10 +325,13 @@ bool View::EditBook(std::istream& cmd_input) const {
         book->publication_year = ReadNewYear(book->publication_year);
         book->tags = ReadNewTags(book->tags);
 
-        use_cases_.EditBook(domain::BookId::FromString(book->id), book->title, book->publication_year, book->tags);
+        use_cases_.RunCommand([&] {
+            use_cases_.EditBook(domain::BookId::FromString(book->id), book->title, book->publication_year,
+                                book->tags);
+        });
 
     } catch (const std::exception& ex) {
-        output_ << "Failed to edit book: "sv << ex.what() << std::endl;
+        output_ << "Failed to edit book: "sv << ex.what() << '\n';
     }
     return true;
 }
@@ -220,18 +347,71 @@ bool View::ShowBook(std::istream& cmd_input) const {
         detail::PrintBook(output_, *selected_book);
 
     } catch (const std::exception& ex) {
-        output_ << "Failed to Show Book: "sv << ex.what() << std::endl;
+        output_ << "Failed to Show Book: "sv << ex.what() << '\n';
     }
     return true;
 }
 
+// Списки выводятся по мере чтения из хранилища и не накапливаются в памяти. Хранилище выдаёт книги
+// в порядке (title, id), а список упорядочен по названию, автору и году, поэтому в памяти держатся
+// только книги с одним названием: они сортируются, когда начинается следующее
 bool View::ShowBooks() const {
-    PrintVector(output_, GetAllBooks());
+    size_t i = 1;
+    std::vector<detail::BookInfo> same_title;
+    auto flush = [this, &i, &same_title] {
+        std::stable_sort(same_title.begin(), same_title.end(), [](const auto& lhs, const auto& rhs) {
+            return std::tie(lhs.author_name, lhs.publication_year) < std::tie(rhs.author_name, rhs.publication_year);
+        });
+        for (const auto& book : same_title) {
+            output_ << i++ << " "sv << book << '\n';
+        }
+        same_title.clear();
+    };
+
+    use_cases_.ForEachBook([&same_title, &flush](const domain::Book& book) {
+        if (!same_title.empty() && same_title.front().title != book.GetTitle()) {
+            flush();
+        }
+        same_title.push_back(detail::ToBookInfo(book));
+    });
+    flush();
+    return true;
+}
+
+bool View::ShowBooksByTag(std::istream& cmd_input) const {
+    try {
+        std::string input = detail::NormalizeInput(cmd_input);
+        auto match = domain::TagMatch::All;
+        if (constexpr auto ANY_FLAG = "--any"sv; input.starts_with(ANY_FLAG)) {
+            match = domain::TagMatch::Any;
+            input.erase(0, ANY_FLAG.size());
+        }
+
+        const auto tags = detail::ParseTags(input);
+        if (tags.empty()) {
+            throw std::runtime_error("Empty tag list"s);
+        }
+
+        size_t i = 1;
+        std::optional<domain::BooksPageKey> after;
+        for (auto page = use_cases_.GetBooksByTags(tags, match, after, TAG_PAGE_SIZE); !page.empty();
+             page = use_cases_.GetBooksByTags(tags, match, after, TAG_PAGE_SIZE)) {
+            for (const auto& book : page) {
+                output_ << i++ << " "sv << detail::ToBookInfo(book) << '\n';
+            }
+            after = domain::BooksPageKey{page.back().GetTitle(), page.back().GetBookId()};
+        }
+    } catch (const std::exception& ex) {
+        output_ << "Failed to show books by tag: "sv << ex.what() << '\n';
+    }
     return true;
 }
 
 bool View::ShowAuthors() const {
-    PrintVector(output_, GetAuthors());
+    size_t i = 1;
+    use_cases_.ForEachAuthor([this, &i](const domain::Author& author) {
+        output_ << i++ << " "sv << detail::AuthorInfo{author.GetId().ToString(), author.GetName()} << '\n';
+    });
     return true;
 }
 
@@ -245,11 +425,99 @@ bool View::ShowAuthorBooks() const {
 
         PrintVector(output_, GetAuthorBooks(*author_id));
     } catch (const std::exception& ex) {
-        output_ << "Failed to Show Books: "sv << ex.what() << std::endl;
+        output_ << "Failed to Show Books: "sv << ex.what() << '\n';
     }
     return true;
 }
 
+bool View::ImportCatalog(std::istream& cmd_input) const {
+    try {
+        const std::string path = detail::NormalizeInput(cmd_input);
+        if (path.empty()) {
+            throw std::runtime_error("Empty file name"s);
+        }
+
+        const auto report = ui::ImportCatalog(use_cases_, path);
+        const double seconds = report.elapsed.count();
+        output_ << "Imported "sv << report.books << " books ("sv << report.new_authors << " new authors) in "sv
+                << seconds << " s, "sv << static_cast<size_t>(seconds > 0 ? report.rows / seconds : 0)
+                << " rows/s"sv << '\n';
+        if (report.rejected > 0) {
+            output_ << "Skipped "sv << report.rejected << " invalid rows, the first at "sv << report.first_error
+                    << '\n';
+        }
+    } catch (const std::exception& ex) {
+        output_ << "Failed to import catalog: "sv << ex.what() << '\n';
+    }
+    return true;
+}
+
+bool View::ExportCatalog(std::istream& cmd_input) const {
+    try {
+        std::string directory;
+        size_t workers = 0;
+        if (!(cmd_input >> directory)) {
+            throw std::runtime_error("Empty directory name"s);
+        }
+        if (!(cmd_input >> workers) && !cmd_input.eof()) {
+            throw std::runtime_error("Invalid number of workers"s);
+        }
+
+        const auto report = ui::ExportCatalog(use_cases_, directory, workers);
+        const auto& result = report.result;
+        const size_t rows = result.authors + result.books + result.book_tags;
+        const double seconds = report.elapsed.count();
+        output_ << "Exported "sv << result.authors << " authors, "sv << result.books << " books and "sv
+                << result.book_tags << " tags in "sv << result.parts << " parts in "sv << seconds << " s, "sv
+                << static_cast<size_t>(seconds > 0 ? rows / seconds : 0) << " rows/s"sv << '\n';
+    } catch (const std::exception& ex) {
+        output_ << "Failed to export catalog: "sv << ex.what() << '\n';
+    }
+    return true;
+}
+
+// Задержки в микросекундах по квантилям гистограммы; точность — около 3% значения
+bool View::ShowStats() const {
+    if constexpr (!util::stats::ENABLED) {
+        output_ << "Statistics are disabled in this build"sv << '\n';
+        return true;
+    }
+
+    const auto operations = util::stats::Registry::Global().GetSnapshot();
+    if (operations.empty()) {
+        output_ << "No operations recorded yet"sv << '\n';
+        return true;
+    }
+
+    size_t name_width = "Operation"sv.size();
+    for (const auto& operation : operations) {
+        name_width = std::max(name_width, operation.name.size());
+    }
+    constexpr int COLUMN_WIDTH = 12;
+    auto micros = [](uint64_t nanoseconds) {
+        return nanoseconds / 1e3;
+    };
+
+    const auto flags = output_.flags();
+    const auto precision = output_.precision();
+    output_ << std::left << std::setw(static_cast<int>(name_width)) << "Operation"sv << std::right;
+    for (const auto column : {"Calls"sv, "p50, us"sv, "p99, us"sv, "p99.9, us"sv, "Rows"sv, "Errors"sv}) {
+        output_ << std::setw(COLUMN_WIDTH) << column;
+    }
+    output_ << '\n' << std::fixed << std::setprecision(1);
+    for (const auto& operation : operations) {
+        const auto& latency = operation.latency;
+        output_ << std::left << std::setw(static_cast<int>(name_width)) << operation.name << std::right
+                << std::setw(COLUMN_WIDTH) << latency.count << std::setw(COLUMN_WIDTH) << micros(latency.ValueAt(0.5))
+                << std::setw(COLUMN_WIDTH) << micros(latency.ValueAt(0.99)) << std::setw(COLUMN_WIDTH)
+                << micros(latency.ValueAt(0.999)) << std::setw(COLUMN_WIDTH) << operation.rows
+                << std::setw(COLUMN_WIDTH) << operation.errors << '\n';
+    }
+    output_.flags(flags);
+    output_.precision(precision);
+    return true;
+}
+
 // --- --- --- --- --- --- --- --- --- ---
 
 std::optional<detail::AddBookParams> View::GetBookParams(std::istream& cmd_input) const {
@@ -272,15 +540,16 @@ std::optional<detail::AddBookParams> View::GetBookParams(std::istream& cmd_input
 
     params.author_id = author_info->id;
     params.author_name = author_info->name;
+    params.new_author = author_info->is_new;
 
-    output_ << "Enter tags (comma separated):"sv << std::endl;
+    output_ << "Enter tags (comma separated):"sv << '\n';
     params.tags = GetBookTags();
 
     return params;
 }
 
 std::optional<detail::AuthorInfo> View::SelectAuthorOrAddNew() const {
-    output_ << "Enter author name or empty line to select from list:"sv << std::endl;
+    output_ << "Enter author name or empty line to select from list:"sv << '\n';
 
     std::string name = detail::NormalizeInput(input_);
 
@@ -288,15 +557,14 @@ std::optional<detail::AuthorInfo> View::SelectAuthorOrAddNew() const {
         return *author;
     }
 
-    output_ << "No author found. Do you want to add "sv << name << " (y/n)?"sv << std::endl;
+    output_ << "No author found. Do you want to add "sv << name << " (y/n)?"sv << '\n';
     std::string answer = detail::NormalizeInput(input_);
     if (answer != "y" && answer != "Y") {
         return std::nullopt;
     }
 
-    auto id = domain::AuthorId::New();
-    use_cases_.AddAuthorWithId(id, name);
-    return detail::AuthorInfo{id.ToString(), name};
+    // Автор добавляется вместе с книгой, когда весь ввод собран
+    return detail::AuthorInfo{domain::AuthorId::New().ToString(), name, true};
 }
 
 std::optional<detail::AuthorInfo> View::FindAuthorByNameOrSelect(const std::string& name) const {
@@ -312,29 +580,13 @@ std::optional<detail::AuthorInfo> View::FindAuthorByNameOrSelect(const std::stri
 }
 
 std::optional<detail::AuthorInfo> View::SelectAuthor() const {
-    output_ << "Select author:"sv << std::endl;
-    auto authors = GetAuthors();
-    PrintVector(output_, authors);
-    output_ << "Enter author # or empty line to cancel"sv << std::endl;
-
-    std::string str;
-    if (!std::getline(input_, str) || str.empty()) {
-        return std::nullopt;
-    }
-
-    int author_idx;
-    try {
-        author_idx = std::stoi(str);
-    } catch (std::exception const&) {
-        throw std::runtime_error("Invalid author num"s);
-    }
-
-    --author_idx;
-    if (author_idx < 0 or author_idx >= authors.size()) {
-        throw std::runtime_error("Invalid author num"s);
-    }
-
-    return authors[author_idx];
+    output_ << "Select author:"sv << '\n';
+    return SelectFromPages<detail::AuthorInfo>(
+        input_, output_,
+        [this](const auto& after, size_t limit) {
+            return GetAuthorsPage(after, limit);
+        },
+        "Enter author # or empty line to cancel"sv, "Invalid author num"s, false);
 }
 
 std::optional<detail::BookInfo> View::SelectBook(std::vector<detail::BookInfo> books) const {
@@ -343,7 +595,7 @@ std::optional<detail::BookInfo> View::SelectBook(std::vector<detail::BookInfo> b
     }
 
     PrintVector(output_, books);
-    output_ << "Enter the book # or empty line to cancel:"sv << std::endl;
+    output_ << "Enter the book # or empty line to cancel:"sv << '\n';
 
     std::string str;
     if (!std::getline(input_, str) || str.empty()) {
@@ -371,40 +623,46 @@ std::vector<std::string> View::GetBookTags() const {
         return {};
     }
 
-    std::vector<std::string> raw_tags;
-    boost::split(raw_tags, input_tags, boost::is_any_of(","));
-
-    return detail::PrepareTags(std::move(raw_tags));
+    return detail::ParseTags(input_tags);
 }
 
 std::optional<detail::BookInfo> View::SelectBookByTitle(std::istream& cmd_input) const {
     std::string title = detail::NormalizeInput(cmd_input);
 
     if (title.empty()) {
-        return SelectBook(GetAllBooks());
-    }
-
-    auto same_title_books = GetBooksByTitle(title);
+        return SelectFromPages<detail::BookInfo>(
+            input_, output_,
+            [this](const auto& after, size_t limit) {
+                return GetBooksPage(after, limit);
+            },
+            "Enter the book # or empty line to cancel:"sv, "Invalid book num"s, true);
+    }
+
+    // Книги с точно совпадающим названием идут в выдаче первыми. Если такая одна, она выбирается сразу,
+    // а неточные совпадения всегда подтверждаются выбором из списка
+    auto found_books = SearchBooks(title);
+    const auto exact_end = std::find_if(found_books.begin(), found_books.end(), [&title](const auto& book) {
+        return book.title != title;
+    });
 
-    if (same_title_books.empty()) {
-        return std::nullopt;
+    if (exact_end - found_books.begin() == 1) {
+        return found_books.front();
     }
-
-    if (same_title_books.size() == 1) {
-        return same_title_books.front();
+    if (exact_end != found_books.begin()) {
+        found_books.erase(exact_end, found_books.end());
     }
 
-    return SelectBook(same_title_books);
+    return SelectBook(std::move(found_books));
 }
 
 std::string View::ReadNewTitle(const std::string& current_title) const {
-    output_ << "Enter new title or empty line to use the current one ("sv << current_title << "):"sv << std::endl;
+    output_ << "Enter new title or empty line to use the current one ("sv << current_title << "):"sv << '\n';
     std::string title = detail::NormalizeInput(input_);
     return title.empty() ? current_title : title;
 }
 
 int View::ReadNewYear(int current_year) const {
-    output_ << "Enter publication year or empty line to use the current one ("sv << current_year << "):"sv << std::endl;
+    output_ << "Enter publication year or empty line to use the current one ("sv << current_year << "):"sv << '\n';
     std::string year_str = detail::NormalizeInput(input_);
     if (year_str.empty()) {
         return current_year;
@@ -417,49 +675,56 @@ int View::ReadNewYear(int current_year) const {
 }
 
 std::vector<std::string> View::ReadNewTags(const std::vector<std::string>& current_tags) const {
-    output_ << "Enter tags (current tags: "sv << detail::FormatTags(current_tags) << "):"sv << std::endl;
+    output_ << "Enter tags (current tags: "sv << detail::FormatTags(current_tags) << "):"sv << '\n';
     return GetBookTags();
 }
 
-std::vector<detail::AuthorInfo> View::GetAuthors() const {
-    const auto& all_authors = use_cases_.GetAllAuthors();
+std::vector<detail::AuthorInfo> View::GetAuthorsPage(const std::optional<detail::AuthorInfo>& after,
+                                                     size_t limit) const {
+    std::optional<domain::AuthorsPageKey> key;
+    if (after) {
+        key = domain::AuthorsPageKey{after->name, domain::AuthorId::FromString(after->id)};
+    }
+
+    const auto authors = use_cases_.GetAuthorsPage(key, limit);
     std::vector<detail::AuthorInfo> result;
-    result.reserve(all_authors.size());
+    result.reserve(authors.size());
 
-    for (const auto& author : all_authors) {
+    for (const auto& author : authors) {
         result.emplace_back(author.GetId().ToString(), author.GetName());
     }
 
     return result;
 }
 
-std::vector<detail::BookInfo> View::BooksToInfo(const domain::Books& books) const {
+std::vector<detail::BookInfo> View::GetBooksPage(const std::optional<detail::BookInfo>& after, size_t limit) const {
+    std::optional<domain::BooksPageKey> key;
+    if (after) {
+        key = domain::BooksPageKey{after->title, domain::BookId::FromString(after->id)};
+    }
+
+    const auto books = use_cases_.GetBooksPage(key, limit);
     std::vector<detail::BookInfo> result;
     result.reserve(books.size());
 
     for (const auto& book : books) {
-        result.emplace_back(book.GetBookId().ToString(), book.GetTitle(), book.GetAuthorName(),
-                            book.GetPublicationYear(), book.GetTags());
+        result.push_back(detail::ToBookInfo(book));
     }
 
-    std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
-        return std::tie(lhs.title, lhs.author_name, lhs.publication_year) <
-               std::tie(rhs.title, rhs.author_name, rhs.publication_year);
-    });
-
     return result;
 }
 
-std::vector<detail::BookInfo> View::GetAllBooks() const {
-    return BooksToInfo(use_cases_.GetAllBooks());
-}
-
 std::vector<detail::BookInfo> View::GetAuthorBooks(const detail::AuthorInfo& author) const {
-    return BooksToInfo(use_cases_.GetBooksByAuthor(domain::AuthorId::FromString(author.id)));
+    return detail::BooksToInfo(use_cases_.GetBooksByAuthor(domain::AuthorId::FromString(author.id)));
 }
 
-std::vector<detail::BookInfo> View::GetBooksByTitle(const std::string& title) const {
-    return BooksToInfo(use_cases_.GetBooksByTitle(title));
+// Выдача уже упорядочена по релевантности, поэтому, в отличие от BooksToInfo, книги не пересортировываются
+std::vector<detail::BookInfo> View::SearchBooks(const std::string& query) const {
+    const auto books = use_cases_.SearchBooks(query, SEARCH_LIMIT);
+    std::vector<detail::BookInfo> result;
+    result.reserve(books.size());
+    std::transform(books.begin(), books.end(), std::back_inserter(result), detail::ToBookInfo);
+    return result;
 }
 
 }  // namespace ui
@@ -2,6 +2,7 @@
 #include <iosfwd>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "../domain/book_fwd.h"
@@ -23,11 +24,15 @@ struct AddBookParams {
     std::string author_name;
     int publication_year = 0;
     std::vector<std::string> tags;
+    // Автора ещё нет в каталоге: он добавляется вместе с книгой
+    bool new_author = false;
 };
 
 struct AuthorInfo {
     std::string id;
     std::string name;
+    // Автор введён пользователем и ещё не добавлен
+    bool is_new = false;
 };
 
 struct BookInfo {
@@ -38,6 +43,13 @@ struct BookInfo {
     std::vector<std::string> tags;
 };
 
+// Приводит теги к единому виду: пробелы схлопываются, пустые и повторы отбрасываются, порядок алфавитный
+std::vector<std::string> PrepareTags(std::vector<std::string> raw_tags);
+// Разбирает теги, перечисленные через запятую
+std::vector<std::string> ParseTags(std::string_view input);
+// Книги для вывода, упорядоченные по названию, автору и году
+std::vector<BookInfo> BooksToInfo(const domain::Books& books);
+
 }  // namespace detail
 
 class View {
@@ -55,6 +67,10 @@ private:
     bool ShowBooks() const;
     bool ShowAuthors() const;
     bool ShowAuthorBooks() const;
+    bool ShowBooksByTag(std::istream& cmd_input) const;
+    bool ImportCatalog(std::istream& cmd_input) const;
+    bool ExportCatalog(std::istream& cmd_input) const;
+    bool ShowStats() const;
 
     std::optional<detail::AddBookParams> GetBookParams(std::istream& cmd_input) const;
     std::optional<detail::AuthorInfo> SelectAuthorOrAddNew() const;
@@ -63,11 +79,11 @@ private:
     std::optional<detail::BookInfo> SelectBook(std::vector<detail::BookInfo> books) const;
     std::optional<detail::BookInfo> SelectBookByTitle(std::istream& cmd_input) const;
     std::vector<std::string> GetBookTags() const;
-    std::vector<detail::AuthorInfo> GetAuthors() const;
-    std::vector<detail::BookInfo> GetAllBooks() const;
+    std::vector<detail::AuthorInfo> GetAuthorsPage(const std::optional<detail::AuthorInfo>& after,
+                                                   size_t limit) const;
+    std::vector<detail::BookInfo> GetBooksPage(const std::optional<detail::BookInfo>& after, size_t limit) const;
     std::vector<detail::BookInfo> GetAuthorBooks(const detail::AuthorInfo& author_id) const;
-    std::vector<detail::BookInfo> GetBooksByTitle(const std::string& title) const;
-    std::vector<detail::BookInfo> BooksToInfo(const domain::Books& books) const;
+    std::vector<detail::BookInfo> SearchBooks(const std::string& query) const;
 
     std::string ReadNewTitle(const std::string& current_title) const;
     int ReadNewYear(int current_year) const;
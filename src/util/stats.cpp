@@ -0,0 +1,192 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+namespace util::stats {
+
+namespace {
+
+constexpr double QUANTILES[]{0.5, 0.99, 0.999};
+
+}  // namespace
+
+// Значения меньше SUB_BUCKET_COUNT попадают каждое в свою корзину, а у больших корзину задают
+// SUB_BUCKET_BITS старших битов после старшей единицы
+size_t Histogram::BucketOf(uint64_t value) noexcept {
+    if (value < SUB_BUCKET_COUNT) {
+        return value;
+    }
+    const int shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT);
+}
+
+uint64_t Histogram::HighestValueOf(size_t bucket) noexcept {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    const size_t shift = bucket / SUB_BUCKET_COUNT - 1;
+    const uint64_t lowest = (bucket % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << shift;
+    return lowest + ((uint64_t{1} << shift) - 1);
+}
+
+void Histogram::Record(uint64_t value) noexcept {
+    counts_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    for (uint64_t max = max_.load(std::memory_order_relaxed);
+         value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed);) {
+    }
+}
+
+// Счётчики читаются по одному, пока запись продолжается, поэтому число значений считается по ним самим
+Histogram::Snapshot Histogram::GetSnapshot() const {
+    Snapshot snapshot;
+    snapshot.counts.resize(BUCKET_COUNT);
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t Histogram::Snapshot::ValueAt(double quantile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(HighestValueOf(i), max);
+        }
+    }
+    return max;
+}
+
+void Operation::Record(std::chrono::nanoseconds duration, uint64_t rows, bool failed) noexcept {
+    latency_.Record(static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)));
+    rows_.fetch_add(rows, std::memory_order_relaxed);
+    if (failed) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+Operation::Snapshot Operation::GetSnapshot() const {
+    return {name_, latency_.GetSnapshot(), rows_.load(std::memory_order_relaxed),
+            errors_.load(std::memory_order_relaxed)};
+}
+
+Registry& Registry::Global() {
+    static Registry registry;
+    return registry;
+}
+
+Operation& Registry::Get(std::string_view name) {
+    std::lock_guard lock{mutex_};
+    auto it = operations_.find(name);
+    if (it == operations_.end()) {
+        it = operations_.emplace(std::string{name}, std::make_unique<Operation>(std::string{name})).first;
+    }
+    return *it->second;
+}
+
+std::vector<Operation::Snapshot> Registry::GetSnapshot() const {
+    std::lock_guard lock{mutex_};
+    std::vector<Operation::Snapshot> snapshot;
+    snapshot.reserve(operations_.size());
+    for (const auto& [name, operation] : operations_) {
+        snapshot.push_back(operation->GetSnapshot());
+    }
+    return snapshot;
+}
+
+void Registry::WritePrometheus(std::ostream& output) const {
+    const auto snapshot = GetSnapshot();
+    const auto flags = output.flags();
+    output << std::setprecision(9);
+
+    output << "# HELP bookypedia_operation_duration_seconds Duration of repository and use case calls.\n"
+              "# TYPE bookypedia_operation_duration_seconds summary\n";
+    for (const auto& operation : snapshot) {
+        const auto& latency = operation.latency;
+        for (const double quantile : QUANTILES) {
+            output << "bookypedia_operation_duration_seconds{operation=\"" << operation.name << "\",quantile=\""
+                   << quantile << "\"} " << latency.ValueAt(quantile) / 1e9 << '\n';
+        }
+        output << "bookypedia_operation_duration_seconds_sum{operation=\"" << operation.name << "\"} "
+               << latency.sum / 1e9 << '\n';
+        output << "bookypedia_operation_duration_seconds_count{operation=\"" << operation.name << "\"} "
+               << latency.count << '\n';
+    }
+
+    output << "# HELP bookypedia_operation_rows_total Rows returned by repository and use case calls.\n"
+              "# TYPE bookypedia_operation_rows_total counter\n";
+    for (const auto& operation : snapshot) {
+        output << "bookypedia_operation_rows_total{operation=\"" << operation.name << "\"} " << operation.rows
+               << '\n';
+    }
+
+    output << "# HELP bookypedia_operation_errors_total Repository and use case calls that threw an exception.\n"
+              "# TYPE bookypedia_operation_errors_total counter\n";
+    for (const auto& operation : snapshot) {
+        output << "bookypedia_operation_errors_total{operation=\"" << operation.name << "\"} " << operation.errors
+               << '\n';
+    }
+    output.flags(flags);
+}
+
+PrometheusFileWriter::PrometheusFileWriter(const Registry& registry, std::filesystem::path path,
+                                           std::chrono::milliseconds interval)
+    : registry_{registry}, path_{std::move(path)}, interval_{interval} {
+    if (interval_ <= std::chrono::milliseconds::zero()) {
+        throw std::invalid_argument("Statistics file interval must be positive");
+    }
+    thread_ = std::thread{[this] {
+        std::unique_lock lock{mutex_};
+        while (!stop_cv_.wait_for(lock, interval_, [this] {
+            return stop_;
+        })) {
+            // Ошибка записи не должна останавливать приложение: файл перезапишется через interval
+            try {
+                Write();
+            } catch (const std::exception&) {
+            }
+        }
+    }};
+}
+
+PrometheusFileWriter::~PrometheusFileWriter() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+    try {
+        Write();
+    } catch (const std::exception&) {
+    }
+}
+
+void PrometheusFileWriter::Write() const {
+    auto temp_path = path_;
+    temp_path += ".tmp";
+    {
+        std::ofstream output{temp_path, std::ios::trunc};
+        registry_.WritePrometheus(output);
+        if (!output.flush()) {
+            throw std::runtime_error("Can't write " + temp_path.string());
+        }
+    }
+    std::filesystem::rename(temp_path, path_);
+}
+
+}  // namespace util::stats
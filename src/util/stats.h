@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace util::stats {
+
+// Собрана ли программа с замерами операций (флаг BOOKYPEDIA_STATS). Без него макросы ниже ничего не делают
+#ifdef BOOKYPEDIA_STATS
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+// Гистограмма значений в духе HdrHistogram: каждая степень двойки делится на SUB_BUCKET_COUNT равных корзин,
+// поэтому квантили вычисляются с относительной погрешностью не больше 1 / SUB_BUCKET_COUNT.
+// Запись — несколько атомарных сложений без блокировок; чтение снимает счётчики без остановки записи
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKET_COUNT = size_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        // Значение, которого не превышает доля quantile записанных значений, с точностью до корзины
+        uint64_t ValueAt(double quantile) const;
+    };
+
+    void Record(uint64_t value) noexcept;
+    Snapshot GetSnapshot() const;
+
+    static size_t BucketOf(uint64_t value) noexcept;
+    // Наибольшее значение, попадающее в корзину
+    static uint64_t HighestValueOf(size_t bucket) noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_{};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Замеры одной операции: длительности вызовов в наносекундах, число выданных строк и вызовов с исключением
+class Operation {
+public:
+    explicit Operation(std::string name) : name_{std::move(name)} {}
+
+    void Record(std::chrono::nanoseconds duration, uint64_t rows, bool failed) noexcept;
+
+    const std::string& GetName() const noexcept {
+        return name_;
+    }
+
+    struct Snapshot {
+        std::string name;
+        Histogram::Snapshot latency;
+        uint64_t rows = 0;
+        uint64_t errors = 0;
+    };
+
+    Snapshot GetSnapshot() const;
+
+private:
+    std::string name_;
+    Histogram latency_;
+    std::atomic<uint64_t> rows_{0};
+    std::atomic<uint64_t> errors_{0};
+};
+
+// Операции по именам. Операция создаётся при первом обращении и живёт, пока жив реестр,
+// поэтому место вызова находит её один раз и дальше пишет в неё без блокировок
+class Registry {
+public:
+    // Реестр, в который пишут макросы замеров
+    static Registry& Global();
+
+    Operation& Get(std::string_view name);
+    // Замеры всех операций в порядке имён
+    std::vector<Operation::Snapshot> GetSnapshot() const;
+    // Замеры в текстовом формате Prometheus: квантили длительностей в секундах, счётчики строк и ошибок
+    void WritePrometheus(std::ostream& output) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<Operation>, std::less<>> operations_;
+};
+
+// Число строк в результате операции: размер контейнера, наличие значения, число или 0 для остальных типов
+template <typename Result>
+uint64_t RowsOf(const Result& result) {
+    if constexpr (requires { result.size(); }) {
+        return result.size();
+    } else if constexpr (requires { result.has_value(); }) {
+        return result.has_value() ? 1 : 0;
+    } else if constexpr (std::integral<Result>) {
+        return static_cast<uint64_t>(result);
+    } else {
+        return 0;
+    }
+}
+
+// Замеряет время от создания до разрушения и записывает его в операцию. Вызов, из которого
+// вылетело исключение, считается ошибкой
+class Timer {
+public:
+    explicit Timer(Operation& operation) noexcept
+        : operation_{operation}, start_{std::chrono::steady_clock::now()},
+          uncaught_exceptions_{std::uncaught_exceptions()} {}
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    ~Timer() {
+        operation_.Record(std::chrono::steady_clock::now() - start_, rows_,
+                          std::uncaught_exceptions() > uncaught_exceptions_);
+    }
+
+    // Запоминает число строк результата и возвращает его дальше
+    template <typename Result>
+    Result CountRows(Result result) {
+        rows_ = RowsOf(result);
+        return result;
+    }
+
+    // Запоминает число строк результата, который вернётся из локальной переменной
+    template <typename Result>
+    void RecordRows(const Result& result) {
+        rows_ = RowsOf(result);
+    }
+
+private:
+    Operation& operation_;
+    std::chrono::steady_clock::time_point start_;
+    int uncaught_exceptions_;
+    uint64_t rows_ = 0;
+};
+
+// Раз в interval перезаписывает файл замерами в формате Prometheus, например для textfile collector
+// из node_exporter. Файл заменяется переименованием, поэтому читатель не видит его наполовину записанным.
+// Последний раз файл записывается при разрушении
+class PrometheusFileWriter {
+public:
+    PrometheusFileWriter(const Registry& registry, std::filesystem::path path, std::chrono::milliseconds interval);
+    PrometheusFileWriter(const PrometheusFileWriter&) = delete;
+    PrometheusFileWriter& operator=(const PrometheusFileWriter&) = delete;
+    ~PrometheusFileWriter();
+
+    void Write() const;
+
+private:
+    const Registry& registry_;
+    std::filesystem::path path_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+}  // namespace util::stats
+
+// Замеряет вызов до конца блока как операцию name и даёт BOOKYPEDIA_COUNT_ROWS запомнить размер результата:
+//  BOOKYPEDIA_TIME_OPERATION("BookRepository.GetAllBooks");
+//  return BOOKYPEDIA_COUNT_ROWS(LoadBooks());
+// Локальную переменную отмечает BOOKYPEDIA_RECORD_ROWS(books) перед return, чтобы она вернулась без копирования.
+// Без BOOKYPEDIA_STATS макросы не порождают кода, а BOOKYPEDIA_COUNT_ROWS(result) — это просто result
+#ifdef BOOKYPEDIA_STATS
+#define BOOKYPEDIA_TIME_OPERATION(name)                                                                        \
+    static ::util::stats::Operation& bookypedia_stats_operation = ::util::stats::Registry::Global().Get(name); \
+    ::util::stats::Timer bookypedia_stats_timer{bookypedia_stats_operation}
+#define BOOKYPEDIA_COUNT_ROWS(result) bookypedia_stats_timer.CountRows(result)
+#define BOOKYPEDIA_RECORD_ROWS(result) bookypedia_stats_timer.RecordRows(result)
+#else
+#define BOOKYPEDIA_TIME_OPERATION(name) static_cast<void>(0)
+#define BOOKYPEDIA_COUNT_ROWS(result) (result)
+#define BOOKYPEDIA_RECORD_ROWS(result) static_cast<void>(0)
+#endif
@@ -1,23 +1,221 @@
 #include "tagged_uuid.h"
 
-#include <boost/uuid/random_generator.hpp>
-#include <boost/uuid/string_generator.hpp>
-#include <boost/uuid/uuid_io.hpp>
+#include <sys/random.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 
 namespace util {
 namespace detail {
 
+namespace {
+
+// Смещения шестнадцатеричных цифр каждого байта в каноническом представлении 8-4-4-4-12
+constexpr std::array<uint8_t, 16> BYTE_OFFSETS{0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34};
+constexpr std::array<uint8_t, 4> DASH_OFFSETS{8, 13, 18, 23};
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+// Значение шестнадцатеричной цифры в любом регистре; у остальных символов установлены старшие биты
+constexpr std::array<uint8_t, 256> HEX_VALUES = [] {
+    std::array<uint8_t, 256> values{};
+    for (auto& value : values) {
+        value = 0xFF;
+    }
+    for (int i = 0; i < 10; ++i) {
+        values['0' + i] = static_cast<uint8_t>(i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        values['a' + i] = static_cast<uint8_t>(10 + i);
+        values['A' + i] = static_cast<uint8_t>(10 + i);
+    }
+    return values;
+}();
+
+// Случайные числа потока из криптографического генератора ОС (getrandom), чтобы по выданным идентификаторам
+// нельзя было угадать следующие. Числа запрашиваются пачкой на сотни UUID, поэтому системный вызов
+// редок, а синхронизация между потоками не нужна
+class RandomWords {
+public:
+    uint64_t operator()() {
+        if (next_ == words_.size()) {
+            Refill();
+        }
+        return words_[next_++];
+    }
+
+private:
+    void Refill() {
+        auto* data = reinterpret_cast<char*>(words_.data());
+        size_t filled = 0;
+        while (filled < sizeof(words_)) {
+            const auto result = ::getrandom(data + filled, sizeof(words_) - filled, 0);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "Can't get random bytes");
+            }
+            filled += static_cast<size_t>(result);
+        }
+        next_ = 0;
+    }
+
+    std::array<uint64_t, 512> words_;
+    size_t next_ = words_.size();
+};
+
+RandomWords& ThreadGenerator() {
+    thread_local RandomWords generator;
+    return generator;
+}
+
+// Случайный UUID версии 4 (RFC 4122)
+UUIDType NewRandomUUID(RandomWords& generator) {
+    const uint64_t words[2]{generator(), generator()};
+    UUIDType uuid;
+    std::memcpy(uuid.data, words, sizeof(words));
+    uuid.data[6] = static_cast<uint8_t>((uuid.data[6] & 0x0F) | 0x40);
+    uuid.data[8] = static_cast<uint8_t>((uuid.data[8] & 0x3F) | 0x80);
+    return uuid;
+}
+
+// Состояние генератора версии 7 в потоке: последняя выданная миллисекунда и счётчик внутри неё
+struct TimeOrderedState {
+    uint64_t last_ms = 0;
+    uint16_t counter = 0;
+};
+
+constexpr uint16_t COUNTER_MASK = 0x0FFF;
+
+// Поля версии 7: 48 бит времени, версия, 12 бит счётчика (rand_a), вариант, 62 случайных бита (rand_b).
+// Счётчик начинается со случайного значения в младшей половине диапазона, чтобы ему было куда расти;
+// при переполнении время сдвигается на миллисекунду вперёд, и порядок сохраняется
+UUIDType NewTimeOrderedUUID(RandomWords& generator, TimeOrderedState& state) {
+    const auto now_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                  std::chrono::system_clock::now().time_since_epoch())
+                                                  .count());
+    if (now_ms > state.last_ms) {
+        state.last_ms = now_ms;
+        state.counter = static_cast<uint16_t>(generator() >> 53);
+    } else if (++state.counter > COUNTER_MASK) {
+        ++state.last_ms;
+        state.counter = 0;
+    }
+
+    UUIDType uuid;
+    for (int i = 0; i < 6; ++i) {
+        uuid.data[i] = static_cast<uint8_t>(state.last_ms >> (40 - 8 * i));
+    }
+    uuid.data[6] = static_cast<uint8_t>(0x70 | (state.counter >> 8));
+    uuid.data[7] = static_cast<uint8_t>(state.counter);
+    const uint64_t random = generator();
+    std::memcpy(uuid.data + 8, &random, 8);
+    uuid.data[8] = static_cast<uint8_t>((uuid.data[8] & 0x3F) | 0x80);
+    return uuid;
+}
+
+TimeOrderedState& ThreadTimeOrderedState() {
+    thread_local TimeOrderedState state;
+    return state;
+}
+
+}  // namespace
+
 UUIDType NewUUID() {
-    return boost::uuids::random_generator()();
+    return NewRandomUUID(ThreadGenerator());
+}
+
+std::vector<UUIDType> NewUUIDs(size_t count) {
+    auto& generator = ThreadGenerator();
+    std::vector<UUIDType> uuids;
+    uuids.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        uuids.push_back(NewRandomUUID(generator));
+    }
+    return uuids;
+}
+
+void UUIDToChars(const UUIDType& uuid, char* out) noexcept {
+    char hex[32];
+#if defined(__SSSE3__)
+    // Полубайты раскладываются по порядку и переводятся в цифры одной перестановкой по таблице
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uuid.data));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    const __m128i low = _mm_and_si128(bytes, mask);
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HEX_DIGITS));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hex), _mm_shuffle_epi8(digits, _mm_unpacklo_epi8(high, low)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 16), _mm_shuffle_epi8(digits, _mm_unpackhi_epi8(high, low)));
+#else
+    for (size_t i = 0; i < 16; ++i) {
+        hex[2 * i] = HEX_DIGITS[uuid.data[i] >> 4];
+        hex[2 * i + 1] = HEX_DIGITS[uuid.data[i] & 0x0F];
+    }
+#endif
+    std::memcpy(out, hex, 8);
+    std::memcpy(out + 9, hex + 8, 4);
+    std::memcpy(out + 14, hex + 12, 4);
+    std::memcpy(out + 19, hex + 16, 4);
+    std::memcpy(out + 24, hex + 20, 12);
+    for (auto offset : DASH_OFFSETS) {
+        out[offset] = '-';
+    }
+}
+
+UUIDType NewTimeOrderedUUID() {
+    return NewTimeOrderedUUID(ThreadGenerator(), ThreadTimeOrderedState());
+}
+
+std::vector<UUIDType> NewTimeOrderedUUIDs(size_t count) {
+    auto& generator = ThreadGenerator();
+    auto& state = ThreadTimeOrderedState();
+    std::vector<UUIDType> uuids;
+    uuids.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        uuids.push_back(NewTimeOrderedUUID(generator, state));
+    }
+    return uuids;
 }
 
 std::string UUIDToString(const UUIDType& uuid) {
-    return to_string(uuid);
+    std::string result(UUID_TEXT_SIZE, '\0');
+    UUIDToChars(uuid, result.data());
+    return result;
 }
 
 UUIDType UUIDFromString(std::string_view str) {
-    boost::uuids::string_generator gen;
-    return gen(str.begin(), str.end());
+    if (str.size() != UUID_TEXT_SIZE) {
+        throw std::invalid_argument("Invalid UUID length: " + std::string{str});
+    }
+
+    // Ошибки копятся в битах, проверка одна на всю строку
+    UUIDType uuid;
+    uint8_t invalid = 0;
+    for (size_t i = 0; i < 16; ++i) {
+        const uint8_t high = HEX_VALUES[static_cast<uint8_t>(str[BYTE_OFFSETS[i]])];
+        const uint8_t low = HEX_VALUES[static_cast<uint8_t>(str[BYTE_OFFSETS[i] + 1])];
+        invalid |= (high | low) & 0xF0;
+        uuid.data[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    for (auto offset : DASH_OFFSETS) {
+        invalid |= static_cast<uint8_t>(str[offset] ^ '-');
+    }
+
+    if (invalid) {
+        throw std::invalid_argument("Invalid UUID: " + std::string{str});
+    }
+    return uuid;
 }
 
 }  // namespace detail
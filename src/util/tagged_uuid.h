@@ -2,21 +2,52 @@
 #include <boost/uuid/nil_generator.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "tagged.h"
 
 namespace util {
 
+// Как порождаются новые идентификаторы: случайно (версия 4) или по времени создания (версия 7).
+// Идентификаторы версии 7 растут со временем, и вставки в индекс первичного ключа идут в его конец.
+// Формат хранения у обеих версий один, поэтому они уживаются в одной таблице
+enum class UUIDVersion { Random, TimeOrdered };
+
 namespace detail {
 
 using UUIDType = boost::uuids::uuid;
 
+// Случайные UUID версии 4 из генератора текущего потока; безопасны при вызове из разных потоков
 UUIDType NewUUID();
+std::vector<UUIDType> NewUUIDs(size_t count);
+// UUID версии 7 (RFC 9562): миллисекунды Unix-времени и случайные биты.
+// В пределах потока идентификаторы строго возрастают, даже если выданы в одну миллисекунду
+UUIDType NewTimeOrderedUUID();
+std::vector<UUIDType> NewTimeOrderedUUIDs(size_t count);
 constexpr UUIDType ZeroUUID{{0}};
 
+// Длина канонического представления 8-4-4-4-12
+constexpr size_t UUID_TEXT_SIZE = 36;
+
+// Записывает в out ровно UUID_TEXT_SIZE символов в нижнем регистре, без завершающего нуля
+void UUIDToChars(const UUIDType& uuid, char* out) noexcept;
 std::string UUIDToString(const UUIDType& uuid);
+// Принимает только каноническое представление (цифры в любом регистре), иначе бросает std::invalid_argument
 UUIDType UUIDFromString(std::string_view str);
 
+// Версия новых идентификаторов задаётся меткой типа:
+//  struct BookTag { static constexpr auto UUID_VERSION = util::UUIDVersion::TimeOrdered; };
+// Без UUID_VERSION идентификаторы случайные
+template <typename Tag>
+constexpr UUIDVersion UUIDVersionOf() {
+    if constexpr (requires { Tag::UUID_VERSION; }) {
+        return Tag::UUID_VERSION;
+    } else {
+        return UUIDVersion::Random;
+    }
+}
+
 }  // namespace detail
 
 template <typename Tag>
@@ -29,11 +60,23 @@ public:
         : Base{detail::ZeroUUID} {
     }
 
+    static constexpr UUIDVersion VERSION = detail::UUIDVersionOf<Tag>();
+
     static TaggedUUID New() {
-        return TaggedUUID{detail::NewUUID()};
+        if constexpr (VERSION == UUIDVersion::TimeOrdered) {
+            return TaggedUUID{detail::NewTimeOrderedUUID()};
+        } else {
+            return TaggedUUID{detail::NewUUID()};
+        }
+    }
+
+    // Пакет новых идентификаторов для массовой вставки
+    static std::vector<TaggedUUID> New(size_t count) {
+        auto uuids = VERSION == UUIDVersion::TimeOrdered ? detail::NewTimeOrderedUUIDs(count) : detail::NewUUIDs(count);
+        return {uuids.begin(), uuids.end()};
     }
 
-    static TaggedUUID FromString(const std::string& uuid_as_text) {
+    static TaggedUUID FromString(std::string_view uuid_as_text) {
         return TaggedUUID{detail::UUIDFromString(uuid_as_text)};
     }
 
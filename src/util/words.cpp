@@ -0,0 +1,84 @@
+#include "words.h"
+
+#include <cctype>
+#include <cstdint>
+
+namespace util {
+
+namespace {
+
+bool IsWordByte(unsigned char byte) {
+    return byte >= 0x80 || std::isalnum(byte) || byte == '_';
+}
+
+// Начинается ли word с prefix без учёта регистра латиницы; prefix уже в нижнем регистре
+bool StartsWithLower(std::string_view word, std::string_view prefix) {
+    if (word.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(word[i])) != static_cast<unsigned char>(prefix[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+std::vector<std::string> SplitWords(std::string_view text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (const char c : text) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (IsWordByte(byte)) {
+            word.push_back(static_cast<char>(std::tolower(byte)));
+        } else if (!word.empty()) {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+bool StartsWords(std::string_view text, const std::vector<std::string>& prefixes) {
+    if (prefixes.size() > 64) {
+        const auto words = SplitWords(text);
+        for (const auto& prefix : prefixes) {
+            bool found = false;
+            for (const auto& word : words) {
+                found = found || word.starts_with(prefix);
+            }
+            if (!found) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const uint64_t all = prefixes.size() == 64 ? ~uint64_t{0} : (uint64_t{1} << prefixes.size()) - 1;
+    uint64_t matched = 0;
+    size_t end = 0;
+    while (matched != all && end < text.size()) {
+        size_t begin = end;
+        while (begin < text.size() && !IsWordByte(static_cast<unsigned char>(text[begin]))) {
+            ++begin;
+        }
+        end = begin;
+        while (end < text.size() && IsWordByte(static_cast<unsigned char>(text[end]))) {
+            ++end;
+        }
+        const auto word = text.substr(begin, end - begin);
+        for (size_t i = 0; i < prefixes.size() && !word.empty(); ++i) {
+            if (StartsWithLower(word, prefixes[i])) {
+                matched |= uint64_t{1} << i;
+            }
+        }
+    }
+    return matched == all;
+}
+
+}  // namespace util
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace util {
+
+// Слова в нижнем регистре, как их выделяет поиск в Postgres: разделители — всё, кроме букв, цифр и '_'.
+// Байты многобайтовых символов UTF-8 считаются буквами, но регистр меняется только у латиницы
+std::vector<std::string> SplitWords(std::string_view text);
+// Начинается ли с каждого из prefixes, выделенных SplitWords, какое-нибудь слово text.
+// Проверяет текст на месте, не копируя его слова
+bool StartsWords(std::string_view text, const std::vector<std::string>& prefixes);
+
+}  // namespace util
@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+
+#include "../src/ui/catalog_import.h"
+
+using namespace std::literals;
+using ui::detail::CatalogFormat;
+
+TEST_CASE("Catalog format is chosen by file extension") {
+    CHECK(ui::detail::GetCatalogFormat("books.csv"sv) == CatalogFormat::Csv);
+    CHECK(ui::detail::GetCatalogFormat("/data/Books.JSONL"sv) == CatalogFormat::JsonLines);
+    CHECK_FALSE(ui::detail::GetCatalogFormat("books.json"sv));
+}
+
+TEST_CASE("CSV records are normalized like manual input") {
+    const auto columns = ui::detail::ParseCsvHeader(" Year ,title,Author,tags\r"sv);
+
+    const auto book = ui::detail::ParseCsvRecord(
+        R"(1906, White Fang ,"London, Jack"," sled  dogs,Adventure,,adventure")"sv, columns);
+    CHECK(book.title == "White Fang");
+    CHECK(book.author_name == "London, Jack");
+    CHECK(book.publication_year == 1906);
+    CHECK(book.tags == domain::Tags{"Adventure", "adventure", "sled dogs"});
+
+    const auto quoted = ui::detail::ParseCsvRecord(R"(2000,"The ""Quoted"" Book",Author,)"sv, columns);
+    CHECK(quoted.title == R"(The "Quoted" Book)");
+    CHECK(quoted.tags.empty());
+}
+
+TEST_CASE("Invalid CSV input is rejected") {
+    CHECK_THROWS_AS(ui::detail::ParseCsvHeader("title,tags"sv), std::invalid_argument);
+
+    const auto columns = ui::detail::ParseCsvHeader("title,author,year"sv);
+    CHECK_THROWS_AS(ui::detail::ParseCsvRecord("Title,Author"sv, columns), std::invalid_argument);
+    CHECK_THROWS_AS(ui::detail::ParseCsvRecord("Title,Author,19x6"sv, columns), std::invalid_argument);
+    CHECK_THROWS_AS(ui::detail::ParseCsvRecord(" ,Author,1906"sv, columns), std::invalid_argument);
+    CHECK_THROWS_AS(ui::detail::ParseCsvRecord(R"("Title,Author,1906)"sv, columns), std::invalid_argument);
+}
+
+TEST_CASE("JSON Lines records accept tags as an array or a string") {
+    const auto book = ui::detail::ParseJsonRecord(
+        R"({"title": " Solaris", "author": "Stanislaw Lem", "year": 1961, "tags": ["Sci-fi", " sci-fi ", "Sci-fi"]})");
+    CHECK(book.title == "Solaris");
+    CHECK(book.author_name == "Stanislaw Lem");
+    CHECK(book.publication_year == 1961);
+    CHECK(book.tags == domain::Tags{"Sci-fi", "sci-fi"});
+
+    const auto tags_string = ui::detail::ParseJsonRecord(R"({"title": "Eden", "author": "Lem", "year": "1959",
+        "tags": "Sci-fi, Space"})");
+    CHECK(tags_string.tags == domain::Tags{"Sci-fi", "Space"});
+
+    CHECK(ui::detail::ParseJsonRecord(R"({"title": "Eden", "author": "Lem", "year": 1959})").tags.empty());
+}
+
+TEST_CASE("Invalid JSON Lines records are rejected") {
+    CHECK_THROWS_AS(ui::detail::ParseJsonRecord(R"({"title": "Eden", "author": "Lem")"), std::invalid_argument);
+    CHECK_THROWS_AS(ui::detail::ParseJsonRecord(R"({"title": "Eden", "year": 1959})"), std::invalid_argument);
+    CHECK_THROWS_AS(ui::detail::ParseJsonRecord(R"({"title": "Eden", "author": "Lem", "year": 1959.5})"),
+                    std::invalid_argument);
+}
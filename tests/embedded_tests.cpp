@@ -0,0 +1,300 @@
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/embedded/embedded.h"
+#include "../src/memory/memory.h"
+
+#include "helpers.h"
+
+using helpers::NamesOf;
+using helpers::TitlesOf;
+using namespace std::literals;
+
+namespace {
+
+// Каталог для файлов базы, удаляемый после теста
+class TempDirectory {
+public:
+    TempDirectory()
+        : path_{std::filesystem::temp_directory_path() / ("bookypedia-" + std::to_string(std::random_device{}()))} {
+        std::filesystem::remove_all(path_);
+    }
+
+    ~TempDirectory() {
+        std::filesystem::remove_all(path_);
+    }
+
+    const std::filesystem::path& GetPath() const noexcept {
+        return path_;
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+void AddLondon(app::UnitOfWorkFactory& database, const domain::AuthorId& author_id) {
+    auto uow = database.GetUnitOfWork();
+    uow->Authors().Save({author_id, "Jack London"});
+    uow->Books().AddBooks({
+        {domain::BookId::New(), author_id, "White Fang", 1906, {"novel", "dogs"}},
+        {domain::BookId::New(), author_id, "The Call of the Wild", 1903, {"dogs"}},
+    });
+    uow->Commit();
+}
+
+}  // namespace
+
+TEST_CASE("Embedded catalog survives reopening with and without compaction") {
+    TempDirectory directory;
+    const auto author_id = domain::AuthorId::New();
+
+    for (const bool compact_on_close : {true, false}) {
+        std::filesystem::remove_all(directory.GetPath());
+        {
+            embedded::Database database{{directory.GetPath(), 10'000, compact_on_close}};
+            AddLondon(database, author_id);
+            auto uow = database.GetUnitOfWork();
+            uow->Authors().Save({domain::AuthorId::New(), "Mark Twain"});
+        }
+        // Без уплотнения при закрытии изменения читаются из журнала
+        CHECK((std::filesystem::file_size(directory.GetPath() / "catalog.log") == 0) == compact_on_close);
+
+        embedded::Database database{{directory.GetPath()}};
+        auto uow = database.GetReadOnlyUnitOfWork();
+        CHECK(NamesOf(uow->Authors().GetAllAuthors()) == std::vector{"Jack London"s});
+        CHECK(TitlesOf(uow->Books().GetAllBooks()) == std::vector{"The Call of the Wild"s, "White Fang"s});
+        CHECK(uow->Authors().FindAuthorById(author_id)->GetName() == "Jack London");
+        CHECK(uow->Books().GetAllBooks().front().GetAuthorName() == "Jack London");
+    }
+}
+
+TEST_CASE("Embedded rollback restores rows stored in the segment") {
+    TempDirectory directory;
+    embedded::Database database{{directory.GetPath()}};
+    const auto author_id = domain::AuthorId::New();
+    AddLondon(database, author_id);
+    database.Compact();
+
+    {
+        auto uow = database.GetUnitOfWork();
+        uow->Authors().Edit(author_id, "John Griffith London");
+        uow->Authors().Delete(author_id);
+        CHECK(uow->Books().GetAllBooks().empty());
+        CHECK(uow->Authors().GetAllAuthors().empty());
+    }
+
+    auto uow = database.GetReadOnlyUnitOfWork();
+    CHECK(NamesOf(uow->Authors().GetAllAuthors()) == std::vector{"Jack London"s});
+    CHECK(TitlesOf(uow->Books().GetBooksByTags({"dogs", "novel"}, domain::TagMatch::All, std::nullopt, 10)) ==
+          std::vector{"White Fang"s});
+}
+
+TEST_CASE("Embedded reads over the segment and changes follow the in-memory catalog") {
+    TempDirectory directory;
+    embedded::Database database{{directory.GetPath()}};
+    memory::Database reference;
+
+    // Одни и те же изменения до и после уплотнения: часть строк читается из сегмента, часть — из изменений
+    std::vector<domain::AuthorId> authors;
+    std::vector<domain::BookId> books;
+    std::mt19937 random{42};
+    auto apply = [&](app::UnitOfWorkFactory& factory, int step) {
+        auto uow = factory.GetUnitOfWork();
+        auto& author_id = authors[step % authors.size()];
+        const auto title = "Book "s + std::to_string(step % 7) + (step % 3 ? " of dogs" : " of wolves");
+        const domain::Tags tags{step % 2 ? "novel"s : "story"s, step % 5 ? "dogs"s : "wolves"s};
+        if (step % 11 == 0) {
+            uow->Books().DeleteBook(books[step % books.size()]);
+        } else if (step % 4 == 0) {
+            uow->Books().EditBook(books[step % books.size()], title, 1900 + step % 9, tags);
+        } else if (step % 13 == 0) {
+            uow->Authors().Edit(author_id, "Renamed " + std::to_string(step));
+        } else {
+            uow->Books().Save({books[step], author_id, title, 1900 + step % 9, tags});
+        }
+        uow->Commit();
+    };
+    for (int i = 0; i < 5; ++i) {
+        authors.push_back(domain::AuthorId::New());
+        for (auto* factory : std::initializer_list<app::UnitOfWorkFactory*>{&database, &reference}) {
+            auto uow = factory->GetUnitOfWork();
+            uow->Authors().Save({authors.back(), "Author " + std::to_string(i)});
+            uow->Commit();
+        }
+    }
+    for (int i = 0; i < 200; ++i) {
+        books.push_back(domain::BookId::New());
+    }
+    std::vector<int> steps(200);
+    for (int i = 0; i < 200; ++i) {
+        steps[i] = i;
+    }
+    std::shuffle(steps.begin() + 1, steps.end(), random);
+    for (size_t i = 0; i < steps.size(); ++i) {
+        apply(database, steps[i]);
+        apply(reference, steps[i]);
+        if (i == steps.size() / 2) {
+            database.Compact();
+        }
+    }
+
+    auto actual = database.GetReadOnlyUnitOfWork();
+    auto expected = reference.GetReadOnlyUnitOfWork();
+    auto same_books = [](const domain::Books& lhs, const domain::Books& rhs) {
+        return lhs.size() == rhs.size() &&
+               std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const domain::Book& left, const domain::Book& right) {
+                   return left.GetBookId() == right.GetBookId() && left.GetAuthorName() == right.GetAuthorName() &&
+                          left.GetTags() == right.GetTags() && left.GetTitle() == right.GetTitle();
+               });
+    };
+
+    CHECK(NamesOf(actual->Authors().GetAllAuthors()) == NamesOf(expected->Authors().GetAllAuthors()));
+    CHECK(same_books(actual->Books().GetAllBooks(), expected->Books().GetAllBooks()));
+    CHECK(same_books(actual->Books().GetBooksByAuthorId(authors[1]), expected->Books().GetBooksByAuthorId(authors[1])));
+    CHECK(same_books(actual->Books().GetBooksByTitle("Book 3 of dogs"),
+                     expected->Books().GetBooksByTitle("Book 3 of dogs")));
+    CHECK(same_books(actual->Books().SearchBooks("book dog", 1000), expected->Books().SearchBooks("book dog", 1000)));
+    CHECK(same_books(actual->Books().SearchBooks("renamed", 1000), expected->Books().SearchBooks("renamed", 1000)));
+
+    std::optional<domain::BooksPageKey> after;
+    for (int page = 0; page < 5; ++page) {
+        for (const auto match : {domain::TagMatch::All, domain::TagMatch::Any}) {
+            const domain::Tags tags{"dogs", "novel"};
+            const auto books_page = actual->Books().GetBooksByTags(tags, match, after, 7);
+            REQUIRE(same_books(books_page, expected->Books().GetBooksByTags(tags, match, after, 7)));
+            if (match == domain::TagMatch::Any && !books_page.empty()) {
+                after = domain::BooksPageKey{books_page.back().GetTitle(), books_page.back().GetBookId()};
+            }
+        }
+    }
+}
+
+TEST_CASE("Concurrent embedded commits share log syncs") {
+    TempDirectory directory;
+    embedded::Database database{{directory.GetPath()}};
+    app::UseCasesImpl use_cases{database};
+
+    constexpr int THREAD_COUNT = 8;
+    constexpr int COMMIT_COUNT = 50;
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < THREAD_COUNT; ++thread) {
+        threads.emplace_back([&use_cases, thread] {
+            for (int i = 0; i < COMMIT_COUNT; ++i) {
+                use_cases.AddAuthor("Author " + std::to_string(thread) + "-" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(use_cases.GetAllAuthors().size() == THREAD_COUNT * COMMIT_COUNT);
+    CHECK(database.GetSyncCount() > 0);
+    CHECK(database.GetSyncCount() <= THREAD_COUNT * COMMIT_COUNT);
+}
+
+TEST_CASE("Background embedded compaction keeps commits made while it runs") {
+    constexpr int THREAD_COUNT = 4;
+    constexpr int COMMIT_COUNT = 100;
+    auto add_authors = [](app::UnitOfWorkFactory& database) {
+        app::UseCasesImpl use_cases{database};
+        std::vector<std::thread> threads;
+        for (int thread = 0; thread < THREAD_COUNT; ++thread) {
+            threads.emplace_back([&use_cases, thread] {
+                for (int i = 0; i < COMMIT_COUNT; ++i) {
+                    use_cases.AddAuthor("Author " + std::to_string(thread) + "-" + std::to_string(i));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    // Фоновые уплотнения идут вперемешку с фиксациями; при закрытии база не уплотняется
+    TempDirectory directory;
+    {
+        embedded::Database database{{directory.GetPath(), 20, false}};
+        add_authors(database);
+    }
+    TempDirectory uncompacted;
+    {
+        embedded::Database database{{uncompacted.GetPath(), 10'000, false}};
+        add_authors(database);
+    }
+    // Перенесённые в сегмент записи убраны из журнала
+    CHECK(std::filesystem::file_size(directory.GetPath() / "catalog.log") <
+          std::filesystem::file_size(uncompacted.GetPath() / "catalog.log"));
+
+    embedded::Database database{{directory.GetPath()}};
+    embedded::Database expected{{uncompacted.GetPath()}};
+    CHECK(NamesOf(database.GetReadOnlyUnitOfWork()->Authors().GetAllAuthors()) ==
+          NamesOf(expected.GetReadOnlyUnitOfWork()->Authors().GetAllAuthors()));
+    CHECK(database.GetReadOnlyUnitOfWork()->Authors().GetAllAuthors().size() == THREAD_COUNT * COMMIT_COUNT);
+}
+
+TEST_CASE("Embedded catalog ignores a torn log tail") {
+    TempDirectory directory;
+    const auto author_id = domain::AuthorId::New();
+    {
+        embedded::Database database{{directory.GetPath(), 10'000, false}};
+        AddLondon(database, author_id);
+    }
+    {
+        std::ofstream log{directory.GetPath() / "catalog.log", std::ios::app | std::ios::binary};
+        log << "\x30\x00\x00\x00garbage"sv;
+    }
+
+    {
+        embedded::Database database{{directory.GetPath(), 10'000, false}};
+        CHECK(database.GetReadOnlyUnitOfWork()->Books().GetBooksByAuthorId(author_id).size() == 2);
+        auto uow = database.GetUnitOfWork();
+        uow->Authors().Save({domain::AuthorId::New(), "Mark Twain"});
+        uow->Commit();
+    }
+
+    // Хвост обрезан при открытии, поэтому следующая запись читается после прежних
+    embedded::Database database{{directory.GetPath()}};
+    CHECK(NamesOf(database.GetReadOnlyUnitOfWork()->Authors().GetAllAuthors()) ==
+          std::vector{"Jack London"s, "Mark Twain"s});
+}
+
+TEST_CASE("Embedded commit cut short by a failed write keeps the log readable") {
+    TempDirectory directory;
+    const auto log_path = directory.GetPath() / "catalog.log";
+    {
+        embedded::Database database{{directory.GetPath(), 10'000, false}};
+        app::UseCasesImpl use_cases{database};
+        use_cases.AddAuthor("Jack London");
+
+        // Файлу позволено вырасти лишь на несколько байт, поэтому запись обрывается посередине
+        const auto log_size = std::filesystem::file_size(log_path);
+        rlimit limit{};
+        REQUIRE(::getrlimit(RLIMIT_FSIZE, &limit) == 0);
+        auto small_limit = limit;
+        small_limit.rlim_cur = log_size + 10;
+        const auto previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+        REQUIRE(::setrlimit(RLIMIT_FSIZE, &small_limit) == 0);
+        CHECK_THROWS(use_cases.AddAuthor("Mark Twain"));
+        REQUIRE(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+        std::signal(SIGXFSZ, previous_handler);
+
+        CHECK(std::filesystem::file_size(log_path) == log_size);
+        use_cases.AddAuthor("Leo Tolstoy");
+    }
+
+    embedded::Database database{{directory.GetPath()}};
+    CHECK(NamesOf(database.GetReadOnlyUnitOfWork()->Authors().GetAllAuthors()) ==
+          std::vector{"Jack London"s, "Leo Tolstoy"s});
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../src/domain/author.h"
+#include "../src/domain/book.h"
+
+// Вспомогательные функции проверок, общие для тестов хранилищ и сценариев
+namespace helpers {
+
+// Названия книг в порядке выдачи
+inline std::vector<std::string> TitlesOf(const domain::Books& books) {
+    std::vector<std::string> titles;
+    titles.reserve(books.size());
+    for (const auto& book : books) {
+        titles.push_back(book.GetTitle());
+    }
+    return titles;
+}
+
+// Имена авторов в порядке выдачи
+inline std::vector<std::string> NamesOf(const domain::Authors& authors) {
+    std::vector<std::string> names;
+    names.reserve(authors.size());
+    for (const auto& author : authors) {
+        names.push_back(author.GetName());
+    }
+    return names;
+}
+
+}  // namespace helpers
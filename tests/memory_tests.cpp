@@ -0,0 +1,239 @@
+#include <catch2/catch_test_macros.hpp>
+#include <future>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/app/grouped_unit_of_work.h"
+#include "../src/app/use_cases_impl.h"
+#include "../src/memory/memory.h"
+
+#include "helpers.h"
+
+using helpers::NamesOf;
+using helpers::TitlesOf;
+using namespace std::literals;
+
+TEST_CASE("In-memory changes are visible only after commit") {
+    memory::Database database;
+    const domain::Author author{domain::AuthorId::New(), "Jack London"};
+
+    {
+        auto uow = database.GetUnitOfWork();
+        uow->Authors().Save(author);
+        CHECK(uow->Authors().FindAuthorByName("Jack London"));
+
+        // Чтение из другого потока ждёт фиксации и видит уже зафиксированного автора
+        auto reader = std::async(std::launch::async, [&database] {
+            return database.GetReadOnlyUnitOfWork()->Authors().FindAuthorByName("Jack London").has_value();
+        });
+        uow->Commit();
+        CHECK(reader.get());
+    }
+
+    {
+        auto uow = database.GetUnitOfWork();
+        uow->Books().Save({domain::BookId::New(), author.GetId(), "White Fang", 1906, {"novel"}});
+        uow->Authors().Edit(author.GetId(), "John Griffith London");
+    }
+
+    auto uow = database.GetReadOnlyUnitOfWork();
+    CHECK(uow->Books().GetAllBooks().empty());
+    CHECK(NamesOf(uow->Authors().GetAllAuthors()) == std::vector{"Jack London"s});
+}
+
+TEST_CASE("In-memory rollback restores deleted rows and their indexes") {
+    memory::Database database;
+    const domain::Author author{domain::AuthorId::New(), "Jack London"};
+    const domain::BookId book_id = domain::BookId::New();
+    {
+        auto uow = database.GetUnitOfWork();
+        uow->Authors().Save(author);
+        uow->Books().Save({book_id, author.GetId(), "White Fang", 1906, {"novel", "dogs"}});
+        uow->Commit();
+    }
+
+    {
+        auto uow = database.GetUnitOfWork();
+        uow->Books().EditBook(book_id, "The Call of the Wild", 1903, {"dogs"});
+        uow->Authors().Delete(author.GetId());
+        CHECK(uow->Books().GetAllBooks().empty());
+        CHECK_FALSE(uow->Authors().FindAuthorById(author.GetId()));
+    }
+
+    auto uow = database.GetReadOnlyUnitOfWork();
+    const auto books = uow->Books().GetBooksByTags({"novel"}, domain::TagMatch::All, std::nullopt, 10);
+    REQUIRE(books.size() == 1);
+    CHECK(books.front().GetTitle() == "White Fang");
+    CHECK(books.front().GetAuthorName() == "Jack London");
+    CHECK(books.front().GetTags() == domain::Tags{"dogs", "novel"});
+    CHECK(TitlesOf(uow->Books().SearchBooks("fang", 10)) == std::vector{"White Fang"s});
+    CHECK(uow->Books().SearchBooks("call", 10).empty());
+}
+
+TEST_CASE("In-memory repositories enforce the constraints of the Postgres tables") {
+    memory::Database database;
+    auto uow = database.GetUnitOfWork();
+    const domain::Author author{domain::AuthorId::New(), "Jack London"};
+    uow->Authors().Save(author);
+
+    CHECK_THROWS_AS(uow->Authors().Save({domain::AuthorId::New(), "Jack London"}), domain::AuthorExistsError);
+    uow->Authors().Save({domain::AuthorId::New(), "Mark Twain"});
+    CHECK_THROWS_AS(uow->Authors().Edit(author.GetId(), "Mark Twain"), domain::AuthorExistsError);
+    CHECK_NOTHROW(uow->Authors().Save({author.GetId(), "Jack London"}));
+
+    CHECK_THROWS_AS(uow->Books().Save({domain::BookId::New(), domain::AuthorId::New(), "Orphan", 2000, {}}),
+                    std::runtime_error);
+    const domain::Book book{domain::BookId::New(), author.GetId(), "White Fang", 1906, {}};
+    uow->Books().AddBooks({book});
+    CHECK_THROWS_AS(uow->Books().AddBooks({book}), std::runtime_error);
+
+    auto read_only = memory::Database{}.GetReadOnlyUnitOfWork();
+    CHECK_THROWS_AS(read_only->Authors().Save({domain::AuthorId::New(), "Anyone"}), std::logic_error);
+}
+
+TEST_CASE("In-memory listings follow the Postgres order") {
+    memory::Database database;
+    auto uow = database.GetUnitOfWork();
+    const domain::Author london{domain::AuthorId::New(), "Jack London"};
+    const domain::Author twain{domain::AuthorId::New(), "Mark Twain"};
+    uow->Authors().Save(twain);
+    uow->Authors().Save(london);
+    uow->Books().AddBooks({
+        {domain::BookId::New(), london.GetId(), "White Fang", 1906, {"dogs", "novel", "dogs"}},
+        {domain::BookId::New(), london.GetId(), "The Call of the Wild", 1903, {"dogs"}},
+        {domain::BookId::New(), twain.GetId(), "Adventures of Tom Sawyer", 1876, {"novel"}},
+        {domain::BookId::New(), twain.GetId(), "White Fang", 1900, {}},
+    });
+
+    CHECK(NamesOf(uow->Authors().GetAllAuthors()) == std::vector{"Jack London"s, "Mark Twain"s});
+    CHECK(TitlesOf(uow->Books().GetBooksByAuthorId(london.GetId())) ==
+          std::vector{"The Call of the Wild"s, "White Fang"s});
+
+    const auto same_title = uow->Books().GetBooksByTitle("White Fang");
+    REQUIRE(same_title.size() == 2);
+    CHECK(same_title[0].GetPublicationYear() == 1900);
+    CHECK(same_title[1].GetAuthorName() == "Jack London");
+
+    // Ключи страниц следуют порядку (title, id), поэтому страницы не пересекаются и покрывают весь каталог
+    std::vector<std::string> paged;
+    std::optional<domain::BooksPageKey> after;
+    for (auto page = uow->Books().GetBooksPage(after, 3); !page.empty(); page = uow->Books().GetBooksPage(after, 3)) {
+        for (const auto& book : page) {
+            paged.push_back(book.GetTitle());
+        }
+        after = domain::BooksPageKey{page.back().GetTitle(), page.back().GetBookId()};
+    }
+    CHECK(paged == TitlesOf(uow->Books().GetAllBooks()));
+    CHECK(paged == std::vector{"Adventures of Tom Sawyer"s, "The Call of the Wild"s, "White Fang"s, "White Fang"s});
+
+    CHECK(TitlesOf(uow->Books().GetBooksByTags({"novel", "dogs"}, domain::TagMatch::All, std::nullopt, 10)) ==
+          std::vector{"White Fang"s});
+    CHECK(TitlesOf(uow->Books().GetBooksByTags({"novel", "dogs"}, domain::TagMatch::Any, std::nullopt, 10)) ==
+          std::vector{"Adventures of Tom Sawyer"s, "The Call of the Wild"s, "White Fang"s});
+
+    // Сначала точное совпадение названия, затем совпадения по названию и по автору
+    CHECK(TitlesOf(uow->Books().SearchBooks("White Fang", 10)) == std::vector{"White Fang"s, "White Fang"s});
+    CHECK(TitlesOf(uow->Books().SearchBooks("twa", 10)) ==
+          std::vector{"Adventures of Tom Sawyer"s, "White Fang"s});
+}
+
+TEST_CASE("In-memory use cases import and export a consistent catalog") {
+    memory::Database database;
+    app::UseCasesImpl use_cases{database};
+    use_cases.AddAuthor("Jack London");
+
+    const auto imported = use_cases.ImportBooks({
+        {"White Fang", "Jack London", 1906, {"novel"}},
+        {"Tom Sawyer", "Mark Twain", 1876, {"novel", "boys"}},
+        {"Huckleberry Finn", "Mark Twain", 1884, {}},
+    });
+    CHECK(imported.books == 3);
+    CHECK(imported.new_authors == 1);
+
+    std::vector<std::vector<std::string>> books(3);
+    std::multiset<std::string> tags;
+    std::mutex tags_mutex;
+    auto make_sink = [&](app::CatalogTable table, size_t index) -> domain::DumpLineSink {
+        if (table == app::CatalogTable::Books) {
+            return [&books, index](std::string_view line) {
+                books[index].emplace_back(line);
+            };
+        }
+        return [&tags, &tags_mutex, table](std::string_view line) {
+            if (table == app::CatalogTable::BookTags) {
+                std::lock_guard lock{tags_mutex};
+                tags.emplace(line.substr(line.find('\t') + 1));
+            }
+        };
+    };
+    const auto exported = use_cases.ExportCatalog(3, make_sink);
+
+    CHECK(exported.parts == 3);
+    CHECK(exported.authors == 2);
+    CHECK(exported.books == 3);
+    CHECK(exported.book_tags == 3);
+    CHECK(tags == std::multiset{"boys"s, "novel"s, "novel"s});
+    CHECK(books[0].size() + books[1].size() + books[2].size() == 3);
+}
+
+TEST_CASE("A thread can't wait for its own uncommitted in-memory changes") {
+    memory::Database database;
+    auto uow = database.GetUnitOfWork();
+    uow->Authors().Save({domain::AuthorId::New(), "Jack London"});
+
+    CHECK_THROWS_AS(database.GetReadOnlyUnitOfWork()->Authors().GetAllAuthors(), std::logic_error);
+    uow->Commit();
+    CHECK(database.GetReadOnlyUnitOfWork()->Authors().GetAllAuthors().size() == 1);
+}
+
+TEST_CASE("Commands of threads sharing use cases don't mix their units of work") {
+    memory::Database database;
+    app::UseCasesImpl use_cases{database};
+
+    // Пока первый поток выполняет команду, второй добавляет автора теми же сценариями
+    std::promise<void> command_started;
+    std::promise<void> other_thread_done;
+    auto command = std::async(std::launch::async, [&] {
+        use_cases.RunCommand([&] {
+            command_started.set_value();
+            other_thread_done.get_future().wait();
+            use_cases.AddAuthor("Mark Twain");
+            throw std::runtime_error("command failed");
+        });
+    });
+    command_started.get_future().wait();
+    use_cases.AddAuthor("Jack London");
+    other_thread_done.set_value();
+
+    // Откат команды первого потока не затрагивает изменения второго
+    CHECK_THROWS_AS(command.get(), std::runtime_error);
+    CHECK(NamesOf(use_cases.GetAllAuthors()) == std::vector{"Jack London"s});
+}
+
+TEST_CASE("A failed command in a transaction group keeps the changes of other commands") {
+    memory::Database database;
+    app::GroupedUnitOfWorkFactory grouped{database, 10};
+    app::UseCasesImpl use_cases{grouped};
+
+    use_cases.RunCommand([&] {
+        use_cases.AddAuthor("Jack London");
+    });
+    // Повторное имя отклоняется после того, как команда уже изменила каталог
+    const auto failing_command = [&] {
+        use_cases.AddAuthor("Mark Twain");
+        use_cases.AddAuthor("Jack London");
+    };
+    CHECK_THROWS_AS(use_cases.RunCommand(failing_command), domain::AuthorExistsError);
+    use_cases.RunCommand([&] {
+        use_cases.AddAuthor("Leo Tolstoy");
+    });
+    grouped.Flush();
+
+    CHECK(grouped.GetStats().transactions == 1);
+    CHECK(grouped.GetStats().commits == 2);
+    CHECK(grouped.GetStats().rolled_back == 0);
+    CHECK(NamesOf(use_cases.GetAllAuthors()) == std::vector{"Jack London"s, "Leo Tolstoy"s});
+}
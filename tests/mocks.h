@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/app/unit_of_work.h"
+#include "../src/domain/author.h"
+#include "../src/domain/book.h"
+
+// Репозитории и единицы работы в памяти для тестов и бенчмарков сценариев
+namespace mocks {
+
+// Строки части, как в Postgres: элемент попадает в часть по своей позиции
+template <typename Item, typename Write>
+size_t DumpPartOf(const std::vector<Item>& items, const domain::DumpPart& part, Write write) {
+    size_t count = 0;
+    for (size_t i = part.index; i < items.size(); i += part.count) {
+        count += write(items[i]);
+    }
+    return count;
+}
+
+// --- MOCK REPOSITORIES ---
+class MockAuthorRepository : public domain::AuthorRepository {
+public:
+    MockAuthorRepository() = default;
+
+    void Save(const domain::Author& author) override {
+        if (FindAuthorByName(author.GetName())) {
+            throw domain::AuthorExistsError{};
+        }
+        saved_authors_.emplace_back(author);
+    }
+
+    domain::Authors AddMissingAuthors(const domain::Authors& authors) override {
+        domain::Authors result;
+        for (const auto& author : authors) {
+            auto existing = FindAuthorByName(author.GetName());
+            if (!existing) {
+                Save(author);
+            }
+            result.push_back(existing.value_or(author));
+        }
+        return result;
+    }
+
+    domain::Authors GetAllAuthors() override {
+        return saved_authors_;
+    }
+
+    domain::Authors GetAuthorsPage(const std::optional<domain::AuthorsPageKey>& after, size_t limit) override {
+        auto first = saved_authors_.begin();
+        if (after) {
+            first = std::find_if(saved_authors_.begin(), saved_authors_.end(), [&after](const auto& author) {
+                        return author.GetId() == after->id;
+                    }) + 1;
+        }
+        return {first, first + std::min<size_t>(limit, saved_authors_.end() - first)};
+    }
+
+    void ForEachAuthor(const domain::AuthorVisitor& visitor) override {
+        std::for_each(saved_authors_.begin(), saved_authors_.end(), visitor);
+    }
+
+    size_t DumpAuthors(const domain::DumpPart& part, const domain::DumpLineSink& sink) override {
+        return DumpPartOf(saved_authors_, part, [&sink](const domain::Author& author) {
+            sink(author.GetId().ToString() + '\t' + author.GetName());
+            return 1;
+        });
+    }
+
+    void Delete(const domain::AuthorId&) override {}
+    void Edit(const domain::AuthorId&, const std::string&) override {}
+
+    std::optional<domain::Author> FindAuthorById(const domain::AuthorId& id) override {
+        for (const auto& author : saved_authors_)
+            if (author.GetId() == id)
+                return author;
+        return std::nullopt;
+    }
+
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override {
+        for (const auto& author : saved_authors_)
+            if (author.GetName() == name)
+                return author;
+        return std::nullopt;
+    }
+
+    const domain::Authors& GetSavedAuthors() const noexcept {
+        return saved_authors_;
+    }
+
+private:
+    domain::Authors saved_authors_;
+};
+
+class MockBookRepository : public domain::BookRepository {
+public:
+    MockBookRepository() = default;
+
+    void Save(const domain::Book& book) override {
+        saved_books_.emplace_back(book);
+    }
+
+    void AddBooks(const domain::Books& books) override {
+        saved_books_.insert(saved_books_.end(), books.begin(), books.end());
+    }
+
+    domain::Books GetAllBooks() override {
+        return saved_books_;
+    }
+
+    domain::Books GetBooksPage(const std::optional<domain::BooksPageKey>& after, size_t limit) override {
+        auto first = saved_books_.begin();
+        if (after) {
+            first = std::find_if(saved_books_.begin(), saved_books_.end(), [&after](const auto& book) {
+                        return book.GetBookId() == after->id;
+                    }) + 1;
+        }
+        return {first, first + std::min<size_t>(limit, saved_books_.end() - first)};
+    }
+
+    void ForEachBook(const domain::BookVisitor& visitor) override {
+        std::for_each(saved_books_.begin(), saved_books_.end(), visitor);
+    }
+
+    domain::Books GetBooksByAuthorId(const domain::AuthorId& id) override {
+        domain::Books result;
+        for (const auto& book : saved_books_) {
+            if (book.GetAuthorId() == id) {
+                result.push_back(book);
+            }
+        }
+        return result;
+    }
+
+    domain::Books GetBooksByTitle(const std::string&) override {
+        return {};
+    }
+    domain::Books GetBooksByTags(const domain::Tags& tags, domain::TagMatch match,
+                                 const std::optional<domain::BooksPageKey>& after, size_t limit) override {
+        auto matches = [&tags, match](const domain::Book& book) {
+            auto has_tag = [&book](const std::string& tag) {
+                return std::find(book.GetTags().begin(), book.GetTags().end(), tag) != book.GetTags().end();
+            };
+            return match == domain::TagMatch::All ? std::all_of(tags.begin(), tags.end(), has_tag)
+                                                  : std::any_of(tags.begin(), tags.end(), has_tag);
+        };
+
+        domain::Books result;
+        bool after_key = !after;
+        for (const auto& book : saved_books_) {
+            if (after_key && result.size() < limit && !tags.empty() && matches(book)) {
+                result.push_back(book);
+            }
+            after_key = after_key || book.GetBookId() == after->id;
+        }
+        return result;
+    }
+
+    domain::Books SearchBooks(const std::string& query, size_t limit) override {
+        domain::Books result;
+        for (const auto& book : saved_books_) {
+            if (result.size() < limit && book.GetTitle().find(query) != std::string::npos) {
+                result.push_back(book);
+            }
+        }
+        return result;
+    }
+    void DeleteBook(const domain::BookId&) override {}
+    void EditBook(const domain::BookId&, const std::string&, int, const domain::Tags&) override {}
+
+    size_t DumpBooks(const domain::DumpPart& part, const domain::DumpLineSink& sink) override {
+        return DumpPartOf(saved_books_, part, [&sink](const domain::Book& book) {
+            sink(book.GetBookId().ToString() + '\t' + book.GetAuthorId().ToString() + '\t' + book.GetTitle() + '\t' +
+                 std::to_string(book.GetPublicationYear()));
+            return 1;
+        });
+    }
+
+    size_t DumpBookTags(const domain::DumpPart& part, const domain::DumpLineSink& sink) override {
+        return DumpPartOf(saved_books_, part, [&sink](const domain::Book& book) {
+            for (const auto& tag : book.GetTags()) {
+                sink(book.GetBookId().ToString() + '\t' + tag);
+            }
+            return book.GetTags().size();
+        });
+    }
+
+    const domain::Books& GetSavedBooks() const noexcept {
+        return saved_books_;
+    }
+
+private:
+    domain::Books saved_books_;
+};
+
+// --- MOCK UNIT OF WORK ---
+class MockUnitOfWork : public app::UnitOfWork {
+public:
+    MockUnitOfWork(MockAuthorRepository& authors, MockBookRepository& books, int* commits = nullptr,
+                   int* savepoint_rollbacks = nullptr)
+        : authors_(authors), books_(books), commits_(commits), savepoint_rollbacks_(savepoint_rollbacks) {}
+
+    domain::AuthorRepository& Authors() override {
+        return authors_;
+    }
+    domain::BookRepository& Books() override {
+        return books_;
+    }
+    void Commit() override {
+        if (commits_) {
+            ++*commits_;
+        }
+    }
+    void SetSavepoint() override {
+        ++savepoints_;
+    }
+    void ReleaseSavepoint() override {
+        PopSavepoint();
+    }
+    void RollbackToSavepoint() override {
+        PopSavepoint();
+        if (savepoint_rollbacks_) {
+            ++*savepoint_rollbacks_;
+        }
+    }
+
+private:
+    void PopSavepoint() {
+        if (savepoints_ == 0) {
+            throw std::logic_error("No savepoint is set");
+        }
+        --savepoints_;
+    }
+
+    MockAuthorRepository& authors_;
+    MockBookRepository& books_;
+    int* commits_;
+    int* savepoint_rollbacks_;
+    int savepoints_ = 0;
+};
+
+class MockUnitOfWorkFactory : public app::UnitOfWorkFactory {
+public:
+    MockUnitOfWorkFactory(MockAuthorRepository& authors, MockBookRepository& books)
+        : authors_(authors), books_(books) {}
+
+    std::unique_ptr<app::UnitOfWork> GetUnitOfWork() override {
+        ++units_of_work;
+        return std::make_unique<MockUnitOfWork>(authors_, books_, &commits, &savepoint_rollbacks);
+    }
+
+    std::unique_ptr<app::UnitOfWork> GetBatchUnitOfWork() override {
+        ++batch_units_of_work;
+        return std::make_unique<MockUnitOfWork>(authors_, books_, &commits, &savepoint_rollbacks);
+    }
+
+    std::unique_ptr<app::ReadOnlyUnitOfWork> GetReadOnlyUnitOfWork() override {
+        ++read_only_units_of_work;
+        return std::make_unique<MockUnitOfWork>(authors_, books_);
+    }
+
+    std::vector<std::unique_ptr<app::ReadOnlyUnitOfWork>> GetSnapshotUnitsOfWork(size_t count) override {
+        std::vector<std::unique_ptr<app::ReadOnlyUnitOfWork>> units;
+        for (size_t i = 0; i < std::min(count, max_snapshot_units); ++i) {
+            units.push_back(std::make_unique<MockUnitOfWork>(authors_, books_));
+        }
+        return units;
+    }
+
+    int units_of_work = 0;
+    int read_only_units_of_work = 0;
+    int batch_units_of_work = 0;
+    int commits = 0;
+    int savepoint_rollbacks = 0;
+    // Столько соединений «свободно» для единиц работы одного снимка
+    size_t max_snapshot_units = 4;
+
+private:
+    MockAuthorRepository& authors_;
+    MockBookRepository& books_;
+};
+
+}  // namespace mocks
@@ -0,0 +1,856 @@
+#include <algorithm>
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
+#include <pqxx/pqxx>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/postgres/postgres.h"
+
+#include "helpers.h"
+
+using helpers::TitlesOf;
+using namespace std::literals;
+using pqxx::operator""_zv;
+
+namespace {
+
+// Тесты очищают таблицы, поэтому им нужна отдельная база данных
+constexpr const char TEST_DB_URL_ENV_NAME[]{"BOOKYPEDIA_TEST_DB_URL"};
+// Второй сервер для проверки маршрутизации чтения на реплики
+constexpr const char TEST_REPLICA_DB_URL_ENV_NAME[]{"BOOKYPEDIA_TEST_REPLICA_DB_URL"};
+
+// Считает запросы, отправленные серверу, по протокольной трассировке libpq. Трассировка читается
+// через отдельный поток файла: libpq продолжает писать в свой, не замечая чтений
+class QueryCounter {
+public:
+    explicit QueryCounter(pqxx::connection& connection)
+        : connection_{connection},
+          path_{std::filesystem::temp_directory_path() /
+                ("bookypedia-trace-" + std::to_string(std::random_device{}()) + ".log")},
+          trace_{std::fopen(path_.c_str(), "w")} {
+        if (!trace_) {
+            throw std::runtime_error("Can't open " + path_.string());
+        }
+        connection_.trace(trace_);
+    }
+
+    QueryCounter(const QueryCounter&) = delete;
+    QueryCounter& operator=(const QueryCounter&) = delete;
+
+    ~QueryCounter() {
+        connection_.trace(nullptr);
+        std::fclose(trace_);
+        std::filesystem::remove(path_);
+    }
+
+    size_t Count() const {
+        std::fflush(trace_);
+        std::ifstream trace{path_};
+
+        size_t count = 0;
+        std::string message;
+        while (std::getline(trace, message)) {
+            if (message.find("\tF\t"sv) == std::string::npos) {
+                continue;
+            }
+            if (message.find("\tQuery\t"sv) != std::string::npos || message.find("\tSync"sv) != std::string::npos) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+private:
+    pqxx::connection& connection_;
+    std::filesystem::path path_;
+    std::FILE* trace_;
+};
+
+class DatabaseFixture {
+protected:
+    DatabaseFixture() {
+        const char* url = std::getenv(TEST_DB_URL_ENV_NAME);
+        if (!url) {
+            SKIP(TEST_DB_URL_ENV_NAME + " environment variable not found"s);
+        }
+        postgres::Database database{postgres::DatabaseConfig{url}};
+        url_ = url;
+        connection_.emplace(url);
+        postgres::PrepareStatements(*connection_);
+        Clear();
+    }
+
+    void Clear() {
+        pqxx::work work{*connection_};
+        work.exec("TRUNCATE book_tags, books, authors;"_zv);
+        work.commit();
+    }
+
+    // Добавляет автора с book_count книгами, у каждой из которых tag_count тегов
+    domain::AuthorId AddAuthorWithBooks(const std::string& name, int book_count, int tag_count) {
+        const auto author_id = domain::AuthorId::New();
+
+        pqxx::work work{*connection_};
+        work.exec_params("INSERT INTO authors (id, name) VALUES ($1, $2);"_zv, author_id.ToString(), name);
+        work.exec_params(
+            R"(
+INSERT INTO books (id, author_id, title, publication_year)
+SELECT gen_random_uuid(), $1, $2 || ' ' || i, 2000
+FROM generate_series(1, $3) AS i;
+)"_zv,
+            author_id.ToString(), name, book_count);
+        work.exec_params(
+            R"(
+INSERT INTO book_tags (book_id, tag)
+SELECT b.id, 'tag ' || t
+FROM books b, generate_series(1, $2) AS t
+WHERE b.author_id = $1;
+)"_zv,
+            author_id.ToString(), tag_count);
+        work.commit();
+
+        return author_id;
+    }
+
+    pqxx::connection& Connection() {
+        return *connection_;
+    }
+
+    const std::string& Url() const {
+        return url_;
+    }
+
+private:
+    std::string url_;
+    std::optional<pqxx::connection> connection_;
+};
+
+}  // namespace
+
+TEST_CASE_METHOD(DatabaseFixture, "Book listings fetch tags with a constant number of queries") {
+    constexpr int TAG_COUNT = 3;
+
+    auto count_queries = [this](int book_count) {
+        Clear();
+        const auto author_id = AddAuthorWithBooks("Author", book_count, TAG_COUNT);
+
+        pqxx::work work{Connection()};
+        postgres::BookRepositoryImpl books{work};
+
+        QueryCounter counter{Connection()};
+        auto all_books = books.GetAllBooks();
+        const size_t all_books_queries = counter.Count();
+
+        auto author_books = books.GetBooksByAuthorId(author_id);
+        const size_t author_books_queries = counter.Count() - all_books_queries;
+
+        auto title_books = books.GetBooksByTitle("Author 1");
+        const size_t title_books_queries = counter.Count() - all_books_queries - author_books_queries;
+
+        REQUIRE(all_books.size() == book_count);
+        REQUIRE(author_books.size() == book_count);
+        REQUIRE(title_books.size() == 1);
+        for (const auto& book : all_books) {
+            CHECK(book.GetTags().size() == TAG_COUNT);
+        }
+        CHECK(title_books.front().GetTags().size() == TAG_COUNT);
+
+        return std::tuple{all_books_queries, author_books_queries, title_books_queries};
+    };
+
+    CHECK(count_queries(10) == count_queries(200));
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Author lookups bind names as parameters") {
+    const std::string name = "O'Brien; DROP TABLE authors; --";
+    const auto author_id = AddAuthorWithBooks(name, 1, 1);
+
+    pqxx::work work{Connection()};
+    postgres::AuthorRepositoryImpl authors{work};
+
+    auto by_name = authors.FindAuthorByName(name);
+    REQUIRE(by_name);
+    CHECK(by_name->GetId() == author_id);
+
+    auto by_id = authors.FindAuthorById(author_id);
+    REQUIRE(by_id);
+    CHECK(by_id->GetName() == name);
+
+    CHECK_FALSE(authors.FindAuthorById(domain::AuthorId::New()));
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Units of work run concurrently on pooled connections") {
+    using namespace std::chrono_literals;
+    postgres::Database database{
+        postgres::DatabaseConfig{.url = Url(), .pool = {.capacity = 2, .acquire_timeout = 100ms}}};
+
+    auto first = database.GetUnitOfWork();
+    auto second = std::async(std::launch::async, [&database] {
+        auto unit = database.GetUnitOfWork();
+        unit->Authors().Save({domain::AuthorId::New(), "Concurrent author"});
+        unit->Commit();
+    });
+    CHECK_NOTHROW(second.get());
+
+    auto third = database.GetUnitOfWork();
+    CHECK_THROWS(database.GetUnitOfWork());
+
+    first.reset();
+    CHECK_NOTHROW(database.GetUnitOfWork());
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Move-assigning a pooled connection returns the one it held") {
+    using namespace std::chrono_literals;
+    const auto connect = [this] {
+        return std::make_unique<pqxx::connection>(Url());
+    };
+    postgres::ConnectionPool pool{{.capacity = 2, .acquire_timeout = 100ms}, connect};
+
+    auto first = pool.GetConnection();
+    auto second = pool.GetConnection();
+    first = std::move(second);
+
+    CHECK(pool.GetBusyConnectionCount() == 1);
+    CHECK_NOTHROW(pool.GetConnection());
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Pooled connections closed by the server are replaced") {
+    using namespace std::chrono_literals;
+    postgres::Database database{postgres::DatabaseConfig{
+        .url = Url(), .pool = {.capacity = 1, .acquire_timeout = 100ms, .idle_check_interval = 0ms}}};
+    database.GetUnitOfWork()->Commit();
+
+    // Сервер закрывает соединение пула, а libpq узнает об этом только при следующем запросе
+    pqxx::nontransaction work{Connection()};
+    constexpr auto other_backends = R"(
+SELECT pid FROM pg_stat_activity
+WHERE datname = current_database() AND backend_type = 'client backend' AND pid <> pg_backend_pid()
+)"sv;
+    work.exec("SELECT pg_terminate_backend(pid) FROM ("s.append(other_backends).append(") AS b;"));
+    for (int attempt = 0; attempt < 100 && !work.exec(other_backends).empty(); ++attempt) {
+        std::this_thread::sleep_for(10ms);
+    }
+    REQUIRE(work.exec(other_backends).empty());
+
+    auto unit = database.GetUnitOfWork();
+    unit->Authors().Save({domain::AuthorId::New(), "After restart"});
+    CHECK_NOTHROW(unit->Commit());
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Book tags are written with a constant number of queries") {
+    const auto author_id = AddAuthorWithBooks("Author", 0, 0);
+    const auto book_id = domain::BookId::New();
+
+    auto make_tags = [](int first, int count) {
+        domain::Tags tags;
+        for (int i = first; i < first + count; ++i) {
+            tags.push_back("tag " + std::to_string(i));
+        }
+        std::sort(tags.begin(), tags.end());
+        return tags;
+    };
+
+    auto count_queries = [&](int tag_count) {
+        pqxx::work work{Connection()};
+        postgres::BookRepositoryImpl books{work};
+
+        QueryCounter counter{Connection()};
+        books.Save({book_id, author_id, "Book", 2000, make_tags(0, tag_count)});
+        const size_t save_queries = counter.Count();
+
+        const auto new_tags = make_tags(tag_count / 2, tag_count);
+        books.EditBook(book_id, "Book", 2001, new_tags);
+        const size_t edit_queries = counter.Count() - save_queries;
+
+        auto saved = books.GetBooksByTitle("Book");
+        REQUIRE(saved.size() == 1);
+        CHECK(saved.front().GetTags() == new_tags);
+
+        return std::pair{save_queries, edit_queries};
+    };
+
+    CHECK(count_queries(1) == count_queries(100));
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Deletes cascade to books and tags in a constant number of queries") {
+    auto orphan_count = [](pqxx::transaction_base& work) {
+        return work.query_value<int>(R"(
+SELECT (SELECT count(*) FROM book_tags bt WHERE NOT EXISTS (SELECT 1 FROM books b WHERE b.id = bt.book_id))
+     + (SELECT count(*) FROM books b WHERE NOT EXISTS (SELECT 1 FROM authors a WHERE a.id = b.author_id));
+)"_zv);
+    };
+
+    auto count_queries = [&](int book_count) {
+        Clear();
+        const auto author_id = AddAuthorWithBooks("Author", book_count, 3);
+        const auto other_id = AddAuthorWithBooks("Other", 2, 2);
+
+        pqxx::work work{Connection()};
+        postgres::AuthorRepositoryImpl authors{work};
+        postgres::BookRepositoryImpl books{work};
+        const auto other_books = books.GetBooksByAuthorId(other_id);
+        REQUIRE(other_books.size() == 2);
+
+        QueryCounter counter{Connection()};
+        authors.Delete(author_id);
+        const size_t author_queries = counter.Count();
+        books.DeleteBook(other_books.front().GetBookId());
+        const size_t book_queries = counter.Count() - author_queries;
+
+        CHECK(orphan_count(work) == 0);
+        CHECK(work.query_value<int>("SELECT count(*) FROM books;"_zv) == 1);
+        CHECK(work.query_value<int>("SELECT count(*) FROM book_tags;"_zv) == 2);
+        return std::pair{author_queries, book_queries};
+    };
+
+    CHECK(count_queries(1) == count_queries(500));
+
+    SECTION("Use cases delete through the cascade") {
+        Clear();
+        const auto author_id = AddAuthorWithBooks("Author", 20, 3);
+        const auto other_id = AddAuthorWithBooks("Other", 2, 2);
+
+        postgres::Database database{postgres::DatabaseConfig{Url()}};
+        app::UseCasesImpl use_cases{database};
+        use_cases.DeleteAuthor(author_id);
+        use_cases.DeleteBook(use_cases.GetBooksByAuthor(other_id).front().GetBookId());
+
+        pqxx::read_transaction work{Connection()};
+        CHECK(orphan_count(work) == 0);
+        CHECK(work.query_value<int>("SELECT count(*) FROM authors;"_zv) == 1);
+        CHECK(work.query_value<int>("SELECT count(*) FROM book_tags;"_zv) == 2);
+    }
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Startup refuses to add the author foreign key over books without an author") {
+    const auto author_id = AddAuthorWithBooks("Author", 0, 0);
+    {
+        // Так выглядит база прежней версии: внешнего ключа нет, и у книги не осталось автора
+        pqxx::work work{Connection()};
+        work.exec("ALTER TABLE books DROP CONSTRAINT books_author_id_fkey;"_zv);
+        auto add_book = [&work](const std::string& title, const domain::AuthorId& book_author_id) {
+            work.exec_params("INSERT INTO books (id, author_id, title, publication_year) VALUES ($1, $2, $3, 2000);"_zv,
+                             domain::BookId::New().ToString(), book_author_id.ToString(), title);
+        };
+        add_book("Orphan", domain::AuthorId::New());
+        add_book("Kept", author_id);
+        work.commit();
+    }
+
+    CHECK_THROWS(postgres::Database{postgres::DatabaseConfig{Url()}});
+    {
+        pqxx::work work{Connection()};
+        CHECK(work.query_value<int>("SELECT count(*) FROM books;"_zv) == 2);
+        work.exec("DELETE FROM books WHERE title = 'Orphan';"_zv);
+        work.commit();
+    }
+
+    CHECK_NOTHROW(postgres::Database{postgres::DatabaseConfig{Url()}});
+    pqxx::read_transaction work{Connection()};
+    CHECK(work.query_value<int>(
+              "SELECT count(*) FROM pg_constraint WHERE conname = 'books_author_id_fkey';"_zv) == 1);
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Repository lookups use index scans on a large catalog", "[query-plan]") {
+    constexpr int AUTHOR_COUNT = 2000;
+    constexpr int BOOKS_PER_AUTHOR = 25;
+    constexpr int TAGS_PER_BOOK = 3;
+    {
+        pqxx::work work{Connection()};
+        work.exec_params(R"(
+INSERT INTO authors (id, name)
+SELECT gen_random_uuid(), 'Author ' || i
+FROM generate_series(1, $1) AS i;
+)"_zv,
+                         AUTHOR_COUNT);
+        work.exec_params(
+            R"(
+INSERT INTO books (id, author_id, title, publication_year)
+SELECT gen_random_uuid(), a.id, a.name || ' book ' || i, 1900 + i
+FROM authors a, generate_series(1, $1) AS i;
+)"_zv,
+            BOOKS_PER_AUTHOR);
+        // Теги из тысячи: у каждого около полутора сотен книг, как у тегов настоящего каталога
+        work.exec_params(R"(
+INSERT INTO book_tags (book_id, tag)
+SELECT b.id, 'tag ' || (b.n * 7 + t) % 1000
+FROM (SELECT id, row_number() OVER () AS n FROM books) b, generate_series(1, $1) AS t;
+)"_zv,
+                         TAGS_PER_BOOK);
+        work.exec("ANALYZE authors, books, book_tags;"_zv);
+        work.commit();
+    }
+
+    pqxx::work work{Connection()};
+    const auto author_id = work.query_value<std::string>("SELECT id FROM authors WHERE name = 'Author 1000';"_zv);
+    const auto book_id = work.query_value<std::string>(
+        "SELECT id FROM books WHERE title = 'Author 1000 book 10';"_zv);
+
+    auto explain = [&work](const std::string& statement, const std::string& args) {
+        std::string plan;
+        for (const auto& [line] : work.query<std::string>("EXPLAIN EXECUTE " + statement + "(" + args + ");")) {
+            plan += line;
+            plan += '\n';
+        }
+        return plan;
+    };
+
+    const std::string quoted_author_id = work.quote(author_id);
+    const std::string quoted_title = work.quote("Author 1000 book 10"s);
+    const std::string quoted_book_id = work.quote(book_id);
+
+    // Аргументы подбираются по типам параметров, поэтому проверяются все подготовленные запросы репозиториев,
+    // в том числе добавленные позже. Поиску нужен запрос, похожий на настоящий
+    const std::unordered_map<std::string, std::string> args_by_type{
+        {"uuid", quoted_author_id},
+        {"uuid[]", "ARRAY[" + quoted_book_id + "]::uuid[]"},
+        {"character varying", quoted_title},
+        {"text", quoted_title},
+        {"character varying[]", "ARRAY['tag 1']::varchar[]"},
+        {"integer", "20"},
+        {"bigint", "20"},
+    };
+    const std::unordered_map<std::string, std::string> statement_args{
+        {"search_books", work.quote("1000 book 10"s) + ", 20"},
+    };
+    // Полные выборки читают таблицы целиком
+    const std::unordered_set<std::string> full_scans{"get_all_authors", "get_all_books", "get_all_book_tags"};
+
+    std::unordered_set<std::string> checked;
+    constexpr auto prepared_statements =
+        "SELECT name, array_to_string(parameter_types::text[], ',') FROM pg_prepared_statements ORDER BY name;"_zv;
+    for (const auto& [statement, parameter_types] : work.query<std::string, std::string>(prepared_statements)) {
+        if (full_scans.contains(statement)) {
+            continue;
+        }
+
+        std::string args;
+        if (const auto it = statement_args.find(statement); it != statement_args.end()) {
+            args = it->second;
+        } else {
+            std::string_view types{parameter_types};
+            while (!types.empty()) {
+                const auto type = types.substr(0, types.find(','));
+                types.remove_prefix(std::min(types.size(), type.size() + 1));
+                const auto arg = args_by_type.find(std::string{type});
+                INFO(statement << ": " << type);
+                REQUIRE(arg != args_by_type.end());
+                args.append(args.empty() ? "" : ", ").append(arg->second);
+            }
+        }
+
+        const auto plan = explain(statement, args);
+        INFO(statement << '\n' << plan);
+        CHECK(plan.find("Index"sv) != std::string::npos);
+        CHECK(plan.find("Seq Scan"sv) == std::string::npos);
+        checked.insert(statement);
+    }
+
+    // Постраничные выборки и выборки по тегам тоже проверены
+    for (const auto* statement : {"get_first_authors_page", "get_authors_page_after", "get_first_books_page",
+                                  "get_books_page_after", "get_first_books_by_tags_page",
+                                  "get_books_by_tags_page_after", "search_books", "delete_book"}) {
+        CHECK(checked.contains(statement));
+    }
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Title search matches word prefixes and ranks exact titles first") {
+    pqxx::work work{Connection()};
+    postgres::AuthorRepositoryImpl authors{work};
+    postgres::BookRepositoryImpl books{work};
+
+    const domain::Author london{domain::AuthorId::New(), "Jack London"};
+    const domain::Author lem{domain::AuthorId::New(), "Stanislaw Lem"};
+    authors.Save(london);
+    authors.Save(lem);
+    books.Save({domain::BookId::New(), london.GetId(), "White Fang", 1906, {"dogs"}});
+    books.Save({domain::BookId::New(), london.GetId(), "The Call of the Wild", 1903, {}});
+    books.Save({domain::BookId::New(), lem.GetId(), "Fang", 1970, {}});
+    books.Save({domain::BookId::New(), lem.GetId(), "Solaris", 1961, {}});
+
+    const auto partial = books.SearchBooks("whi FAN", 10);
+    REQUIRE(TitlesOf(partial) == std::vector{"White Fang"s});
+    CHECK(partial.front().GetAuthorName() == "Jack London");
+    CHECK(partial.front().GetTags() == domain::Tags{"dogs"});
+
+    CHECK(TitlesOf(books.SearchBooks("Fang", 10)) == std::vector{"Fang"s, "White Fang"s});
+    CHECK(books.SearchBooks("Fang", 1).size() == 1);
+    CHECK(TitlesOf(books.SearchBooks("lem", 10)) == std::vector{"Fang"s, "Solaris"s});
+    CHECK(books.SearchBooks("Martin Eden", 10).empty());
+    CHECK(books.SearchBooks("' & !", 10).empty());
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Books are found by all or any of the tags page by page") {
+    pqxx::work work{Connection()};
+    postgres::AuthorRepositoryImpl authors{work};
+    postgres::BookRepositoryImpl books{work};
+
+    const domain::Author author{domain::AuthorId::New(), "Author"};
+    authors.Save(author);
+    books.AddBooks({{domain::BookId::New(), author.GetId(), "A", 2000, {"classic", "sea"}},
+                    {domain::BookId::New(), author.GetId(), "B", 2000, {"sea"}},
+                    {domain::BookId::New(), author.GetId(), "C", 2000, {"classic"}},
+                    {domain::BookId::New(), author.GetId(), "D", 2000, {"classic", "dogs", "sea"}},
+                    {domain::BookId::New(), author.GetId(), "E", 2000, {}}});
+
+    auto read_all_pages = [&books](const domain::Tags& tags, domain::TagMatch match) {
+        std::vector<std::string> titles;
+        std::optional<domain::BooksPageKey> after;
+        for (auto page = books.GetBooksByTags(tags, match, after, 2); !page.empty();
+             page = books.GetBooksByTags(tags, match, after, 2)) {
+            for (const auto& book : page) {
+                titles.push_back(book.GetTitle());
+            }
+            after = domain::BooksPageKey{page.back().GetTitle(), page.back().GetBookId()};
+        }
+        return titles;
+    };
+
+    CHECK(read_all_pages({"sea", "classic"}, domain::TagMatch::All) == std::vector{"A"s, "D"s});
+    CHECK(read_all_pages({"sea", "classic", "sea"}, domain::TagMatch::All) == std::vector{"A"s, "D"s});
+    CHECK(read_all_pages({"sea", "classic"}, domain::TagMatch::Any) == std::vector{"A"s, "B"s, "C"s, "D"s});
+    CHECK(read_all_pages({"dogs", "missing"}, domain::TagMatch::All).empty());
+    CHECK(read_all_pages({}, domain::TagMatch::Any).empty());
+
+    const auto found = books.GetBooksByTags({"dogs"}, domain::TagMatch::Any, std::nullopt, 10);
+    REQUIRE(found.size() == 1);
+    CHECK(found.front().GetTags() == domain::Tags{"classic", "dogs", "sea"});
+    CHECK(found.front().GetAuthorName() == "Author");
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Read-only units of work reject writes") {
+    const auto author_id = AddAuthorWithBooks("Author", 1, 1);
+
+    for (bool deferrable : {false, true}) {
+        postgres::Database database{postgres::DatabaseConfig{.url = Url(), .deferrable_reads = deferrable}};
+
+        auto unit = database.GetReadOnlyUnitOfWork();
+        CHECK(unit->Authors().FindAuthorById(author_id));
+        CHECK(unit->Books().GetBooksByAuthorId(author_id).size() == 1);
+        CHECK_THROWS(unit->Authors().Save({domain::AuthorId::New(), "Writer"}));
+    }
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Read-only units of work are routed to replicas") {
+    using namespace std::chrono_literals;
+
+    const char* replica_url = std::getenv(TEST_REPLICA_DB_URL_ENV_NAME);
+    if (!replica_url) {
+        SKIP(TEST_REPLICA_DB_URL_ENV_NAME + " environment variable not found"s);
+    }
+    {
+        // Роль реплики играет независимый сервер: записи на основной сервер на нём не видны
+        postgres::Database replica{postgres::DatabaseConfig{replica_url}};
+        pqxx::connection connection{replica_url};
+        pqxx::work work{connection};
+        work.exec("TRUNCATE book_tags, books, authors;"_zv);
+        work.commit();
+    }
+
+    const domain::Author author{domain::AuthorId::New(), "Primary author"};
+    auto save_and_find = [&author](postgres::Database& database) {
+        auto unit = database.GetUnitOfWork();
+        unit->Authors().Save(author);
+        unit->Commit();
+        return database.GetReadOnlyUnitOfWork()->Authors().FindAuthorById(author.GetId()).has_value();
+    };
+
+    SECTION("Reads go to the replicas") {
+        for (auto selection : {postgres::ReplicaSelection::RoundRobin, postgres::ReplicaSelection::LeastLoaded}) {
+            postgres::Database database{postgres::DatabaseConfig{
+                .url = Url(), .replica_urls = {replica_url, replica_url}, .replica_selection = selection}};
+            CHECK_FALSE(save_and_find(database));
+        }
+    }
+
+    SECTION("Reads stick to the primary right after a commit") {
+        postgres::Database database{postgres::DatabaseConfig{
+            .url = Url(), .replica_urls = {replica_url}, .read_your_writes_window = 1min}};
+        CHECK(save_and_find(database));
+    }
+
+    SECTION("Reads fall back to the primary without replicas") {
+        postgres::Database database{postgres::DatabaseConfig{.url = Url()}};
+        CHECK(save_and_find(database));
+    }
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Keyset pages cover the catalog exactly once") {
+    constexpr int BOOK_COUNT = 25;
+    constexpr size_t PAGE_SIZE = 10;
+    AddAuthorWithBooks("Author", BOOK_COUNT, 2);
+    AddAuthorWithBooks("Second author", BOOK_COUNT, 2);
+
+    pqxx::work work{Connection()};
+    postgres::BookRepositoryImpl books{work};
+    postgres::AuthorRepositoryImpl authors{work};
+
+    std::vector<std::string> titles;
+    std::optional<domain::BooksPageKey> after;
+    for (auto page = books.GetBooksPage(after, PAGE_SIZE); !page.empty(); page = books.GetBooksPage(after, PAGE_SIZE)) {
+        CHECK(page.size() <= PAGE_SIZE);
+        for (const auto& book : page) {
+            CHECK(book.GetTags().size() == 2);
+            titles.push_back(book.GetTitle());
+        }
+        after = domain::BooksPageKey{page.back().GetTitle(), page.back().GetBookId()};
+    }
+
+    CHECK(titles == TitlesOf(books.GetAllBooks()));
+
+    auto first_author_page = authors.GetAuthorsPage(std::nullopt, 1);
+    REQUIRE(first_author_page.size() == 1);
+    CHECK(first_author_page.front().GetName() == "Author");
+    const auto& last = first_author_page.front();
+    auto second_author_page = authors.GetAuthorsPage(domain::AuthorsPageKey{last.GetName(), last.GetId()}, 10);
+    REQUIRE(second_author_page.size() == 1);
+    CHECK(second_author_page.front().GetName() == "Second author");
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Streamed catalog matches the loaded one") {
+    AddAuthorWithBooks("Author", 30, 3);
+    AddAuthorWithBooks("Untagged author", 5, 0);
+
+    pqxx::work work{Connection()};
+    postgres::BookRepositoryImpl books{work};
+    postgres::AuthorRepositoryImpl authors{work};
+
+    const auto all_books = books.GetAllBooks();
+    size_t streamed_count = 0;
+    books.ForEachBook([&](const domain::Book& book) {
+        REQUIRE(streamed_count < all_books.size());
+        const auto& expected = all_books[streamed_count++];
+        CHECK(book.GetBookId() == expected.GetBookId());
+        CHECK(book.GetTitle() == expected.GetTitle());
+        CHECK(book.GetAuthorName() == expected.GetAuthorName());
+        CHECK(book.GetTags() == expected.GetTags());
+    });
+    CHECK(streamed_count == all_books.size());
+
+    std::vector<std::string> author_names;
+    authors.ForEachAuthor([&](const domain::Author& author) {
+        author_names.push_back(author.GetName());
+    });
+    CHECK(author_names == std::vector{"Author"s, "Untagged author"s});
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Binary UUID parameters match text ones") {
+    postgres::Database database{postgres::DatabaseConfig{.url = Url(), .uuid_format = postgres::UuidFormat::Binary}};
+
+    const domain::Author author{domain::AuthorId::New(), "Author"};
+    const domain::Book book{domain::BookId::New(), author.GetId(), "Title", 2000, {"a", "b"}};
+    {
+        auto unit = database.GetUnitOfWork();
+        unit->Authors().Save(author);
+        unit->Books().Save(book);
+        unit->Books().EditBook(book.GetBookId(), "New title", 2001, {"b", "c"});
+        unit->Commit();
+    }
+
+    pqxx::work work{Connection()};
+    CHECK(work.query_value<std::string>("SELECT id::text FROM books;"_zv) == book.GetBookId().ToString());
+
+    auto unit = database.GetReadOnlyUnitOfWork();
+    REQUIRE(unit->Authors().FindAuthorById(author.GetId()));
+    const auto books = unit->Books().GetBooksByAuthorId(author.GetId());
+    REQUIRE(books.size() == 1);
+    CHECK(books.front().GetBookId() == book.GetBookId());
+    CHECK(books.front().GetTags() == domain::Tags{"b", "c"});
+    CHECK(unit->Authors().GetAuthorsPage(domain::AuthorsPageKey{"", author.GetId()}, 10).size() == 1);
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Bulk import resolves authors by name and copies books with tags") {
+    const auto existing_id = AddAuthorWithBooks("Existing", 0, 0);
+
+    pqxx::work work{Connection()};
+    postgres::AuthorRepositoryImpl authors{work};
+    postgres::BookRepositoryImpl books{work};
+
+    const domain::Author new_author{domain::AuthorId::New(), "New"};
+    auto resolved = authors.AddMissingAuthors({{domain::AuthorId::New(), "Existing"}, new_author});
+    std::sort(resolved.begin(), resolved.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.GetName() < rhs.GetName();
+    });
+    REQUIRE(resolved.size() == 2);
+    CHECK(resolved[0].GetId() == existing_id);
+    CHECK(resolved[1].GetId() == new_author.GetId());
+
+    books.AddBooks({{domain::BookId::New(), existing_id, "Tab\tand \"quotes\"", 2000, {"a", "b"}},
+                    {domain::BookId::New(), new_author.GetId(), "Plain", 2001, {}}});
+
+    const auto all_books = books.GetAllBooks();
+    REQUIRE(all_books.size() == 2);
+    CHECK(all_books[0].GetTitle() == "Plain");
+    CHECK(all_books[0].GetTags().empty());
+    CHECK(all_books[1].GetTitle() == "Tab\tand \"quotes\"");
+    CHECK(all_books[1].GetTags() == domain::Tags{"a", "b"});
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Bulk import resolves authors added by a concurrent transaction") {
+    // Другая транзакция добавляет автора и не фиксируется, пока импорт не начнёт ждать её строку
+    pqxx::connection concurrent_connection{Url()};
+    pqxx::work concurrent{concurrent_connection};
+    const auto concurrent_id = domain::AuthorId::New();
+    concurrent.exec_params("INSERT INTO authors (id, name) VALUES ($1, 'Concurrent');"_zv, concurrent_id.ToString());
+
+    auto resolved = std::async(std::launch::async, [this] {
+        pqxx::connection connection{Url()};
+        postgres::PrepareStatements(connection);
+        pqxx::work work{connection};
+        postgres::AuthorRepositoryImpl authors{work};
+        auto result = authors.AddMissingAuthors({{domain::AuthorId::New(), "Concurrent"}});
+        work.commit();
+        return result;
+    });
+    std::this_thread::sleep_for(200ms);
+    concurrent.commit();
+
+    const auto authors = resolved.get();
+    REQUIRE(authors.size() == 1);
+    CHECK(authors[0].GetId() == concurrent_id);
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Snapshot units of work export disjoint parts of one snapshot") {
+    AddAuthorWithBooks("Author", 200, 2);
+    // Книги без тегов сдвигают границы id книг относительно границ id книг в book_tags
+    AddAuthorWithBooks("Untagged author", 50, 0);
+
+    postgres::DatabaseConfig config{Url()};
+    config.pool.capacity = 4;
+    postgres::Database database{config};
+
+    auto units = database.GetSnapshotUnitsOfWork(8);
+    REQUIRE(units.size() == 4);
+
+    // Изменения, зафиксированные после открытия снимка, в выгрузку не попадают
+    AddAuthorWithBooks("Late author", 10, 1);
+
+    std::vector<std::string> book_lines;
+    size_t author_count = 0;
+    size_t tag_count = 0;
+    for (size_t index = 0; index < units.size(); ++index) {
+        const domain::DumpPart part{index, units.size()};
+        author_count += units[index]->Authors().DumpAuthors(part, [](std::string_view line) {
+            CHECK(line.find('\t') != std::string_view::npos);
+        });
+        std::unordered_set<std::string> part_book_ids;
+        units[index]->Books().DumpBooks(part, [&book_lines, &part_book_ids](std::string_view line) {
+            book_lines.emplace_back(line);
+            part_book_ids.emplace(line.substr(0, line.find('\t')));
+        });
+        // Теги книги выгружаются в той же части, что и сама книга
+        tag_count += units[index]->Books().DumpBookTags(part, [&part_book_ids](std::string_view line) {
+            CHECK(part_book_ids.contains(std::string{line.substr(0, line.find('\t'))}));
+        });
+    }
+
+    CHECK(author_count == 2);
+    CHECK(tag_count == 400);
+    REQUIRE(book_lines.size() == 250);
+    std::sort(book_lines.begin(), book_lines.end());
+    CHECK(std::adjacent_find(book_lines.begin(), book_lines.end()) == book_lines.end());
+    CHECK(book_lines.front().ends_with("\t2000"sv));
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Pipelined writes take far fewer round trips and report errors") {
+    constexpr int EDIT_COUNT = 1000;
+    const auto author_id = AddAuthorWithBooks("Author", 0, 0);
+
+    pqxx::work work{Connection()};
+    postgres::StatementPipeline pipeline{work};
+    postgres::AuthorRepositoryImpl authors{work, postgres::UuidFormat::Text, &pipeline};
+    postgres::BookRepositoryImpl books{work, postgres::UuidFormat::Text, &pipeline};
+
+    const auto book_id = domain::BookId::New();
+    QueryCounter counter{Connection()};
+    books.Save({book_id, author_id, "Book", 2000, {"tag 0"}});
+    for (int i = 1; i <= EDIT_COUNT; ++i) {
+        authors.Edit(author_id, "Author " + std::to_string(i));
+        books.EditBook(book_id, "Book " + std::to_string(i), 2000 + i, {"tag " + std::to_string(i), "it's"});
+    }
+
+    // Чтение дожидается всех отправленных изменений
+    const auto saved = books.GetBooksByAuthorId(author_id);
+    CHECK(counter.Count() < EDIT_COUNT / 10);
+    REQUIRE(saved.size() == 1);
+    CHECK(saved.front().GetTitle() == "Book " + std::to_string(EDIT_COUNT));
+    CHECK(saved.front().GetTags() == domain::Tags{"it's", "tag " + std::to_string(EDIT_COUNT)});
+    CHECK(authors.FindAuthorById(author_id)->GetName() == "Author " + std::to_string(EDIT_COUNT));
+
+    // Повтор имени нарушает уникальность, но это становится известно только при Flush
+    authors.Save({domain::AuthorId::New(), "Author " + std::to_string(EDIT_COUNT)});
+    CHECK_THROWS_AS(pipeline.Flush(), domain::AuthorExistsError);
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "Batch use case applies all operations in one transaction") {
+    postgres::Database database{postgres::DatabaseConfig{Url()}};
+    app::UseCasesImpl use_cases{database};
+
+    const auto results = use_cases.ExecuteBatch({app::batch::AddAuthor{"Jack London"}});
+    const auto author_id = std::get<domain::AuthorId>(results.at(0));
+
+    std::vector<app::BatchOperation> operations;
+    for (int i = 0; i < 100; ++i) {
+        operations.push_back(app::batch::AddBook{author_id, "Book " + std::to_string(i), 2000, {"tag"}});
+    }
+    operations.push_back(app::batch::EditAuthor{author_id, "John Griffith Chaney"});
+    const auto book_results = use_cases.ExecuteBatch(operations);
+    REQUIRE(book_results.size() == 101);
+    CHECK(use_cases.GetBooksByAuthor(author_id).size() == 100);
+    CHECK(use_cases.FindAuthorById(author_id)->GetName() == "John Griffith Chaney");
+
+    // Ошибка в любой операции отменяет весь пакет и называет операцию, как в других хранилищах
+    const auto book_id = std::get<domain::BookId>(book_results.at(0));
+    try {
+        use_cases.ExecuteBatch({app::batch::DeleteBook{book_id}, app::batch::AddAuthor{"Mark Twain"},
+                                app::batch::AddAuthor{"John Griffith Chaney"}});
+        FAIL("The batch must fail");
+    } catch (const app::BatchOperationError& error) {
+        CHECK(error.GetIndex() == 2);
+        CHECK_THROWS_AS(std::rethrow_if_nested(error), domain::AuthorExistsError);
+    }
+    CHECK(use_cases.GetBooksByAuthor(author_id).size() == 100);
+    CHECK_FALSE(use_cases.FindAuthorByName("Mark Twain"));
+}
+
+TEST_CASE_METHOD(DatabaseFixture, "A command runs its use cases in one transaction") {
+    postgres::Database database{postgres::DatabaseConfig{Url()}};
+    app::UseCasesImpl use_cases{database};
+
+    const size_t transactions = database.GetTransactionCount();
+    use_cases.RunCommand([&] {
+        REQUIRE_FALSE(use_cases.FindAuthorByName("Jack London"));
+        const auto author_id = domain::AuthorId::New();
+        use_cases.AddAuthorWithId(author_id, "Jack London");
+        CHECK(use_cases.GetAllAuthors().size() == 1);
+        use_cases.AddBook(author_id, "White Fang", 1906, {"adventure"}, "Jack London");
+    });
+    CHECK(database.GetTransactionCount() - transactions == 1);
+    CHECK(use_cases.GetAllBooks().size() == 1);
+
+    SECTION("Taken names are rejected by the database and roll the command back") {
+        auto add_duplicate = [&] {
+            use_cases.RunCommand([&] {
+                use_cases.AddAuthor("Stanislaw Lem");
+                use_cases.AddAuthor("Jack London");
+            });
+        };
+        CHECK_THROWS_AS(add_duplicate(), domain::AuthorExistsError);
+        CHECK_FALSE(use_cases.FindAuthorByName("Stanislaw Lem"));
+    }
+}
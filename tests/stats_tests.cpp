@@ -0,0 +1,140 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/memory/memory.h"
+#include "../src/util/stats.h"
+
+using namespace std::literals;
+using util::stats::Histogram;
+
+namespace {
+
+std::optional<util::stats::Operation::Snapshot> FindOperation(const std::string& name) {
+    for (auto& operation : util::stats::Registry::Global().GetSnapshot()) {
+        if (operation.name == name) {
+            return operation;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+TEST_CASE("Histogram buckets cover values with bounded relative error") {
+    for (uint64_t value = 0; value < Histogram::SUB_BUCKET_COUNT; ++value) {
+        CHECK(Histogram::HighestValueOf(Histogram::BucketOf(value)) == value);
+    }
+    for (const uint64_t value : std::initializer_list<uint64_t>{32, 33, 1000, 123'456, 10'000'000'000, UINT64_MAX}) {
+        const auto bucket = Histogram::BucketOf(value);
+        REQUIRE(bucket < Histogram::BUCKET_COUNT);
+        const auto highest = Histogram::HighestValueOf(bucket);
+        CHECK(highest >= value);
+        CHECK(highest - value <= value / Histogram::SUB_BUCKET_COUNT);
+        // Соседние корзины не пересекаются
+        CHECK(Histogram::BucketOf(highest) == bucket);
+        if (highest < UINT64_MAX) {
+            CHECK(Histogram::BucketOf(highest + 1) == bucket + 1);
+        }
+    }
+}
+
+TEST_CASE("Histogram quantiles follow recorded values") {
+    Histogram histogram;
+    for (uint64_t value = 1; value <= 10'000; ++value) {
+        histogram.Record(value * 1000);
+    }
+
+    const auto snapshot = histogram.GetSnapshot();
+    CHECK(snapshot.count == 10'000);
+    CHECK(snapshot.max == 10'000'000);
+    CHECK(snapshot.sum == 1000 * 10'000ull * 10'001 / 2);
+    for (const double quantile : {0.5, 0.99, 0.999}) {
+        const double expected = quantile * 10'000'000;
+        const auto actual = static_cast<double>(snapshot.ValueAt(quantile));
+        CHECK(actual >= expected);
+        CHECK(actual <= expected * (1 + 1.0 / Histogram::SUB_BUCKET_COUNT));
+    }
+    CHECK(snapshot.ValueAt(1.0) == snapshot.max);
+    CHECK(Histogram{}.GetSnapshot().ValueAt(0.5) == 0);
+}
+
+TEST_CASE("Histogram counts concurrent records") {
+    Histogram histogram;
+    constexpr int THREAD_COUNT = 8;
+    constexpr uint64_t RECORD_COUNT = 10'000;
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < THREAD_COUNT; ++thread) {
+        threads.emplace_back([&histogram] {
+            for (uint64_t value = 0; value < RECORD_COUNT; ++value) {
+                histogram.Record(value);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto snapshot = histogram.GetSnapshot();
+    CHECK(snapshot.count == THREAD_COUNT * RECORD_COUNT);
+    CHECK(snapshot.sum == THREAD_COUNT * (RECORD_COUNT * (RECORD_COUNT - 1) / 2));
+    CHECK(snapshot.max == RECORD_COUNT - 1);
+}
+
+TEST_CASE("Registry writes operations in Prometheus text format") {
+    util::stats::Registry registry;
+    auto& operation = registry.Get("BookRepository.GetAllBooks");
+    CHECK(&registry.Get("BookRepository.GetAllBooks") == &operation);
+    operation.Record(2ms, 5, false);
+    operation.Record(4ms, 7, true);
+
+    std::ostringstream output;
+    registry.WritePrometheus(output);
+    const auto text = output.str();
+    CHECK(text.find("# TYPE bookypedia_operation_duration_seconds summary\n") != std::string::npos);
+    CHECK(text.find("bookypedia_operation_duration_seconds{operation=\"BookRepository.GetAllBooks\",quantile=\"0.5\"} "
+                    "0.002") != std::string::npos);
+    CHECK(text.find("bookypedia_operation_duration_seconds_sum{operation=\"BookRepository.GetAllBooks\"} 0.006\n") !=
+          std::string::npos);
+    CHECK(text.find("bookypedia_operation_duration_seconds_count{operation=\"BookRepository.GetAllBooks\"} 2\n") !=
+          std::string::npos);
+    CHECK(text.find("bookypedia_operation_rows_total{operation=\"BookRepository.GetAllBooks\"} 12\n") !=
+          std::string::npos);
+    CHECK(text.find("bookypedia_operation_errors_total{operation=\"BookRepository.GetAllBooks\"} 1\n") !=
+          std::string::npos);
+}
+
+TEST_CASE("Use cases record calls, rows and errors") {
+    // Без BOOKYPEDIA_STATS use case ничего не замеряют
+    if constexpr (!util::stats::ENABLED) {
+        return;
+    }
+
+    memory::Database database;
+    app::UseCasesImpl use_cases{database};
+    const auto before = FindOperation("UseCases.GetAllAuthors");
+    const auto calls_before = before ? before->latency.count : 0;
+    const auto rows_before = before ? before->rows : 0;
+    const auto errors_before = FindOperation("UseCases.AddAuthor").value_or(util::stats::Operation::Snapshot{}).errors;
+
+    use_cases.AddAuthor("Jack London");
+    use_cases.AddAuthor("Mark Twain");
+    CHECK_THROWS(use_cases.AddAuthor("Mark Twain"));
+    CHECK(use_cases.GetAllAuthors().size() == 2);
+
+    const auto get_all = FindOperation("UseCases.GetAllAuthors");
+    REQUIRE(get_all.has_value());
+    CHECK(get_all->latency.count == calls_before + 1);
+    CHECK(get_all->rows == rows_before + 2);
+    CHECK(FindOperation("UseCases.AddAuthor")->errors == errors_before + 1);
+    // Вызовы репозиториев замеряются отдельно от use case
+    CHECK(FindOperation("AuthorRepository.Save").has_value());
+    CHECK(FindOperation("AuthorRepository.GetAllAuthors").has_value());
+}
@@ -1,4 +1,13 @@
+#include <algorithm>
+#include <boost/uuid/uuid_hash.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 #include "../src/util/tagged_uuid.h"
 
@@ -7,10 +16,88 @@ using util::TaggedUUID;
 namespace {
 struct TestTag {};
 using TestUUID = TaggedUUID<TestTag>;
+
+struct TimeOrderedTag {
+    static constexpr auto UUID_VERSION = util::UUIDVersion::TimeOrdered;
+};
+using TimeOrderedUUID = TaggedUUID<TimeOrderedTag>;
 }  // namespace
 
 TEST_CASE("UUID-String conversion") {
     auto uuid = TestUUID::New();
     auto s = uuid.ToString();
     CHECK(TestUUID::FromString(s) == uuid);
-}
\ No newline at end of file
+}
+TEST_CASE("UUID text uses the canonical lowercase form") {
+    const auto uuid = TestUUID::FromString("0123ABCD-4567-89ab-CDEF-0123456789aB");
+    CHECK(uuid.ToString() == "0123abcd-4567-89ab-cdef-0123456789ab");
+    CHECK(TestUUID{}.ToString() == "00000000-0000-0000-0000-000000000000");
+}
+
+TEST_CASE("UUID parsing rejects non-canonical text") {
+    for (std::string_view text : {"", "0123abcd-4567-89ab-cdef-0123456789a", "0123abcd-4567-89ab-cdef-0123456789abc",
+                                  "{0123abcd-4567-89ab-cdef-0123456789ab}", "0123abcd456789abcdef0123456789ab",
+                                  "0123abcd-4567-89ab-cdef_0123456789ab", "0123abcg-4567-89ab-cdef-0123456789ab",
+                                  "0123abcd-4567-89ab-cdef-0123456789a "}) {
+        CAPTURE(text);
+        CHECK_THROWS_AS(TestUUID::FromString(text), std::invalid_argument);
+    }
+}
+
+TEST_CASE("New UUIDs are version 4 and unique across threads") {
+    constexpr size_t THREAD_COUNT = 4;
+    constexpr size_t UUID_COUNT = 10'000;
+
+    std::vector<std::future<std::vector<TestUUID>>> batches;
+    for (size_t i = 0; i < THREAD_COUNT; ++i) {
+        batches.push_back(std::async(std::launch::async, [i] {
+            if (i % 2 == 0) {
+                return TestUUID::New(UUID_COUNT);
+            }
+            std::vector<TestUUID> uuids;
+            for (size_t j = 0; j < UUID_COUNT; ++j) {
+                uuids.push_back(TestUUID::New());
+            }
+            return uuids;
+        }));
+    }
+
+    std::unordered_set<TestUUID, util::TaggedHasher<TestUUID>> unique;
+    size_t invalid_count = 0;
+    for (auto& batch : batches) {
+        for (const auto& uuid : batch.get()) {
+            invalid_count += (*uuid).version() != boost::uuids::uuid::version_random_number_based ||
+                             (*uuid).variant() != boost::uuids::uuid::variant_rfc_4122;
+            unique.insert(uuid);
+        }
+    }
+    CHECK(invalid_count == 0);
+    CHECK(unique.size() == THREAD_COUNT * UUID_COUNT);
+}
+
+TEST_CASE("Time-ordered UUIDs are version 7 and increase within a thread") {
+    STATIC_REQUIRE(TimeOrderedUUID::VERSION == util::UUIDVersion::TimeOrdered);
+    STATIC_REQUIRE(TestUUID::VERSION == util::UUIDVersion::Random);
+
+    // Пакет намного больше ёмкости счётчика одной миллисекунды
+    auto uuids = TimeOrderedUUID::New(20'000);
+    uuids.push_back(TimeOrderedUUID::New());
+
+    size_t invalid_count = 0;
+    for (const auto& uuid : uuids) {
+        invalid_count += ((*uuid).data[6] >> 4) != 7 ||
+                         (*uuid).variant() != boost::uuids::uuid::variant_rfc_4122;
+    }
+    CHECK(invalid_count == 0);
+    CHECK(std::adjacent_find(uuids.begin(), uuids.end(), [](const auto& lhs, const auto& rhs) {
+              return !(*lhs < *rhs);
+          }) == uuids.end());
+
+    // Первые 48 бит — текущее время в миллисекундах
+    const auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    const auto uuid_ms = std::stoll(uuids.front().ToString().substr(0, 8) + uuids.front().ToString().substr(9, 4),
+                                    nullptr, 16);
+    CHECK(std::abs(now_ms - uuid_ms) < 60'000);
+}
@@ -1,117 +1,27 @@
+#include <algorithm>
+#include <exception>
 #include <catch2/catch_test_macros.hpp>
-
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "../src/app/catalog_read_model.h"
+#include "../src/app/grouped_unit_of_work.h"
 #include "../src/app/use_cases_impl.h"
 #include "../src/domain/author.h"
 #include "../src/domain/book.h"
 
-namespace {
-
-// --- MOCK REPOSITORIES ---
-class MockAuthorRepository : public domain::AuthorRepository {
-public:
-    MockAuthorRepository() = default;
-
-    void Save(const domain::Author& author) override {
-        saved_authors_.emplace_back(author);
-    }
-
-    domain::Authors GetAllAuthors() override {
-        return saved_authors_;
-    }
-
-    void Delete(const domain::AuthorId&) override {}
-    void Edit(const domain::AuthorId&, const std::string&) override {}
-
-    std::optional<domain::Author> FindAuthorById(const domain::AuthorId& id) override {
-        for (const auto& author : saved_authors_)
-            if (author.GetId() == id)
-                return author;
-        return std::nullopt;
-    }
+#include "helpers.h"
+#include "mocks.h"
 
-    std::optional<domain::Author> FindAuthorByName(const std::string& name) override {
-        for (const auto& author : saved_authors_)
-            if (author.GetName() == name)
-                return author;
-        return std::nullopt;
-    }
+using helpers::TitlesOf;
+using mocks::MockAuthorRepository;
+using mocks::MockBookRepository;
+using mocks::MockUnitOfWorkFactory;
 
-    const domain::Authors& GetSavedAuthors() const noexcept {
-        return saved_authors_;
-    }
-
-private:
-    domain::Authors saved_authors_;
-};
-
-class MockBookRepository : public domain::BookRepository {
-public:
-    MockBookRepository() = default;
-
-    void Save(const domain::Book& book) override {
-        saved_books_.emplace_back(book);
-    }
-
-    domain::Books GetAllBooks() override {
-        return saved_books_;
-    }
-
-    domain::Books GetBooksByAuthorId(const domain::AuthorId& id) override {
-        domain::Books result;
-        for (const auto& book : saved_books_) {
-            if (book.GetAuthorId() == id) {
-                result.push_back(book);
-            }
-        }
-        return result;
-    }
-
-    domain::Books GetBooksByTitle(const std::string&) override {
-        return {};
-    }
-    void DeleteBookTags(const domain::BookId&) override {}
-    void DeleteBook(const domain::BookId&) override {}
-    void EditBook(const domain::BookId&, const std::string&, int, const domain::Tags&) override {}
-
-    const domain::Books& GetSavedBooks() const noexcept {
-        return saved_books_;
-    }
-
-private:
-    domain::Books saved_books_;
-};
-
-// --- MOCK UNIT OF WORK ---
-class MockUnitOfWork : public app::UnitOfWork {
-public:
-    MockUnitOfWork(MockAuthorRepository& authors, MockBookRepository& books) : authors_(authors), books_(books) {}
-
-    domain::AuthorRepository& Authors() override {
-        return authors_;
-    }
-    domain::BookRepository& Books() override {
-        return books_;
-    }
-    void Commit() override {}
-
-private:
-    MockAuthorRepository& authors_;
-    MockBookRepository& books_;
-};
-
-class MockUnitOfWorkFactory : public app::UnitOfWorkFactory {
-public:
-    MockUnitOfWorkFactory(MockAuthorRepository& authors, MockBookRepository& books)
-        : authors_(authors), books_(books) {}
-
-    std::unique_ptr<app::UnitOfWork> GetUnitOfWork() override {
-        return std::make_unique<MockUnitOfWork>(authors_, books_);
-    }
-
-private:
-    MockAuthorRepository& authors_;
-    MockBookRepository& books_;
-};
+namespace {
 
 // --- FIXTURE ---
 struct Fixture {
@@ -181,3 +91,516 @@ SCENARIO_METHOD(Fixture, "List Authors") {
         }
     }
 }
+
+SCENARIO_METHOD(Fixture, "Read use cases") {
+    GIVEN("UseCasesImpl with mock repositories") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+
+        use_cases.AddAuthor("Jack London");
+        const auto author_id = authors.GetSavedAuthors().front().GetId();
+        const int write_units = factory.units_of_work;
+
+        WHEN("Reading authors and books") {
+            use_cases.GetAllAuthors();
+            use_cases.FindAuthorById(author_id);
+            use_cases.FindAuthorByName("Jack London");
+            use_cases.GetAllBooks();
+            use_cases.GetBooksByAuthor(author_id);
+            use_cases.GetBooksByTitle("White Fang");
+
+            THEN("Every read opens a read-only unit of work") {
+                CHECK(factory.read_only_units_of_work == 6);
+                CHECK(factory.units_of_work == write_units);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Catalog read model") {
+    GIVEN("Read model over UseCasesImpl with mock repositories") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+        app::CatalogReadModel read_model{use_cases, factory};
+
+        WHEN("Adding an author and a book through the read model") {
+            read_model.AddAuthor("Jack London");
+            const auto author = read_model.FindAuthorByName("Jack London");
+            REQUIRE(author);
+            read_model.AddBook(author->GetId(), "White Fang", 1906, {"adventure"}, author->GetName());
+
+            THEN("Reads are served from the reloaded snapshot without opening units of work") {
+                const int units = factory.units_of_work + factory.read_only_units_of_work;
+
+                REQUIRE(read_model.GetAllAuthors().size() == 1);
+                CHECK(read_model.FindAuthorById(author->GetId())->GetName() == "Jack London");
+                REQUIRE(read_model.GetAllBooks().size() == 1);
+                CHECK(read_model.GetBooksByAuthor(author->GetId()).at(0).GetTitle() == "White Fang");
+                CHECK(read_model.GetBooksByTitle("White Fang").size() == 1);
+                CHECK_FALSE(read_model.FindAuthorByName("Joanne Rowling"));
+                CHECK(read_model.GetBooksByTitle("Martin Eden").empty());
+
+                CHECK(factory.units_of_work + factory.read_only_units_of_work == units);
+            }
+        }
+
+        WHEN("Several changes are made in a row") {
+            const int units = factory.units_of_work;
+            for (const auto* name : {"Jack London", "Mark Twain", "Leo Tolstoy"}) {
+                read_model.AddAuthor(name);
+            }
+
+            THEN("Every change reloads the snapshot before returning") {
+                CHECK(factory.units_of_work == units + 6);
+                CHECK(read_model.GetAllAuthors().size() == 3);
+                CHECK(read_model.GetAuthorsPage(std::nullopt, 10).size() == 3);
+                CHECK(factory.units_of_work == units + 6);
+            }
+        }
+
+        WHEN("A command reads its own changes") {
+            std::optional<domain::Author> found_in_command;
+            read_model.RunCommand([&read_model, &found_in_command] {
+                read_model.AddAuthor("Jack London");
+                found_in_command = read_model.FindAuthorByName("Jack London");
+            });
+
+            THEN("Reads inside the command see them, and the snapshot has them after the command") {
+                CHECK(found_in_command.has_value());
+                const int units = factory.units_of_work + factory.read_only_units_of_work;
+                CHECK(read_model.FindAuthorByName("Jack London").has_value());
+                CHECK(factory.units_of_work + factory.read_only_units_of_work == units);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Read model searches titles and authors by word prefixes") {
+    GIVEN("Read model over a catalog of two authors") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+        app::CatalogReadModel read_model{use_cases, factory};
+        read_model.ImportBooks({
+            {"Fang", "Stanislaw Lem", 1970, {}},
+            {"Solaris", "Stanislaw Lem", 1961, {}},
+            {"The Call of the Wild", "Jack London", 1903, {}},
+            {"White Fang", "Jack London", 1906, {}},
+        });
+
+        auto search = [&read_model](const std::string& query, size_t limit) {
+            return TitlesOf(read_model.SearchBooks(query, limit));
+        };
+
+        THEN("Every query word must start a word of the title or of the author name") {
+            CHECK(search("whi FAN", 10) == std::vector<std::string>{"White Fang"});
+            CHECK(search("lem", 10) == std::vector<std::string>{"Fang", "Solaris"});
+            CHECK(search("call wild", 10) == std::vector<std::string>{"The Call of the Wild"});
+            CHECK(search("ang", 10).empty());
+            CHECK(search("  ", 10).empty());
+        }
+
+        THEN("Exact titles come first, then title matches, then author matches") {
+            CHECK(search("White Fang", 10) == std::vector<std::string>{"White Fang"});
+            CHECK(search("Fang", 10) == std::vector<std::string>{"Fang", "White Fang"});
+            CHECK(search("London", 10) == std::vector<std::string>{"The Call of the Wild", "White Fang"});
+            CHECK(search("Fang", 1) == std::vector<std::string>{"Fang"});
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Books are found by all or any of the tags") {
+    GIVEN("Books with overlapping tags") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+        app::CatalogReadModel read_model{use_cases, factory};
+        read_model.ImportBooks({
+            {"A", "Author", 2000, {"classic", "sea"}},
+            {"B", "Author", 2000, {"sea"}},
+            {"C", "Author", 2000, {"classic"}},
+            {"D", "Author", 2000, {"classic", "dogs", "sea"}},
+            {"E", "Author", 2000, {}},
+        });
+
+        auto read_all_pages = [](app::UseCases& reader, const domain::Tags& tags, domain::TagMatch match) {
+            std::vector<std::string> titles;
+            std::optional<domain::BooksPageKey> after;
+            for (auto page = reader.GetBooksByTags(tags, match, after, 2); !page.empty();
+                 page = reader.GetBooksByTags(tags, match, after, 2)) {
+                for (const auto& book : page) {
+                    titles.push_back(book.GetTitle());
+                }
+                after = domain::BooksPageKey{page.back().GetTitle(), page.back().GetBookId()};
+            }
+            return titles;
+        };
+
+        THEN("All-of pages contain books with every tag") {
+            const std::vector<std::string> expected{"A", "D"};
+            CHECK(read_all_pages(use_cases, {"sea", "classic"}, domain::TagMatch::All) == expected);
+            CHECK(read_all_pages(read_model, {"sea", "classic"}, domain::TagMatch::All) == expected);
+            CHECK(read_all_pages(read_model, {"sea", "missing"}, domain::TagMatch::All).empty());
+        }
+
+        THEN("Any-of pages contain books with at least one tag, each once") {
+            const std::vector<std::string> expected{"A", "B", "C", "D"};
+            CHECK(read_all_pages(use_cases, {"sea", "classic"}, domain::TagMatch::Any) == expected);
+            CHECK(read_all_pages(read_model, {"sea", "classic"}, domain::TagMatch::Any) == expected);
+            CHECK(read_all_pages(read_model, {"dogs", "missing"}, domain::TagMatch::Any) ==
+                  std::vector<std::string>{"D"});
+        }
+
+        THEN("An empty tag set matches nothing") {
+            CHECK(read_model.GetBooksByTags({}, domain::TagMatch::Any, std::nullopt, 10).empty());
+            CHECK(use_cases.GetBooksByTags({}, domain::TagMatch::All, std::nullopt, 10).empty());
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Authors are read page by page") {
+    GIVEN("Five authors") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+        app::CatalogReadModel read_model{use_cases, factory};
+
+        for (const auto* name : {"A", "B", "C", "D", "E"}) {
+            read_model.AddAuthor(name);
+        }
+
+        auto read_all_pages = [](app::UseCases& reader) {
+            std::vector<std::vector<std::string>> pages;
+            std::optional<domain::AuthorsPageKey> after;
+            for (auto page = reader.GetAuthorsPage(after, 2); !page.empty(); page = reader.GetAuthorsPage(after, 2)) {
+                auto& names = pages.emplace_back();
+                for (const auto& author : page) {
+                    names.push_back(author.GetName());
+                }
+                after = domain::AuthorsPageKey{page.back().GetName(), page.back().GetId()};
+            }
+            return pages;
+        };
+
+        WHEN("Reading pages of two authors") {
+            const std::vector<std::vector<std::string>> expected{{"A", "B"}, {"C", "D"}, {"E"}};
+
+            THEN("Every author is read once from the repository and from the read model") {
+                CHECK(read_all_pages(use_cases) == expected);
+                CHECK(read_all_pages(read_model) == expected);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Import books") {
+    GIVEN("A catalog with one known author") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+        use_cases.AddAuthor("Jack London");
+        const auto known_author_id = authors.GetSavedAuthors().front().GetId();
+
+        WHEN("Importing books by known and new authors") {
+            const auto result = use_cases.ImportBooks({
+                {"White Fang", "Jack London", 1906, {"Adventure"}},
+                {"Martin Eden", "Jack London", 1909, {}},
+                {"Solaris", "Stanislaw Lem", 1961, {"Sci-fi"}},
+                {"Eden", "Stanislaw Lem", 1959, {}},
+            });
+
+            THEN("Books are added in one unit of work and each new author is created once") {
+                CHECK(result.books == 4);
+                CHECK(result.new_authors == 1);
+                CHECK(factory.units_of_work == 2);
+                REQUIRE(authors.GetSavedAuthors().size() == 2);
+                REQUIRE(books.GetSavedBooks().size() == 4);
+
+                const auto& saved = books.GetSavedBooks();
+                CHECK(saved[0].GetAuthorId() == known_author_id);
+                CHECK(saved[1].GetAuthorId() == known_author_id);
+                CHECK(saved[2].GetAuthorId() == authors.GetSavedAuthors().back().GetId());
+                CHECK(saved[3].GetAuthorId() == saved[2].GetAuthorId());
+                CHECK(saved[2].GetTags() == domain::Tags{"Sci-fi"});
+                CHECK(saved[0].GetBookId() != saved[1].GetBookId());
+            }
+        }
+    }
+
+    GIVEN("A repository that doesn't resolve one of the authors") {
+        // Так ведёт себя хранилище, потерявшее автора, которого параллельно добавила другая транзакция
+        struct ForgetfulAuthorRepository : MockAuthorRepository {
+            domain::Authors AddMissingAuthors(const domain::Authors& authors) override {
+                auto result = MockAuthorRepository::AddMissingAuthors(authors);
+                result.pop_back();
+                return result;
+            }
+        } forgetful_authors;
+        MockUnitOfWorkFactory factory{forgetful_authors, books};
+        app::UseCasesImpl use_cases{factory};
+
+        THEN("Import fails instead of adding books without an author") {
+            CHECK_THROWS_AS(use_cases.ImportBooks({{"White Fang", "Jack London", 1906, {}},
+                                                   {"Solaris", "Stanislaw Lem", 1961, {}}}),
+                            std::runtime_error);
+            CHECK(books.GetSavedBooks().empty());
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Export catalog") {
+    GIVEN("A catalog of five books by two authors") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+        use_cases.ImportBooks({
+            {"White Fang", "Jack London", 1906, {"adventure", "dogs"}},
+            {"Martin Eden", "Jack London", 1909, {}},
+            {"Solaris", "Stanislaw Lem", 1961, {"sci-fi"}},
+            {"Eden", "Stanislaw Lem", 1959, {}},
+            {"The Invincible", "Stanislaw Lem", 1964, {"sci-fi"}},
+        });
+
+        std::mutex mutex;
+        std::map<std::pair<app::CatalogTable, size_t>, std::vector<std::string>> lines;
+        const app::ExportSinkFactory make_sink = [&](app::CatalogTable table, size_t part) {
+            return [&, key = std::make_pair(table, part)](std::string_view line) {
+                std::lock_guard lock{mutex};
+                lines[key].emplace_back(line);
+            };
+        };
+
+        auto all_lines = [&lines](app::CatalogTable table) {
+            std::vector<std::string> result;
+            for (const auto& [key, part_lines] : lines) {
+                if (key.first == table) {
+                    result.insert(result.end(), part_lines.begin(), part_lines.end());
+                }
+            }
+            std::sort(result.begin(), result.end());
+            return result;
+        };
+
+        WHEN("Exporting in more parts than the factory can open") {
+            factory.max_snapshot_units = 3;
+            const auto result = use_cases.ExportCatalog(8, make_sink);
+
+            THEN("Parts cover every row exactly once") {
+                CHECK(result.parts == 3);
+                CHECK(result.authors == 2);
+                CHECK(result.books == 5);
+                CHECK(result.book_tags == 4);
+
+                const auto authors_lines = all_lines(app::CatalogTable::Authors);
+                CHECK(authors_lines.size() == 2);
+                CHECK(std::adjacent_find(authors_lines.begin(), authors_lines.end()) == authors_lines.end());
+                const auto book_lines = all_lines(app::CatalogTable::Books);
+                CHECK(book_lines.size() == 5);
+                CHECK(std::adjacent_find(book_lines.begin(), book_lines.end()) == book_lines.end());
+                CHECK(all_lines(app::CatalogTable::BookTags).size() == 4);
+            }
+
+            THEN("Tags are exported in the same part as their book") {
+                for (const auto& [key, part_lines] : lines) {
+                    if (key.first != app::CatalogTable::BookTags) {
+                        continue;
+                    }
+                    const auto& part_books = lines[{app::CatalogTable::Books, key.second}];
+                    for (const auto& line : part_lines) {
+                        const auto book_id = line.substr(0, line.find('\t'));
+                        CHECK(std::any_of(part_books.begin(), part_books.end(), [&book_id](const std::string& book) {
+                            return book.starts_with(book_id);
+                        }));
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Batch of operations") {
+    GIVEN("UseCasesImpl with mock repositories") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+        use_cases.AddAuthor("Jack London");
+        const auto author_id = authors.GetSavedAuthors().front().GetId();
+        const int units = factory.units_of_work;
+
+        WHEN("Executing additions and edits in one batch") {
+            const auto results = use_cases.ExecuteBatch({
+                app::batch::AddAuthor{"Stanislaw Lem"},
+                app::batch::AddBook{author_id, "White Fang", 1906, {"adventure"}},
+                app::batch::EditAuthor{author_id, "John Griffith Chaney"},
+                app::batch::AddBook{author_id, "Martin Eden", 1909, {}},
+            });
+
+            THEN("Operations run in order in one batch unit of work with a result for each") {
+                CHECK(factory.batch_units_of_work == 1);
+                CHECK(factory.units_of_work == units);
+                REQUIRE(results.size() == 4);
+
+                REQUIRE(std::holds_alternative<domain::AuthorId>(results[0]));
+                CHECK(std::get<domain::AuthorId>(results[0]) == authors.GetSavedAuthors().back().GetId());
+                CHECK(std::holds_alternative<std::monostate>(results[2]));
+
+                REQUIRE(books.GetSavedBooks().size() == 2);
+                CHECK(std::get<domain::BookId>(results[1]) == books.GetSavedBooks()[0].GetBookId());
+                CHECK(std::get<domain::BookId>(results[3]) == books.GetSavedBooks()[1].GetBookId());
+                CHECK(books.GetSavedBooks()[1].GetTitle() == "Martin Eden");
+            }
+        }
+
+        WHEN("Executing an empty batch") {
+            CHECK(use_cases.ExecuteBatch({}).empty());
+
+            THEN("No unit of work is opened") {
+                CHECK(factory.batch_units_of_work == 0);
+            }
+        }
+
+        WHEN("An operation of the batch fails") {
+            std::optional<size_t> failed_index;
+            bool author_exists = false;
+            try {
+                use_cases.ExecuteBatch({app::batch::AddAuthor{"Stanislaw Lem"}, app::batch::AddAuthor{"Jack London"}});
+            } catch (const app::BatchOperationError& error) {
+                failed_index = error.GetIndex();
+                try {
+                    std::rethrow_if_nested(error);
+                } catch (const domain::AuthorExistsError&) {
+                    author_exists = true;
+                }
+            }
+
+            THEN("The error names the operation and wraps the original one") {
+                CHECK(failed_index == 1);
+                CHECK(author_exists);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Grouped units of work") {
+    GIVEN("UseCasesImpl over units of work grouped by three changes") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::GroupedUnitOfWorkFactory grouped{factory, 3};
+        app::UseCasesImpl use_cases{grouped};
+
+        WHEN("Seven changes are made with reads between them") {
+            for (int i = 0; i < 7; ++i) {
+                use_cases.AddAuthor("Author " + std::to_string(i));
+                CHECK(use_cases.GetAllAuthors().size() == static_cast<size_t>(i + 1));
+            }
+
+            THEN("Full groups are committed and reads share their transactions") {
+                CHECK(factory.units_of_work == 3);
+                CHECK(factory.read_only_units_of_work == 0);
+                CHECK(factory.commits == 2);
+                CHECK(grouped.GetStats().transactions == 2);
+                CHECK(grouped.GetStats().commits == 6);
+            }
+
+            AND_WHEN("The group is flushed") {
+                grouped.Flush();
+                grouped.Flush();
+
+                THEN("The remaining change is committed once") {
+                    CHECK(factory.commits == 3);
+                    CHECK(grouped.GetStats().transactions == 3);
+                    CHECK(grouped.GetStats().commits == 7);
+                }
+            }
+        }
+
+        WHEN("A use case fails inside an open group") {
+            use_cases.AddAuthor("Jack London");
+            try {
+                auto uow = grouped.GetUnitOfWork();
+                throw std::runtime_error("storage failure");
+            } catch (const std::runtime_error&) {
+            }
+            use_cases.AddAuthor("Stanislaw Lem");
+            grouped.Flush();
+
+            THEN("Only the failed use case is rolled back to its savepoint") {
+                CHECK(factory.savepoint_rollbacks == 1);
+                CHECK(grouped.GetStats().rolled_back == 0);
+                CHECK(grouped.GetStats().commits == 2);
+                CHECK(factory.units_of_work == 1);
+                CHECK(factory.commits == 1);
+            }
+        }
+
+        WHEN("A use case closes its unit of work without commit") {
+            use_cases.AddAuthor("Jack London");
+            grouped.GetUnitOfWork().reset();
+            grouped.Flush();
+
+            THEN("Its changes are rolled back and the group is committed") {
+                CHECK(factory.savepoint_rollbacks == 1);
+                CHECK(grouped.GetStats().commits == 1);
+                CHECK(factory.commits == 1);
+            }
+        }
+    }
+
+    GIVEN("Units of work grouped so that a failure rolls back the whole group") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::GroupedUnitOfWorkFactory grouped{factory, 3, app::GroupedUnitOfWorkFactory::FailureScope::Group};
+        app::UseCasesImpl use_cases{grouped};
+
+        WHEN("A use case fails inside an open group") {
+            use_cases.AddAuthor("Jack London");
+            try {
+                auto uow = grouped.GetUnitOfWork();
+                throw std::runtime_error("storage failure");
+            } catch (const std::runtime_error&) {
+            }
+            use_cases.AddAuthor("Stanislaw Lem");
+            grouped.Flush();
+
+            THEN("The group is rolled back and the next change opens a new one") {
+                CHECK(factory.savepoint_rollbacks == 0);
+                CHECK(grouped.GetStats().rolled_back == 1);
+                CHECK(grouped.GetStats().commits == 1);
+                CHECK(factory.units_of_work == 2);
+                CHECK(factory.commits == 1);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Commands run their use cases in one unit of work") {
+    GIVEN("UseCasesImpl with mock repositories") {
+        MockUnitOfWorkFactory factory{authors, books};
+        app::UseCasesImpl use_cases{factory};
+
+        WHEN("A command looks up an author, adds it and adds a book") {
+            use_cases.RunCommand([&] {
+                CHECK_FALSE(use_cases.FindAuthorByName("Jack London"));
+                const auto author_id = domain::AuthorId::New();
+                use_cases.AddAuthorWithId(author_id, "Jack London");
+                use_cases.RunCommand([&] {
+                    use_cases.AddBook(author_id, "White Fang", 1906, {}, "Jack London");
+                });
+            });
+
+            THEN("One unit of work is opened and committed once") {
+                CHECK(factory.units_of_work == 1);
+                CHECK(factory.read_only_units_of_work == 0);
+                CHECK(factory.commits == 1);
+                CHECK(books.GetSavedBooks().size() == 1);
+            }
+        }
+
+        WHEN("Adding an author whose name is taken") {
+            use_cases.AddAuthor("Jack London");
+
+            THEN("The repository rejects it and the command commits nothing") {
+                auto add_duplicate = [&] {
+                    use_cases.RunCommand([&] {
+                        use_cases.AddAuthor("Jack London");
+                    });
+                };
+                CHECK_THROWS_AS(add_duplicate(), domain::AuthorExistsError);
+                CHECK(factory.commits == 1);
+                CHECK(authors.GetSavedAuthors().size() == 1);
+            }
+        }
+    }
+}